@@ -14,6 +14,12 @@ struct AabbTree {
 	int32_t root;
 
 	[[nodiscard]] static AabbTree build(const nvh::GltfScene&);
+
+	/// Frees the node and triangle arrays once they have been uploaded; only \ref root is kept.
+	void releaseHostData() {
+		std::vector<shader::AabbTreeNode>().swap(nodes);
+		std::vector<shader::Triangle>().swap(triangles);
+	}
 };
 
 struct AabbTreeBuffers {
@@ -22,6 +28,10 @@ struct AabbTreeBuffers {
 	vk::DeviceSize nodeBufferSize;
 	vk::DeviceSize triangleBufferSize;
 
+	[[nodiscard]] vk::DeviceSize getDeviceMemorySize() const {
+		return nodeBuffer.getAllocationSize() + triangleBuffer.getAllocationSize();
+	}
+
 	[[nodiscard]] static AabbTreeBuffers create(const AabbTree &tree, vma::Allocator &allocator) {
 		AabbTreeBuffers result;
 		// align the array correctly
@@ -0,0 +1,346 @@
+#include "aliasTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <queue>
+#include <random>
+
+#include "misc.h"
+#include "taskGraph.h"
+
+/// Number of weights that a single call of \ref parallelFor() handles.
+constexpr std::size_t _aliasTableEntriesPerChunk = 1 << 16;
+
+/// Kahan-Babuska summation, which keeps the error independent of the number of terms.
+struct _CompensatedSum {
+	double sum = 0.0;
+	double compensation = 0.0;
+
+	void add(double value) {
+		double t = sum + value;
+		if (std::abs(sum) >= std::abs(value)) {
+			compensation += (sum - t) + value;
+		} else {
+			compensation += (value - t) + sum;
+		}
+		sum = t;
+	}
+	[[nodiscard]] double get() const {
+		return sum + compensation;
+	}
+};
+
+/// Largest relative error of the stored probabilities that \ref verifyAliasTable() accepts, a few single precision
+/// rounding steps.
+constexpr double _maxOriProbError = 1e-6;
+
+[[nodiscard]] double _getWeight(std::span<const float> weights, std::size_t i) {
+	return std::max(static_cast<double>(weights[i]), 0.0);
+}
+
+std::vector<shader::aliasTableColumn> buildAliasTable(std::span<const float> weights) {
+	std::size_t count = weights.size();
+	std::vector<shader::aliasTableColumn> result(count);
+	if (count == 0) {
+		return result;
+	}
+	std::size_t numChunks = ceilDiv(count, _aliasTableEntriesPerChunk);
+	auto getChunkEnd = [&](std::size_t chunk) {
+		return std::min((chunk + 1) * _aliasTableEntriesPerChunk, count);
+	};
+
+	// the sums of the chunks are added in a fixed order, so the total does not depend on the scheduling
+	std::vector<double> chunkSums(numChunks);
+	parallelFor(numChunks, [&](std::size_t chunk) {
+		_CompensatedSum sum;
+		for (std::size_t i = chunk * _aliasTableEntriesPerChunk; i < getChunkEnd(chunk); ++i) {
+			sum.add(_getWeight(weights, i));
+		}
+		chunkSums[chunk] = sum.get();
+	});
+	_CompensatedSum totalSum;
+	for (double sum : chunkSums) {
+		totalSum.add(sum);
+	}
+	double total = totalSum.get();
+
+	if (!(total > 0.0) || !std::isfinite(total)) {
+		float uniform = 1.0f / static_cast<float>(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			result[i] = shader::aliasTableColumn{
+				.prob = 1.0f, .alias = static_cast<int>(i), .oriProb = uniform, .aliasOriProb = uniform
+			};
+		}
+		return result;
+	}
+	// weights scaled so that they average to one; entries below one are light, the others are heavy
+	double scale = static_cast<double>(count) / total;
+
+	// Partition the entries into light and heavy ones, keeping their order. Along the way, compute the prefix sums of
+	// the deficits of the light entries and of the excesses of the heavy entries, first within every chunk.
+	std::vector<std::size_t> chunkLightCounts(numChunks);
+	parallelFor(numChunks, [&](std::size_t chunk) {
+		std::size_t numLight = 0;
+		for (std::size_t i = chunk * _aliasTableEntriesPerChunk; i < getChunkEnd(chunk); ++i) {
+			numLight += _getWeight(weights, i) * scale < 1.0 ? 1 : 0;
+		}
+		chunkLightCounts[chunk] = numLight;
+	});
+	std::vector<std::size_t> lightOffsets(numChunks + 1, 0), heavyOffsets(numChunks + 1, 0);
+	for (std::size_t chunk = 0; chunk < numChunks; ++chunk) {
+		std::size_t chunkSize = getChunkEnd(chunk) - chunk * _aliasTableEntriesPerChunk;
+		lightOffsets[chunk + 1] = lightOffsets[chunk] + chunkLightCounts[chunk];
+		heavyOffsets[chunk + 1] = heavyOffsets[chunk] + (chunkSize - chunkLightCounts[chunk]);
+	}
+	std::size_t numLight = lightOffsets[numChunks];
+	std::size_t numHeavy = heavyOffsets[numChunks];
+
+	std::vector<uint32_t> lights(numLight), heavies(numHeavy);
+	// lightPrefix[i] is the total deficit of the light entries before i, heavyPrefix[j] the total excess of the heavy
+	// entries up to and including j
+	std::vector<double> lightPrefix(numLight + 1), heavyPrefix(numHeavy);
+	std::vector<double> chunkDeficits(numChunks), chunkExcesses(numChunks);
+	parallelFor(numChunks, [&](std::size_t chunk) {
+		std::size_t lightIndex = lightOffsets[chunk];
+		std::size_t heavyIndex = heavyOffsets[chunk];
+		double deficit = 0.0, excess = 0.0;
+		for (std::size_t i = chunk * _aliasTableEntriesPerChunk; i < getChunkEnd(chunk); ++i) {
+			double weight = _getWeight(weights, i);
+			double scaled = weight * scale;
+			result[i].oriProb = static_cast<float>(weight / total);
+			if (scaled < 1.0) {
+				lights[lightIndex] = static_cast<uint32_t>(i);
+				lightPrefix[lightIndex] = deficit;
+				deficit += 1.0 - scaled;
+				++lightIndex;
+			} else {
+				excess += scaled - 1.0;
+				heavies[heavyIndex] = static_cast<uint32_t>(i);
+				heavyPrefix[heavyIndex] = excess;
+				++heavyIndex;
+			}
+		}
+		chunkDeficits[chunk] = deficit;
+		chunkExcesses[chunk] = excess;
+	});
+	double deficitBase = 0.0, excessBase = 0.0;
+	for (std::size_t chunk = 0; chunk < numChunks; ++chunk) {
+		double deficit = chunkDeficits[chunk], excess = chunkExcesses[chunk];
+		chunkDeficits[chunk] = deficitBase;
+		chunkExcesses[chunk] = excessBase;
+		deficitBase += deficit;
+		excessBase += excess;
+	}
+	lightPrefix[numLight] = deficitBase;
+	parallelFor(numChunks, [&](std::size_t chunk) {
+		for (std::size_t i = lightOffsets[chunk]; i < lightOffsets[chunk + 1]; ++i) {
+			lightPrefix[i] += chunkDeficits[chunk];
+		}
+		for (std::size_t j = heavyOffsets[chunk]; j < heavyOffsets[chunk + 1]; ++j) {
+			heavyPrefix[j] += chunkExcesses[chunk];
+		}
+	});
+
+	if (numHeavy == 0) { // only possible through rounding, when all weights are nearly equal
+		for (std::size_t i = 0; i < count; ++i) {
+			result[i].prob = 1.0f;
+			result[i].alias = static_cast<int>(i);
+		}
+	} else {
+		// The sequential sweep fills light entries from the current heavy entry, whose remaining weight is
+		// 1 + heavyPrefix[j] - lightPrefix[i] after i light entries. The heavy entry is finished, and moves its deficit
+		// on to the next heavy one, once that drops to one or below. This visits the entries in the order of a merge
+		// of the two prefix sums, in which the last heavy entry comes after all light ones.
+		auto isLightFirst = [&](std::size_t i, std::size_t j) {
+			return j + 1 == numHeavy || lightPrefix[i] < heavyPrefix[j];
+		};
+		// finds the number of light entries among the first c entries of the merge
+		auto findMergePath = [&](std::size_t c) {
+			std::size_t low = c > numHeavy ? c - numHeavy : 0;
+			std::size_t high = std::min(c, numLight);
+			while (low < high) {
+				std::size_t i = (low + high) / 2;
+				if (isLightFirst(i, c - i - 1)) {
+					low = i + 1;
+				} else {
+					high = i;
+				}
+			}
+			return low;
+		};
+
+		std::size_t numRanges = ceilDiv(count, _aliasTableEntriesPerChunk);
+		parallelFor(numRanges, [&](std::size_t range) {
+			std::size_t begin = range * _aliasTableEntriesPerChunk;
+			std::size_t end = std::min(begin + _aliasTableEntriesPerChunk, count);
+			std::size_t i = findMergePath(begin);
+			std::size_t j = begin - i;
+			for (std::size_t c = begin; c < end; ++c) {
+				if (i < numLight && isLightFirst(i, j)) {
+					shader::aliasTableColumn &column = result[lights[i]];
+					column.prob = static_cast<float>(_getWeight(weights, lights[i]) * scale);
+					column.alias = static_cast<int>(heavies[j]);
+					++i;
+				} else {
+					shader::aliasTableColumn &column = result[heavies[j]];
+					if (j + 1 == numHeavy) {
+						column.prob = 1.0f;
+						column.alias = static_cast<int>(heavies[j]);
+					} else {
+						double remaining = 1.0 + heavyPrefix[j] - lightPrefix[i];
+						column.prob = static_cast<float>(std::clamp(remaining, 0.0, 1.0));
+						column.alias = static_cast<int>(heavies[j + 1]);
+					}
+					++j;
+				}
+			}
+		});
+	}
+
+	parallelFor(numChunks, [&](std::size_t chunk) {
+		for (std::size_t i = chunk * _aliasTableEntriesPerChunk; i < getChunkEnd(chunk); ++i) {
+			result[i].aliasOriProb = result[result[i].alias].oriProb;
+		}
+	});
+	return result;
+}
+
+AliasTableVerification verifyAliasTable(
+	std::span<const shader::aliasTableColumn> table, std::span<const float> weights, double tolerance
+) {
+	AliasTableVerification result;
+	std::size_t count = weights.size();
+	if (table.size() != count) {
+		return result;
+	}
+	if (count == 0) {
+		result.valid = true;
+		return result;
+	}
+
+	_CompensatedSum totalSum;
+	for (std::size_t i = 0; i < count; ++i) {
+		totalSum.add(_getWeight(weights, i));
+	}
+	double total = totalSum.get();
+	auto getExpected = [&](std::size_t i) {
+		return total > 0.0 ? _getWeight(weights, i) / total : 1.0 / static_cast<double>(count);
+	};
+
+	bool wellFormed = true;
+	std::vector<double> implied(count, 0.0);
+	double uniform = 1.0 / static_cast<double>(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		const shader::aliasTableColumn &column = table[i];
+		if (
+			column.alias < 0 || static_cast<std::size_t>(column.alias) >= count ||
+			!(column.prob >= 0.0f && column.prob <= 1.0f)
+		) {
+			wellFormed = false;
+			continue;
+		}
+		implied[i] += uniform * column.prob;
+		implied[column.alias] += uniform * (1.0 - column.prob);
+		auto getRelativeError = [](double value, double expected) {
+			return expected > 0.0 ? std::abs(value - expected) / expected : std::abs(value);
+		};
+		result.maxOriProbError = std::max({
+			result.maxOriProbError,
+			getRelativeError(column.oriProb, getExpected(i)),
+			getRelativeError(column.aliasOriProb, getExpected(column.alias))
+		});
+	}
+
+	_CompensatedSum distance;
+	for (std::size_t i = 0; i < count; ++i) {
+		double error = std::abs(implied[i] - getExpected(i));
+		result.maxAbsoluteError = std::max(result.maxAbsoluteError, error);
+		distance.add(error);
+	}
+	result.totalVariationDistance = 0.5 * distance.get();
+	// errors are measured relative to the probability of a uniform distribution, which shrinks with the count
+	result.valid =
+		wellFormed &&
+		result.maxAbsoluteError * static_cast<double>(count) <= tolerance &&
+		result.maxOriProbError <= _maxOriProbError;
+	return result;
+}
+
+
+/// The single-threaded builder that \ref buildAliasTable() replaced: Vose's method with queues and a single precision
+/// sum. Kept as the baseline of \ref runAliasTableBenchmark().
+[[nodiscard]] std::vector<shader::aliasTableColumn> _buildAliasTableSequential(std::vector<float> weights) {
+	std::queue<int> bigger, smaller;
+	float sum = 0.0f;
+	for (float weight : weights) {
+		sum += weight;
+	}
+	std::vector<shader::aliasTableColumn> result(
+		weights.size(), shader::aliasTableColumn{ .prob = 0.f, .alias = -1, .oriProb = 0.f, .aliasOriProb = 0.f }
+	);
+	for (std::size_t i = 0; i < weights.size(); ++i) {
+		result[i].oriProb = weights[i] / sum;
+		weights[i] = static_cast<float>(weights.size()) * weights[i] / sum;
+		(weights[i] >= 1.0f ? bigger : smaller).push(static_cast<int>(i));
+	}
+	while (!bigger.empty() && !smaller.empty()) {
+		int g = bigger.front(), l = smaller.front();
+		bigger.pop();
+		smaller.pop();
+		result[l].prob = weights[l];
+		result[l].alias = g;
+		weights[g] = (weights[g] + weights[l]) - 1.0f;
+		(weights[g] < 1.0f ? smaller : bigger).push(g);
+	}
+	for (std::queue<int> *queue : { &bigger, &smaller }) {
+		for (; !queue->empty(); queue->pop()) {
+			result[queue->front()].prob = 1.0f;
+			result[queue->front()].alias = queue->front();
+		}
+	}
+	for (shader::aliasTableColumn &column : result) {
+		column.aliasOriProb = result[column.alias].oriProb;
+	}
+	return result;
+}
+
+void runAliasTableBenchmark(std::size_t maxCount) {
+	std::mt19937 random(0);
+	// heavy tailed, like the power of the lights of a scene
+	std::lognormal_distribution<float> power(0.0f, 2.0f);
+
+	std::cout << "Alias table benchmark:\n";
+	for (std::size_t count = 1000; count <= maxCount; count *= 10) {
+		std::vector<float> weights(count);
+		for (float &weight : weights) {
+			weight = power(random);
+		}
+
+		auto measure = [&](auto build) {
+			auto begin = std::chrono::high_resolution_clock::now();
+			std::vector<shader::aliasTableColumn> table = build();
+			double milliseconds =
+				std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+			return std::make_pair(milliseconds, verifyAliasTable(table, weights));
+		};
+		auto [parallelTime, parallel] = measure([&]() {
+			return buildAliasTable(weights);
+		});
+		auto [sequentialTime, sequential] = measure([&]() {
+			return _buildAliasTableSequential(weights);
+		});
+
+		auto print = [&](const char *name, double milliseconds, const AliasTableVerification &verification) {
+			std::cout <<
+				"        " << name << ": " << milliseconds << " ms, max error " <<
+				verification.maxAbsoluteError * static_cast<double>(count) << " / N, total variation distance " <<
+				verification.totalVariationDistance << (verification.valid ? "" : " (FAILED)") << "\n";
+		};
+		std::cout << "    " << count << " weights:\n";
+		print("parallel", parallelTime, parallel);
+		print("sequential", sequentialTime, sequential);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "shaderIncludes.h"
+
+/// Builds an alias table that selects each index with a probability proportional to the given weight, on all hardware
+/// threads. Weights are normalized in double precision, and the table is built with the parallel sweep of Hübschle-
+/// Schneider and Sanders: the sequential sweep over light and heavy entries is a merge of their prefix sums, so it is
+/// split into independent ranges with merge path searches. The result does not depend on the number of threads. If
+/// all weights are zero, every index is selected with the same probability.
+[[nodiscard]] std::vector<shader::aliasTableColumn> buildAliasTable(std::span<const float> weights);
+
+/// Result of \ref verifyAliasTable().
+struct AliasTableVerification {
+	bool valid = false; ///< Whether all columns are well formed and the errors are below the tolerance.
+	double maxAbsoluteError = 0.0; ///< Largest difference between an implied and an expected probability.
+	double totalVariationDistance = 0.0; ///< Half the sum of the absolute differences.
+	double maxOriProbError = 0.0; ///< Largest relative error of the stored \p oriProb and \p aliasOriProb values.
+};
+/// Computes the distribution that sampling the table implies and compares it to the normalized weights. Also checks
+/// that all aliases are in range and that all probabilities are in [0, 1]. \p tolerance bounds the error of the implied
+/// probabilities relative to 1 / N, for N weights.
+[[nodiscard]] AliasTableVerification verifyAliasTable(
+	std::span<const shader::aliasTableColumn> table, std::span<const float> weights, double tolerance = 1e-4
+);
+
+/// Builds and verifies alias tables for 10^3 to \p maxCount random weights with both \ref buildAliasTable() and the
+/// previous single-threaded builder, and prints the build times and errors.
+void runAliasTableBenchmark(std::size_t maxCount);
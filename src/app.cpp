@@ -1,12 +1,16 @@
 #include "app.h"
 
+#include <chrono>
 #include <cinttypes>
+#include <random>
 #include <sstream>
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 
+#include "taskGraph.h"
+
 VKAPI_ATTR VkBool32 VKAPI_CALL _debugCallback(
 	VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
 	VkDebugUtilsMessageTypeFlagsEXT,
@@ -24,7 +28,9 @@ VKAPI_ATTR VkBool32 VKAPI_CALL _debugCallback(
 	return VK_FALSE;
 }
 
-App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_API, GLFW_NO_API } }) {
+App::App(Settings settings) : _window({ { GLFW_CLIENT_API, GLFW_NO_API } }) {
+	auto startupBegin = std::chrono::high_resolution_clock::now();
+
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	// the callbacks are installed here but they're overriden below, so we still need to manually call those
@@ -48,6 +54,336 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		_camera.recomputeAttributes();
 	}
 
+	// Startup is expressed as a task graph so that independent work overlaps: the scene is parsed while the device is
+	// created, pipelines are compiled on worker threads, and the AABB tree is built while scene textures are uploaded.
+	// Tasks that allocate descriptor sets are pinned to this thread since descriptor pools are externally
+	// synchronized, and so is everything that touches GLFW or ImGui.
+	TaskGraph startup;
+	using Affinity = TaskGraph::Affinity;
+
+	// must be set before any pass creates its pipelines
+	SdfSpecialization::set(settings.sdfParameters);
+	_foldSteps = settings.sdfParameters.fold.steps;
+	_foldFloor = settings.sdfParameters.fold.floor;
+	_sphereTraceStatistics = settings.sdfParameters.sphereTraceStatistics;
+	_sphereTraceRelaxation = settings.sphereTraceRelaxation;
+	_sdfLodPixels = settings.sdfLodPixels;
+	_gBufferResources.coneTileSize = settings.conePrepassTileSize;
+	_useConePrepass = settings.conePrepassTileSize > 0;
+	_useComputeGBuffer = settings.computeGBuffer;
+
+	// scene resources that no pass reads are skipped entirely; the corresponding tasks below become no-ops
+	_sceneResourceUsage = settings.loadFullScene ? SceneResourceUsage::all() : _collectSceneResourceUsage();
+	TaskGraph::TaskId sceneLoaded = startup.addTask("load scene", [&]() {
+		if (settings.scene.empty()) {
+			std::cout << "No scene specified\n";
+			return;
+		}
+		if (!_sceneResourceUsage.needsScene()) {
+			std::cout <<
+				"Not loading " << settings.scene << ": no pass reads scene resources (use -load_full_scene to force)\n";
+			return;
+		}
+		// emissive textures are integrated into the power of the triangle lights
+		loadScene(
+			settings.scene, _gltfScene,
+			_sceneResourceUsage.textures || _sceneResourceUsage.lights || _sceneResourceUsage.lightTree
+		);
+		if (settings.ignorePointLights) {
+			_gltfScene.m_lights.clear();
+		}
+	});
+	TaskGraph::TaskId deviceCreated = startup.addTask("create device", [&]() {
+		_createDevice();
+		PipelineCache::initialize(_device.get(), _physicalDevice, std::move(settings.pipelineCachePath));
+		GBuffer::Formats::initialize(_physicalDevice);
+	}, {}, Affinity::mainThread);
+	TaskGraph::TaskId swapchainCreated = startup.addTask("create swapchain", [this]() {
+		_createSwapchain();
+	}, { deviceCreated }, Affinity::mainThread);
+
+	// passes that are only used by some render paths only create the pipelines of the initially selected path here;
+	// the rest is created by _prepareRenderPath() on demand
+	TaskGraph::TaskId gBufferPassCreated = startup.addTask("create G-buffer pass", [this]() {
+		_gBufferPass = Pass::create<GBufferPass>(_device.get(), _swapchain.getImageExtent());
+	}, { swapchainCreated });
+	TaskGraph::TaskId emissiveSamplePassCreated = startup.addTask("create emissive sample pass", [this]() {
+		_emissiveSamplePass = Pass::create<EmissiveSamplePass>(_device.get());
+	}, { deviceCreated });
+	TaskGraph::TaskId spatialReusePassCreated = startup.addTask("create spatial reuse pass", [this]() {
+		_spatialReusePass = Pass::create<SpatialReusePass>(_device.get());
+		if (!_unbiasedSpatialReuse) {
+			_spatialReusePass.ensurePipelines(_device.get());
+		}
+	}, { deviceCreated });
+	TaskGraph::TaskId restirPassCreated = startup.addTask("create ReSTIR pass", [this]() {
+		_restirPass = Pass::create<RestirPass>(_device.get(), _dynamicDispatcher);
+		_restirPass.prepareRenderPath(_useSoftwareRayTracing(), _device.get(), _allocator, _physicalDevice);
+	}, { deviceCreated });
+	TaskGraph::TaskId unbiasedReusePassCreated = startup.addTask("create unbiased reuse pass", [this]() {
+		_unbiasedReusePass = UnbiasedReusePass::create(_device.get(), _dynamicDispatcher);
+		if (_unbiasedSpatialReuse) {
+			_unbiasedReusePass.prepareRenderPath(_useSoftwareRayTracing(), _device.get(), _allocator, _physicalDevice);
+		}
+	}, { deviceCreated });
+	TaskGraph::TaskId lightingPassCreated = startup.addTask("create lighting pass", [this]() {
+		_lightingPass = Pass::create<LightingPass>(_device.get(), _swapchain.getImageFormat());
+	}, { swapchainCreated });
+	TaskGraph::TaskId imguiPassCreated = startup.addTask("create ImGui pass", [this]() {
+		_imguiPass = Pass::create<ImGuiPass>(_device.get(), _swapchain.getImageFormat());
+		_imguiPass.imageExtent = _swapchain.getImageExtent();
+	}, { swapchainCreated });
+
+	TaskGraph::TaskId descriptorPoolsCreated = startup.addTask("create descriptor pools", [this]() {
+		_createDescriptorPools();
+	}, { deviceCreated, sceneLoaded });
+
+	TaskGraph::TaskId sceneLightsCollected = startup.addTask("collect scene lights", [&]() {
+		if ((_sceneResourceUsage.lights || _sceneResourceUsage.lightTree) && !_gltfScene.m_nodes.empty()) {
+			collectLightsFromScene(
+				_gltfScene, _scenePointLights, _sceneTriangleLights, settings.triangleLightCachePath
+			);
+		}
+	}, { sceneLoaded });
+	TaskGraph::TaskId sceneBuffersCreated = startup.addTask("upload scene buffers", [this]() {
+		if (_sceneResourceUsage.needsSceneBuffers() && !_gltfScene.m_nodes.empty()) {
+			_sceneBuffers = SceneBuffers::create(
+				_gltfScene, _scenePointLights, _sceneTriangleLights,
+				_allocator, _transientCommandBufferPool,
+				_device.get(), _graphicsComputeQueue
+			);
+		}
+	}, { deviceCreated, sceneLoaded, sceneLightsCollected });
+	TaskGraph::TaskId accelerationStructuresBuilt = startup.addTask("build acceleration structures", [this]() {
+#ifndef RENDERDOC_CAPTURE
+		if (_sceneResourceUsage.accelerationStructures && !_gltfScene.m_nodes.empty()) {
+			_sceneRtBuffers = SceneRaytraceBuffers::create(
+				_device.get(), _allocator, _transientCommandBufferPool, _graphicsComputeQueue,
+				_sceneBuffers, _gltfScene, _dynamicDispatcher
+			);
+		}
+#endif
+	}, { sceneBuffersCreated });
+	TaskGraph::TaskId aabbTreeBuilt = startup.addTask("build AABB tree", [this]() {
+		if (_sceneResourceUsage.aabbTree && !_gltfScene.m_nodes.empty()) {
+			_aabbTree = AabbTree::build(_gltfScene);
+		}
+	}, { sceneLoaded });
+	TaskGraph::TaskId aabbTreeUploaded = startup.addTask("upload AABB tree", [this]() {
+		if (!_aabbTree.nodes.empty()) {
+			_aabbTreeBuffers = AabbTreeBuffers::create(_aabbTree, _allocator);
+		}
+	}, { aabbTreeBuilt, deviceCreated });
+	TaskGraph::TaskId lightTreeBuilt = startup.addTask("build light tree", [&]() {
+		if (!_sceneResourceUsage.lightTree) {
+			return;
+		}
+		ProceduralLights &proceduralLights = settings.proceduralLights;
+		if (!_gltfScene.m_nodes.empty()) {
+			proceduralLights.boundsMin = _gltfScene.m_dimensions.min;
+			proceduralLights.boundsMax = _gltfScene.m_dimensions.max;
+			if (proceduralLights.count == 0 && _scenePointLights.empty() && _sceneTriangleLights.empty()) {
+				// so that scenes without lights are lit
+				proceduralLights.count = settings.defaultProceduralLightCount;
+			}
+		} else if (settings.sdfBrickMap) {
+			// without a scene, the lights are spread over the region that the SDF is baked in
+			proceduralLights.boundsMin = settings.sdfBrickMap->boundsMin;
+			proceduralLights.boundsMax = settings.sdfBrickMap->boundsMax;
+		} else {
+			if (proceduralLights.count > 0) {
+				std::cout << "Ignoring " << proceduralLights.count << " procedural lights: they are placed within " <<
+					"the bounds of the scene or of the SDF brick map, and neither is loaded\n";
+			}
+			return;
+		}
+		_lightTree = LightTree::build(_scenePointLights, _sceneTriangleLights, proceduralLights);
+	}, { sceneLightsCollected });
+	TaskGraph::TaskId lightTreeUploaded = startup.addTask("upload light tree", [this]() {
+		// empty buffers are created without a scene so that the descriptor sets are always valid
+		_lightTreeBuffers = LightTreeBuffers::create(
+			_lightTree, _allocator, _transientCommandBufferPool, _graphicsComputeQueue
+		);
+	}, { lightTreeBuilt, deviceCreated });
+	TaskGraph::TaskId sdfBrickMapBaked = startup.addTask("bake SDF brick map", [&]() {
+		if (settings.sdfBrickMap) {
+			_sdfBrickMap = SdfBrickMap::loadOrBake(*settings.sdfBrickMap, settings.sdfBrickMapCachePath);
+		}
+	});
+	TaskGraph::TaskId sdfBrickMapUploaded = startup.addTask("upload SDF brick map", [this]() {
+		// placeholders are created when the brick map is disabled so that the descriptor set is always valid
+		_sdfBrickMapBuffers = SdfBrickMapBuffers::create(
+			_sdfBrickMap, _physicalDevice, _device.get(), _allocator, _transientCommandBufferPool, _graphicsComputeQueue
+		);
+		_useBakedSdf = _sdfBrickMapBuffers.isEnabled();
+		if (!_canUseSdfBrickMap()) {
+			_sdfBrickMapBuffers.setEnabled(false);
+		}
+	}, { sdfBrickMapBaked, deviceCreated });
+
+	TaskGraph::TaskId emissiveSamplePoolBaked = startup.addTask("bake emissive sample pool", [&]() {
+		EmissiveSamplePool::Settings poolSettings;
+		poolSettings.fold = settings.sdfParameters.fold;
+		poolSettings.emissiveIterations = settings.sdfParameters.emissiveIterations;
+		_emissiveSamplePoolCachePath = std::move(settings.emissiveSamplePoolCachePath);
+		_emissiveSamplePool = EmissiveSamplePool::loadOrBake(poolSettings, _emissiveSamplePoolCachePath);
+	});
+
+	TaskGraph::TaskId restirUniformsCreated = startup.addTask("create ReSTIR uniforms", [this]() {
+		_createRestirUniformBuffer();
+	}, { swapchainCreated, lightTreeUploaded });
+	TaskGraph::TaskId gBuffersCreated = startup.addTask("create G-buffers", [this]() {
+		_createGBufferResources();
+	}, { gBufferPassCreated, descriptorPoolsCreated }, Affinity::mainThread);
+	TaskGraph::TaskId emissiveSampleResourcesCreated = startup.addTask("create emissive sample resources", [this]() {
+		_createEmissiveSampleResources();
+	}, {
+		emissiveSamplePassCreated, emissiveSamplePoolBaked, restirUniformsCreated, descriptorPoolsCreated,
+		lightTreeUploaded
+	}, Affinity::mainThread);
+	TaskGraph::TaskId spatialReuseDescriptorsCreated = startup.addTask("create spatial reuse descriptors", [this]() {
+		_createSpatialReuseDescriptors();
+	}, { spatialReusePassCreated, descriptorPoolsCreated }, Affinity::mainThread);
+	TaskGraph::TaskId restirDescriptorsCreated = startup.addTask("create ReSTIR descriptors", [this]() {
+		_createRestirDescriptors();
+	}, { restirPassCreated, descriptorPoolsCreated }, Affinity::mainThread);
+	TaskGraph::TaskId unbiasedReuseDescriptorsCreated = startup.addTask("create unbiased reuse descriptors", [this]() {
+		_createUnbiasedReuseDescriptors();
+	}, { unbiasedReusePassCreated, descriptorPoolsCreated }, Affinity::mainThread);
+	TaskGraph::TaskId sdfBrickMapDescriptorCreated = startup.addTask("create SDF brick map descriptor", [this]() {
+		_createSdfBrickMapDescriptor();
+	}, { sdfBrickMapUploaded, gBufferPassCreated, descriptorPoolsCreated }, Affinity::mainThread);
+
+	TaskGraph::TaskId restirBuffersCreated = startup.addTask("create reservoir buffers", [this]() {
+		_updateRestirBuffers();
+	}, {
+		gBuffersCreated, emissiveSampleResourcesCreated, spatialReuseDescriptorsCreated, restirDescriptorsCreated,
+		unbiasedReuseDescriptorsCreated, accelerationStructuresBuilt, aabbTreeUploaded, lightTreeUploaded
+	}, Affinity::mainThread);
+	TaskGraph::TaskId lightingPassResourcesCreated = startup.addTask("create lighting pass resources", [this]() {
+		_createLightingPassResources();
+	}, { lightingPassCreated, restirBuffersCreated }, Affinity::mainThread);
+	TaskGraph::TaskId imguiInitialized = startup.addTask("initialize ImGui", [this]() {
+		_initializeImGui();
+	}, { imguiPassCreated, descriptorPoolsCreated }, Affinity::mainThread);
+
+	startup.addTask("record command buffers", [this]() {
+		_createMainCommandBuffers();
+		_createSynchronizationObjects();
+	}, {
+		lightingPassResourcesCreated, imguiInitialized, sdfBrickMapDescriptorCreated
+	}, Affinity::mainThread);
+
+	startup.run();
+	startup.printReport();
+	PipelineCache::printStatistics();
+
+	_printMemoryReport("after upload");
+	_releaseSceneHostData();
+	_printMemoryReport("after releasing host copies");
+
+	std::cout <<
+		"Startup took " <<
+		std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startupBegin).count() <<
+		" ms\n";
+}
+
+App::~App() {
+	_device->waitIdle();
+	PipelineCache::saveAndDestroy();
+
+	ImGui_ImplVulkan_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+}
+
+bool App::validateSdf(uint32_t pointCount) {
+	// points whose distances differ by more than this are counted as mismatches; they occur where the GPU and the CPU
+	// round a point into different fold cells
+	constexpr float distanceTolerance = 0.01f;
+	constexpr float materialTolerance = 0.001f;
+	constexpr double maxMismatchFraction = 0.001;
+
+	SdfValidationPass pass = Pass::create<SdfValidationPass>(_device.get());
+
+	vma::UniqueBuffer points = _allocator.createTypedBuffer<nvmath::vec4f>(
+		pointCount, vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU
+	);
+	vma::UniqueBuffer results = _allocator.createTypedBuffer<shader::SdfValidationResult>(
+		pointCount, vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_GPU_TO_CPU
+	);
+	std::vector<nvmath::vec3f> cpuPoints(pointCount);
+	{
+		std::mt19937 random(0);
+		std::uniform_real_distribution<float> coordinate(-256.0f, 256.0f);
+		auto *mapped = points.mapAs<nvmath::vec4f>();
+		for (uint32_t i = 0; i < pointCount; ++i) {
+			cpuPoints[i] = nvmath::vec3f(coordinate(random), coordinate(random), coordinate(random));
+			mapped[i] = nvmath::vec4f(cpuPoints[i], 1.0f);
+		}
+		points.unmap();
+		points.flush();
+	}
+
+	vk::DescriptorSetLayout setLayout = pass.getDescriptorSetLayout();
+	vk::DescriptorSetAllocateInfo allocInfo;
+	allocInfo
+		.setDescriptorPool(_staticDescriptorPool.get())
+		.setSetLayouts(setLayout);
+	vk::UniqueDescriptorSet descriptorSet = std::move(_device->allocateDescriptorSetsUnique(allocInfo)[0]);
+	pass.initializeDescriptorSet(points.get(), results.get(), _device.get(), descriptorSet.get());
+	pass.descriptorSet = descriptorSet.get();
+	pass.pointCount = pointCount;
+	{
+		TransientCommandBuffer cmdBuf = _transientCommandBufferPool.begin(_graphicsComputeQueue);
+		pass.issueCommands(cmdBuf.get(), nullptr);
+	}
+
+	const SdfSpecialization::Parameters &params = SdfSpecialization::getParameters();
+	float maxDistanceError = 0.0f, maxMaterialError = 0.0f;
+	uint32_t distanceMismatches = 0, materialMismatches = 0;
+	results.invalidate();
+	const auto *gpuResults = results.mapAs<shader::SdfValidationResult>();
+	for (uint32_t i = 0; i < pointCount; ++i) {
+		nvmath::vec2f distMat = sdf::getDistMat(cpuPoints[i], params.fold);
+		const shader::SdfValidationResult &gpu = gpuResults[i];
+
+		float distanceError = std::abs(distMat.x - gpu.distMat.x);
+		if (distanceError > distanceTolerance || distMat.y != gpu.distMat.y) {
+			++distanceMismatches;
+			continue;
+		}
+		maxDistanceError = std::max(maxDistanceError, distanceError);
+
+		sdf::Material material = sdf::getMaterial(distMat.y, params.fold, params.emissiveIterations);
+		float materialError = std::max({
+			std::abs(material.albedo.x - gpu.albedoRoughness.x),
+			std::abs(material.albedo.y - gpu.albedoRoughness.y),
+			std::abs(material.albedo.z - gpu.albedoRoughness.z),
+			std::abs(material.roughness - gpu.albedoRoughness.w),
+			std::abs(material.emission.x - gpu.emissionMetallic.x),
+			std::abs(material.emission.y - gpu.emissionMetallic.y),
+			std::abs(material.emission.z - gpu.emissionMetallic.z),
+			std::abs(material.metallic - gpu.emissionMetallic.w)
+		});
+		if (materialError > materialTolerance) {
+			++materialMismatches;
+		}
+		maxMaterialError = std::max(maxMaterialError, materialError);
+	}
+	results.unmap();
+
+	double mismatchFraction =
+		static_cast<double>(distanceMismatches + materialMismatches) / static_cast<double>(std::max(pointCount, 1u));
+	bool passed = mismatchFraction <= maxMismatchFraction;
+	std::cout <<
+		"SDF validation against the GPU at " << pointCount << " points: " << (passed ? "passed" : "FAILED") << "\n" <<
+		"    distance: " << distanceMismatches << " mismatches, max error " << maxDistanceError << "\n" <<
+		"    material: " << materialMismatches << " mismatches, max error " << maxMaterialError << "\n";
+	return passed;
+}
+
+void App::_createDevice() {
 	std::vector<const char*> requiredExtensions = glfw::getRequiredInstanceExtensions();
 	requiredExtensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	requiredExtensions.emplace_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
@@ -198,6 +534,8 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		vk::PhysicalDeviceVulkan12Features features12;
 		features10.features
 			.setSamplerAnisotropy(true)
+			.setFragmentStoresAndAtomics(true)
+			.setShaderStorageImageWriteWithoutFormat(true)
 			.setShaderInt64(true);
 		features12
 			.setBufferDeviceAddress(true);
@@ -239,7 +577,6 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		_dynamicDispatcher.init(_device.get());
 	}
 
-
 	_allocator = vma::Allocator::create(vulkanApiVersion, _instance.get(), _physicalDevice, _device.get());
 
 	// create command pools
@@ -252,57 +589,57 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 	}
 	_transientCommandBufferPool = TransientCommandBufferPool(_device.get(), _graphicsComputeQueueIndex);
 
-	{
-		_swapchainSharedQueues = { _graphicsComputeQueueIndex, _presentQueueIndex };
-		vk::SurfaceCapabilitiesKHR capabilities = _physicalDevice.getSurfaceCapabilitiesKHR(_surface.get());
-		vk::SurfaceFormatKHR surfaceFormat = chooseSurfaceFormat(_physicalDevice, _surface.get());
-
-		_swapchainInfo
-			.setSurface(_surface.get())
-			.setMinImageCount(chooseImageCount(capabilities))
-			.setImageFormat(surfaceFormat.format)
-			.setImageColorSpace(surfaceFormat.colorSpace)
-			.setImageExtent(chooseSwapExtent(capabilities, _window))
-			.setPresentMode(choosePresentMode(_physicalDevice, _surface.get()))
-			.setImageArrayLayers(1)
-			.setPreTransform(capabilities.currentTransform)
-			.setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
-			.setClipped(true)
-			.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst);
-
-		if (_graphicsComputeQueueIndex == _presentQueueIndex) {
-			_swapchainInfo.setImageSharingMode(vk::SharingMode::eExclusive);
-		}
-		else {
-			_swapchainInfo
-				.setImageSharingMode(vk::SharingMode::eConcurrent)
-				.setQueueFamilyIndices(_swapchainSharedQueues);
-		}
+	_graphicsComputeQueue = _device->getQueue(_graphicsComputeQueueIndex, 0);
+	_presentQueue = _device->getQueue(_presentQueueIndex, 0);
+}
 
-		_swapchain = Swapchain::create(_device.get(), _swapchainInfo);
+void App::_createSwapchain() {
+	_swapchainSharedQueues = { _graphicsComputeQueueIndex, _presentQueueIndex };
+	vk::SurfaceCapabilitiesKHR capabilities = _physicalDevice.getSurfaceCapabilitiesKHR(_surface.get());
+	vk::SurfaceFormatKHR surfaceFormat = chooseSurfaceFormat(_physicalDevice, _surface.get());
+
+	_swapchainInfo
+		.setSurface(_surface.get())
+		.setMinImageCount(chooseImageCount(capabilities))
+		.setImageFormat(surfaceFormat.format)
+		.setImageColorSpace(surfaceFormat.colorSpace)
+		.setImageExtent(chooseSwapExtent(capabilities, _window))
+		.setPresentMode(choosePresentMode(_physicalDevice, _surface.get()))
+		.setImageArrayLayers(1)
+		.setPreTransform(capabilities.currentTransform)
+		.setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
+		.setClipped(true)
+		.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst);
+
+	if (_graphicsComputeQueueIndex == _presentQueueIndex) {
+		_swapchainInfo.setImageSharingMode(vk::SharingMode::eExclusive);
 	}
-
-	loadScene(scene, _gltfScene);
-	if (ignorePointLights) {
-		_gltfScene.m_lights.clear();
+	else {
+		_swapchainInfo
+			.setImageSharingMode(vk::SharingMode::eConcurrent)
+			.setQueueFamilyIndices(_swapchainSharedQueues);
 	}
 
-	{ // create descriptor pools
-		std::array<vk::DescriptorPoolSize, 6> staticPoolSizes{
-			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 100),
-			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 100),
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 100),
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 100),
-			vk::DescriptorPoolSize(vk::DescriptorType::eAccelerationStructureKHR, 100),
-			vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 100)
-		};
-		vk::DescriptorPoolCreateInfo staticPoolInfo;
-		staticPoolInfo
-			.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
-			.setPoolSizes(staticPoolSizes)
-			.setMaxSets(100);
-		_staticDescriptorPool = _device->createDescriptorPoolUnique(staticPoolInfo);
+	_swapchain = Swapchain::create(_device.get(), _swapchainInfo);
+}
 
+void App::_createDescriptorPools() {
+	std::array<vk::DescriptorPoolSize, 6> staticPoolSizes{
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 100),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 100),
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 100),
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, 100),
+		vk::DescriptorPoolSize(vk::DescriptorType::eAccelerationStructureKHR, 100),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, 100)
+	};
+	vk::DescriptorPoolCreateInfo staticPoolInfo;
+	staticPoolInfo
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+		.setPoolSizes(staticPoolSizes)
+		.setMaxSets(100);
+	_staticDescriptorPool = _device->createDescriptorPoolUnique(staticPoolInfo);
+
+	if (_sceneResourceUsage.textures && !_gltfScene.m_materials.empty()) {
 		std::array<vk::DescriptorPoolSize, 1> texturePoolSizes{
 			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(3 * _gltfScene.m_materials.size()))
 		};
@@ -312,58 +649,34 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 			.setPoolSizes(texturePoolSizes)
 			.setMaxSets(static_cast<uint32_t>(_gltfScene.m_materials.size()));
 		_textureDescriptorPool = _device->createDescriptorPoolUnique(texturePoolInfo);
-
-		// initialize imgui descriptor pool
-		// this is taken from official imgui example at https://github.com/ocornut/imgui/blob/master/examples/example_glfw_vulkan/main.cpp
-		// which is wayyyy overkill, but fuck it - we're not low on memory here
-		constexpr uint32_t imguiDescriptorCount = 1000;
-		std::array<vk::DescriptorPoolSize, 11> imguiPoolSizes{
-			vk::DescriptorPoolSize(vk::DescriptorType::eSampler, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformTexelBuffer, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eStorageTexelBuffer, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBufferDynamic, imguiDescriptorCount),
-			vk::DescriptorPoolSize(vk::DescriptorType::eInputAttachment, imguiDescriptorCount)
-		};
-		vk::DescriptorPoolCreateInfo imguiPoolInfo;
-		imguiPoolInfo
-			.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
-			.setMaxSets(static_cast<uint32_t>(imguiPoolSizes.size() * imguiDescriptorCount))
-			.setPoolSizes(imguiPoolSizes);
-		_imguiDescriptorPool = _device->createDescriptorPoolUnique(imguiPoolInfo);
 	}
 
+	// initialize imgui descriptor pool
+	// this is taken from official imgui example at https://github.com/ocornut/imgui/blob/master/examples/example_glfw_vulkan/main.cpp
+	// which is wayyyy overkill, but fuck it - we're not low on memory here
+	constexpr uint32_t imguiDescriptorCount = 1000;
+	std::array<vk::DescriptorPoolSize, 11> imguiPoolSizes{
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampler, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformTexelBuffer, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageTexelBuffer, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBufferDynamic, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBufferDynamic, imguiDescriptorCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eInputAttachment, imguiDescriptorCount)
+	};
+	vk::DescriptorPoolCreateInfo imguiPoolInfo;
+	imguiPoolInfo
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+		.setMaxSets(static_cast<uint32_t>(imguiPoolSizes.size() * imguiDescriptorCount))
+		.setPoolSizes(imguiPoolSizes);
+	_imguiDescriptorPool = _device->createDescriptorPoolUnique(imguiPoolInfo);
+}
 
-	_graphicsComputeQueue = _device->getQueue(_graphicsComputeQueueIndex, 0);
-	_presentQueue = _device->getQueue(_presentQueueIndex, 0);
-
-
-	_sceneBuffers = SceneBuffers::create(
-		_gltfScene,
-		_allocator, _transientCommandBufferPool,
-		_device.get(), _graphicsComputeQueue
-	);
-#ifndef RENDERDOC_CAPTURE
-	_sceneRtBuffers = SceneRaytraceBuffers::create(
-		_device.get(), _allocator, _transientCommandBufferPool, _graphicsComputeQueue,
-		_sceneBuffers, _gltfScene, _dynamicDispatcher
-	);
-#endif
-	std::cout << "Building AABB tree...";
-	_aabbTree = AabbTree::build(_gltfScene);
-	std::cout << " done\n";
-	_aabbTreeBuffers = AabbTreeBuffers::create(_aabbTree, _allocator);
-
-
-	// create g buffer pass
-	GBuffer::Formats::initialize(_physicalDevice);
-	_gBufferPass = Pass::create<GBufferPass>(_device.get(), _swapchain.getImageExtent());
-
+void App::_createGBufferResources() {
 	{
 		_gBufferResources.uniformBuffer = _allocator.createTypedBuffer<GBufferPass::Uniforms>(
 			1, vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU
@@ -376,6 +689,16 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 			.setSetLayouts(gBufferUniformLayout);
 		_gBufferResources.uniformDescriptor = std::move(_device->allocateDescriptorSetsUnique(gBufferUniformAlloc)[0]);
 	}
+	{
+		std::array<vk::DescriptorSetLayout, numGBuffers> setLayouts;
+		std::fill(setLayouts.begin(), setLayouts.end(), _gBufferPass.getFrameDescriptorSetLayout());
+		vk::DescriptorSetAllocateInfo allocInfo;
+		allocInfo
+			.setDescriptorPool(_staticDescriptorPool.get())
+			.setSetLayouts(setLayouts);
+		auto newSets = _device->allocateDescriptorSetsUnique(allocInfo);
+		std::move(newSets.begin(), newSets.end(), _gBufferFrameDescriptors.begin());
+	}
 	{
 		std::array<vk::DescriptorBufferInfo, 1> uniformBufferInfo{
 			vk::DescriptorBufferInfo(_gBufferResources.uniformBuffer.get(), 0, sizeof(GBufferPass::Uniforms))
@@ -389,6 +712,7 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		};
 		_device->updateDescriptorSets(gBufferWrite, {});
 	}
+	_gBufferResources.resizeConePrepass(_allocator, _device.get(), _swapchain.getImageExtent());
 
 	_gBufferPass.descriptorSets = &_gBufferResources;
 
@@ -396,8 +720,10 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		gbuf = GBuffer::create(_allocator, _device.get(), _swapchain.getImageExtent(), _gBufferPass);
 	}
 	_transitionGBufferLayouts();
+	_initializeGBufferFrameDescriptors();
+}
 
-
+void App::_createRestirUniformBuffer() {
 	_restirUniformBuffer = _allocator.createTypedBuffer<shader::RestirUniforms>(
 		1, vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU
 		);
@@ -416,13 +742,36 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		}
 		restirUniforms->spatialNeighbors = 4;
 		restirUniforms->spatialRadius = 30.0f;
-		restirUniforms->sdfParams = nvmath::vec4f(2000.0f, 0.001f, 128.0f, 0.0f);
+		restirUniforms->sdfParams = nvmath::vec4f(2000.0f, 0.001f, 128.0f, _sphereTraceRelaxation);
 		restirUniforms->sdfScene = nvmath::vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+		restirUniforms->lightTiles = nvmath::uvec2(_lightTileCount, _lightTileSize);
+		restirUniforms->regirGrid = nvmath::uvec4(_regirGridCells, _regirCellReservoirs, _regirCellCandidates, 0);
+		restirUniforms->regirCellSize = _regirCellSize;
+		restirUniforms->sceneLightLuminance = _lightTreeBuffers.totalIntensity;
 		_restirUniformBuffer.unmap();
 		_restirUniformBuffer.flush();
 	}
+}
+
+void App::_createSdfBrickMapDescriptor() {
+	// all passes that march the SDF create identical layouts, so this set can be bound to any of them
+	vk::DescriptorSetLayout setLayout = _gBufferPass.getSdfDescriptorSetLayout();
+	vk::DescriptorSetAllocateInfo allocInfo;
+	allocInfo
+		.setDescriptorPool(_staticDescriptorPool.get())
+		.setSetLayouts(setLayout);
+	_sdfBrickMapDescriptor = std::move(_device->allocateDescriptorSetsUnique(allocInfo)[0]);
+
+	_sphereTraceStatisticsBuffer = _allocator.createTypedBuffer<shader::SphereTraceStatistics>(
+		1, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		VMA_MEMORY_USAGE_GPU_TO_CPU
+	);
+	_sdfBrickMapBuffers.initializeDescriptorSet(
+		_device.get(), _sdfBrickMapDescriptor.get(), _sphereTraceStatisticsBuffer.get()
+	);
+}
 
-	_emissiveSamplePass = Pass::create<EmissiveSamplePass>(_device.get());
+void App::_createEmissiveSampleResources() {
 	{
 		vk::DescriptorSetLayout setLayout = _emissiveSamplePass.getDescriptorSetLayout();
 		vk::DescriptorSetAllocateInfo allocInfo;
@@ -441,11 +790,44 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 			VMA_MEMORY_USAGE_GPU_ONLY
 		);
 
-		std::array<vk::DescriptorBufferInfo, 2> bufferInfo{
+		_emissiveSampleCdfBufferSize =
+			alignPreArrayBlock<float, uint32_t[4]>() + sizeof(float) * _emissiveSampleCount;
+		_emissiveSampleCdfBuffer = _allocator.createBuffer(
+			static_cast<uint32_t>(_emissiveSampleCdfBufferSize),
+			vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_GPU_ONLY
+		);
+
+		_lightTileBufferSize = sizeof(shader::PresampledEmissiveSample) * _lightTileCount * _lightTileSize;
+		_lightTileBuffer = _allocator.createBuffer(
+			static_cast<uint32_t>(_lightTileBufferSize),
+			vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_GPU_ONLY
+		);
+
+		_regirGridBufferSize =
+			sizeof(shader::PresampledEmissiveSample) * _regirGridCells * _regirGridCells * _regirGridCells *
+			_regirCellReservoirs;
+		_regirGridBuffer = _allocator.createBuffer(
+			static_cast<uint32_t>(_regirGridBufferSize),
+			vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_GPU_ONLY
+		);
+
+		std::array<vk::DescriptorBufferInfo, 8> bufferInfo{
 			vk::DescriptorBufferInfo(_emissiveSampleBuffer.get(), 0, _emissiveSampleBufferSize),
-			vk::DescriptorBufferInfo(_restirUniformBuffer.get(), 0, sizeof(shader::RestirUniforms))
+			vk::DescriptorBufferInfo(_restirUniformBuffer.get(), 0, sizeof(shader::RestirUniforms)),
+			vk::DescriptorBufferInfo(_emissiveSampleCdfBuffer.get(), 0, _emissiveSampleCdfBufferSize),
+			vk::DescriptorBufferInfo(_lightTileBuffer.get(), 0, _lightTileBufferSize),
+			vk::DescriptorBufferInfo(_regirGridBuffer.get(), 0, _regirGridBufferSize),
+			vk::DescriptorBufferInfo(
+				_lightTreeBuffers.pointLightBuffer.get(), 0, _lightTreeBuffers.pointLightBufferSize
+			),
+			vk::DescriptorBufferInfo(
+				_lightTreeBuffers.triangleLightBuffer.get(), 0, _lightTreeBuffers.triangleLightBufferSize
+			),
+			vk::DescriptorBufferInfo(
+				_lightTreeBuffers.aliasTableBuffer.get(), 0, _lightTreeBuffers.aliasTableBufferSize
+			)
 		};
-		std::array<vk::WriteDescriptorSet, 2> writes{
+		std::array<vk::WriteDescriptorSet, 8> writes{
 			vk::WriteDescriptorSet()
 				.setDstSet(_emissiveSampleDescriptor.get())
 				.setDstBinding(0)
@@ -455,13 +837,95 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 				.setDstSet(_emissiveSampleDescriptor.get())
 				.setDstBinding(1)
 				.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-				.setBufferInfo(bufferInfo[1])
+				.setBufferInfo(bufferInfo[1]),
+			vk::WriteDescriptorSet()
+				.setDstSet(_emissiveSampleDescriptor.get())
+				.setDstBinding(4)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(bufferInfo[2]),
+			vk::WriteDescriptorSet()
+				.setDstSet(_emissiveSampleDescriptor.get())
+				.setDstBinding(5)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(bufferInfo[3]),
+			vk::WriteDescriptorSet()
+				.setDstSet(_emissiveSampleDescriptor.get())
+				.setDstBinding(6)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(bufferInfo[4]),
+			vk::WriteDescriptorSet()
+				.setDstSet(_emissiveSampleDescriptor.get())
+				.setDstBinding(7)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(bufferInfo[5]),
+			vk::WriteDescriptorSet()
+				.setDstSet(_emissiveSampleDescriptor.get())
+				.setDstBinding(8)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(bufferInfo[6]),
+			vk::WriteDescriptorSet()
+				.setDstSet(_emissiveSampleDescriptor.get())
+				.setDstBinding(9)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setBufferInfo(bufferInfo[7])
 		};
 		_device->updateDescriptorSets(writes, {});
 	}
+	_uploadEmissiveSamplePool();
+}
 
+void App::_uploadEmissiveSamplePool() {
+	// at least one element so that the buffers can be created for an empty pool
+	std::size_t poolSize = std::max<std::size_t>(_emissiveSamplePool.samples.size(), 1);
+	_emissiveSamplePoolBufferSize =
+		alignPreArrayBlock<shader::EmissiveSample, uint32_t[4]>() + sizeof(shader::EmissiveSample) * poolSize;
+	_emissiveSamplePoolBuffer = _allocator.createBuffer(
+		static_cast<uint32_t>(_emissiveSamplePoolBufferSize),
+		vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU
+	);
+	_emissiveSamplePoolAliasTableBufferSize =
+		alignPreArrayBlock<shader::aliasTableColumn, uint32_t[4]>() + sizeof(shader::aliasTableColumn) * poolSize;
+	_emissiveSamplePoolAliasTableBuffer = _allocator.createBuffer(
+		static_cast<uint32_t>(_emissiveSamplePoolAliasTableBufferSize),
+		vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU
+	);
 
-	_spatialReusePass = Pass::create<SpatialReusePass>(_device.get());
+	auto *samples = _emissiveSamplePoolBuffer.mapAs<uint32_t>();
+	*samples = static_cast<uint32_t>(_emissiveSamplePool.samples.size());
+	std::memcpy(
+		reinterpret_cast<char*>(samples) + alignPreArrayBlock<shader::EmissiveSample, uint32_t[4]>(),
+		_emissiveSamplePool.samples.data(), sizeof(shader::EmissiveSample) * _emissiveSamplePool.samples.size()
+	);
+	_emissiveSamplePoolBuffer.unmap();
+	_emissiveSamplePoolBuffer.flush();
+
+	auto *aliasTable = _emissiveSamplePoolAliasTableBuffer.mapAs<uint32_t>();
+	*aliasTable = static_cast<uint32_t>(_emissiveSamplePool.aliasTable.size());
+	std::memcpy(
+		reinterpret_cast<char*>(aliasTable) + alignPreArrayBlock<shader::aliasTableColumn, uint32_t[4]>(),
+		_emissiveSamplePool.aliasTable.data(),
+		sizeof(shader::aliasTableColumn) * _emissiveSamplePool.aliasTable.size()
+	);
+	_emissiveSamplePoolAliasTableBuffer.unmap();
+	_emissiveSamplePoolAliasTableBuffer.flush();
+	_emissiveSamplesValid = false;
+
+	std::array<vk::DescriptorBufferInfo, 2> bufferInfo{
+		vk::DescriptorBufferInfo(_emissiveSamplePoolBuffer.get(), 0, _emissiveSamplePoolBufferSize),
+		vk::DescriptorBufferInfo(_emissiveSamplePoolAliasTableBuffer.get(), 0, _emissiveSamplePoolAliasTableBufferSize)
+	};
+	std::array<vk::WriteDescriptorSet, 2> writes;
+	for (std::size_t i = 0; i < writes.size(); ++i) {
+		writes[i]
+			.setDstSet(_emissiveSampleDescriptor.get())
+			.setDstBinding(static_cast<uint32_t>(2 + i))
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(bufferInfo[i]);
+	}
+	_device->updateDescriptorSets(writes, {});
+}
+
+void App::_createSpatialReuseDescriptors() {
 	{
 		std::array<vk::DescriptorSetLayout, numGBuffers> setLayouts;
 		std::fill(setLayouts.begin(), setLayouts.end(), _spatialReusePass.getDescriptorSetLayout());
@@ -483,13 +947,9 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		std::move(newSets.begin(), newSets.end(), _spatialReuseSecondDescriptors.begin());
 	}
 	_spatialReusePass.screenSize = _swapchain.getImageExtent();
+}
 
-
-	// Hardware RT pass for visibility test
-	_restirPass = Pass::create<RestirPass>(_device.get(), _dynamicDispatcher);
-#ifndef RENDERDOC_CAPTURE
-	_restirPass.createShaderBindingTable(_device.get(), _allocator, _physicalDevice);
-#endif
+void App::_createRestirDescriptors() {
 	{
 		std::array<vk::DescriptorSetLayout, numGBuffers> setLayouts;
 		std::fill(setLayouts.begin(), setLayouts.end(), _restirPass.getFrameDescriptorSetLayout());
@@ -526,13 +986,10 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 			.setSetLayouts(setLayout);
 		_restirSoftwareRayTraceDescriptor = std::move(_device->allocateDescriptorSetsUnique(allocInfo)[0]);
 	}
+}
 
-
-	_unbiasedReusePass = UnbiasedReusePass::create(_device.get(), _dynamicDispatcher);
+void App::_createUnbiasedReuseDescriptors() {
 	_unbiasedReusePass.setDispatchLoaderDynamic(_dynamicDispatcher);
-#ifndef RENDERDOC_CAPTURE
-	_unbiasedReusePass.createShaderBindingTable(_device.get(), _allocator, _physicalDevice, _dynamicDispatcher);
-#endif
 	{
 		std::array<vk::DescriptorSetLayout, numGBuffers> setLayouts;
 		std::fill(setLayouts.begin(), setLayouts.end(), _unbiasedReusePass.getFrameDescriptorSetLayout());
@@ -561,12 +1018,9 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 			.setSetLayouts(setLayout);
 		_unbiasedReusePassSwRaytraceDescriptors = std::move(_device->allocateDescriptorSetsUnique(allocInfo)[0]);
 	}
+}
 
-	_updateRestirBuffers();
-
-
-	// create lighting pass
-	_lightingPass = Pass::create<LightingPass>(_device.get(), _swapchain.getImageFormat());
+void App::_createLightingPassResources() {
 	_lightingPassUniformBuffer = _allocator.createTypedBuffer<shader::LightingPassUniforms>(
 		1, vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU
 		);
@@ -583,12 +1037,9 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 	_initializeLightingPassResources();
 
 	_lightingPass.imageExtent = _swapchain.getImageExtent();
+}
 
-
-	_imguiPass = Pass::create<ImGuiPass>(_device.get(), _swapchain.getImageFormat());
-	_imguiPass.imageExtent = _swapchain.getImageExtent();
-
-	// finish initializing imgui
+void App::_initializeImGui() {
 	{
 		ImGui_ImplVulkan_InitInfo imguiInit{};
 		imguiInit.Instance = _instance.get();
@@ -605,7 +1056,9 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 		TransientCommandBuffer cmdBuffer = _transientCommandBufferPool.begin(_graphicsComputeQueue);
 		ImGui_ImplVulkan_CreateFontsTexture(cmdBuffer.get());
 	}
+}
 
+void App::_createMainCommandBuffers() {
 	{ // create main command buffers
 		vk::CommandBufferAllocateInfo bufferInfo;
 		bufferInfo
@@ -617,9 +1070,9 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 	}
 	_recordMainCommandBuffers();
 	_createSwapchainBuffers();
+}
 
-
-	// semaphores & fences
+void App::_createSynchronizationObjects() {
 	_imageAvailableSemaphore.resize(maxFramesInFlight);
 	_computeFinishedSemaphore.resize(maxFramesInFlight);
 	_renderFinishedSemaphore.resize(maxFramesInFlight);
@@ -645,12 +1098,81 @@ App::App(std::string scene, bool ignorePointLights) : _window({ { GLFW_CLIENT_AP
 	}
 }
 
-App::~App() {
-	_device->waitIdle();
+void App::_releaseSceneHostData() {
+	// vertex attributes have been copied into the scene buffers, acceleration structures and the AABB tree
+	std::vector<nvmath::vec3f>().swap(_gltfScene.m_positions);
+	std::vector<uint32_t>().swap(_gltfScene.m_indices);
+	std::vector<nvmath::vec3f>().swap(_gltfScene.m_normals);
+	std::vector<nvmath::vec4f>().swap(_gltfScene.m_tangents);
+	std::vector<nvmath::vec2f>().swap(_gltfScene.m_texcoords0);
+	std::vector<nvmath::vec2f>().swap(_gltfScene.m_texcoords1);
+	std::vector<nvmath::vec4f>().swap(_gltfScene.m_colors0);
+	// emissive images have been integrated into the triangle lights
+	std::vector<tinygltf::Image>().swap(_gltfScene.m_textures);
+
+	std::vector<shader::pointLight>().swap(_scenePointLights);
+	std::vector<shader::triLight>().swap(_sceneTriangleLights);
+	_aabbTree.releaseHostData();
+	_lightTree.releaseHostData();
+	_sdfBrickMap.releaseHostData();
+}
 
-	ImGui_ImplVulkan_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
-	ImGui::DestroyContext();
+void App::_printMemoryReport(std::string_view title) const {
+	std::size_t sceneHostBytes =
+		MemoryReport::hostBytes(_gltfScene.m_materials) + MemoryReport::hostBytes(_gltfScene.m_nodes) +
+		MemoryReport::hostBytes(_gltfScene.m_primMeshes) + MemoryReport::hostBytes(_gltfScene.m_cameras) +
+		MemoryReport::hostBytes(_gltfScene.m_lights) + MemoryReport::hostBytes(_gltfScene.m_textures) +
+		MemoryReport::hostBytes(_gltfScene.m_positions) + MemoryReport::hostBytes(_gltfScene.m_indices) +
+		MemoryReport::hostBytes(_gltfScene.m_normals) + MemoryReport::hostBytes(_gltfScene.m_tangents) +
+		MemoryReport::hostBytes(_gltfScene.m_texcoords0) + MemoryReport::hostBytes(_gltfScene.m_texcoords1) +
+		MemoryReport::hostBytes(_gltfScene.m_colors0);
+	for (const tinygltf::Image &image : _gltfScene.m_textures) {
+		sceneHostBytes += MemoryReport::hostBytes(image.image);
+	}
+
+	vk::DeviceSize gBufferBytes = 0;
+	for (const GBuffer &gbuf : _gBuffers) {
+		gBufferBytes += gbuf.getDeviceMemorySize();
+	}
+	gBufferBytes += _gBufferResources.coneStartDistance.getAllocationSize();
+	vk::DeviceSize reservoirBytes = _reservoirTemporaryBuffer.getAllocationSize();
+	for (const vma::UniqueBuffer &buffer : _reservoirBuffers) {
+		reservoirBytes += buffer.getAllocationSize();
+	}
+
+	MemoryReport report;
+	report.add("glTF scene", sceneHostBytes, 0);
+	report.add("scene buffers", 0, _sceneBuffers.getDeviceMemorySize());
+	report.add("acceleration structures", 0, _sceneRtBuffers.getDeviceMemorySize());
+	report.add(
+		"AABB tree",
+		MemoryReport::hostBytes(_aabbTree.nodes) + MemoryReport::hostBytes(_aabbTree.triangles),
+		_aabbTreeBuffers.getDeviceMemorySize()
+	);
+	report.add(
+		"light tree",
+		MemoryReport::hostBytes(_lightTree.nodes) + MemoryReport::hostBytes(_lightTree.pointLights) +
+		MemoryReport::hostBytes(_lightTree.triangleLights) + MemoryReport::hostBytes(_lightTree.aliasTable),
+		_lightTreeBuffers.getDeviceMemorySize()
+	);
+	report.add("G-buffers", 0, gBufferBytes);
+	report.add("reservoirs", 0, reservoirBytes);
+	report.add(
+		"emissive samples", 0, _emissiveSampleBuffer.getAllocationSize() + _emissiveSampleCdfBuffer.getAllocationSize()
+	);
+	report.add("light tiles", 0, _lightTileBuffer.getAllocationSize());
+	report.add("ReGIR grid", 0, _regirGridBuffer.getAllocationSize());
+	report.add(
+		"emissive sample pool",
+		MemoryReport::hostBytes(_emissiveSamplePool.samples) + MemoryReport::hostBytes(_emissiveSamplePool.aliasTable),
+		_emissiveSamplePoolBuffer.getAllocationSize() + _emissiveSamplePoolAliasTableBuffer.getAllocationSize()
+	);
+	report.add(
+		"SDF brick map",
+		MemoryReport::hostBytes(_sdfBrickMap.cells) + MemoryReport::hostBytes(_sdfBrickMap.brickSamples),
+		_sdfBrickMapBuffers.getDeviceMemorySize()
+	);
+	report.print(title);
 }
 
 void App::updateGui() {
@@ -675,6 +1197,38 @@ void App::updateGui() {
 	ImGui::Separator();
 
 	ImGui::SliderInt("Initial Light Samples (log2)", &_log2InitialLightSamples, 0, 10);
+	_commandBuffersOutdated = ImGui::Checkbox("Presampled Light Tiles", &_useLightTiles) || _commandBuffersOutdated;
+	ImGui::Checkbox("Light Tree Candidates", &_useLightTree);
+	_commandBuffersOutdated = ImGui::Checkbox("ReGIR Grid", &_useRegir) || _commandBuffersOutdated;
+	ImGui::SliderFloat("ReGIR Cell Size", &_regirCellSize, 1.0f, 64.0f);
+
+	ImGui::Separator();
+
+	// a new fold rebakes the emissive sample pool and recompiles pipelines, so it is only applied once a slider is
+	// released
+	ImGui::SliderInt("Fold Steps", &_foldSteps, 1, 32);
+	_sdfParametersChanged = ImGui::IsItemDeactivatedAfterEdit() || _sdfParametersChanged;
+	ImGui::SliderFloat("Fold Floor", &_foldFloor, 0.1f, 16.0f);
+	_sdfParametersChanged = ImGui::IsItemDeactivatedAfterEdit() || _sdfParametersChanged;
+	if (_canUseSdfBrickMap()) {
+		_viewParamChanged = ImGui::Checkbox("Use Baked SDF", &_useBakedSdf) || _viewParamChanged;
+	}
+	if (_gBufferResources.coneTileSize > 0 && ImGui::Checkbox("Cone Prepass", &_useConePrepass)) {
+		_viewParamChanged = true;
+		_commandBuffersOutdated = true;
+	}
+	ImGui::Checkbox("Temporal Hit Distance", &_useTemporalHitDistance);
+	ImGui::SliderFloat("Emissive Sample Refresh", &_emissiveSampleRefreshFraction, 0.0f, 1.0f);
+	_commandBuffersOutdated = ImGui::Checkbox("Compute G-Buffer", &_useComputeGBuffer) || _commandBuffersOutdated;
+	_viewParamChanged =
+		ImGui::SliderFloat("Sphere Trace Relaxation", &_sphereTraceRelaxation, 1.0f, 1.9f) || _viewParamChanged;
+	_viewParamChanged = ImGui::SliderFloat("SDF LOD (Pixels)", &_sdfLodPixels, 0.0f, 16.0f) || _viewParamChanged;
+	_sdfParametersChanged =
+		ImGui::Checkbox("Sphere Trace Statistics", &_sphereTraceStatistics) || _sdfParametersChanged;
+	if (_sphereTraceStatistics) {
+		ImGui::LabelText("Steps per Ray (G-Buffer)", "%.2f", _sphereTraceAverageSteps[SPHERE_TRACE_GBUFFER]);
+		ImGui::LabelText("Steps per Ray (Visibility)", "%.2f", _sphereTraceAverageSteps[SPHERE_TRACE_VISIBILITY]);
+	}
 
 	ImGui::Separator();
 
@@ -751,7 +1305,9 @@ void App::mainLoop() {
 			for (GBuffer& gbuf : _gBuffers) {
 				gbuf.resize(_allocator, _device.get(), _swapchain.getImageExtent(), _gBufferPass);
 			}
+			_gBufferResources.resizeConePrepass(_allocator, _device.get(), _swapchain.getImageExtent());
 			_transitionGBufferLayouts();
+			_initializeGBufferFrameDescriptors();
 			_gBufferPass.onResized(_device.get(), _swapchain.getImageExtent());
 
 			auto* restirUniforms = _restirUniformBuffer.mapAs<shader::RestirUniforms>();
@@ -800,6 +1356,9 @@ void App::mainLoop() {
 			while (_device->waitForFences(_mainFence.get(), true, std::numeric_limits<uint64_t>::max()) == vk::Result::eTimeout) {
 			}
 			_device->resetFences(_mainFence.get());
+			if (_sphereTraceStatistics) {
+				_readSphereTraceStatistics();
+			}
 
 			auto* restirUniforms = _restirUniformBuffer.mapAs<shader::RestirUniforms>();
 			++restirUniforms->frame;
@@ -812,6 +1371,51 @@ void App::mainLoop() {
 			} else {
 				restirUniforms->flags &= ~RESTIR_TEMPORAL_REUSE_FLAG;
 			}
+			if (_useLightTiles) {
+				restirUniforms->flags |= RESTIR_LIGHT_TILES_FLAG;
+			} else {
+				restirUniforms->flags &= ~RESTIR_LIGHT_TILES_FLAG;
+			}
+			if (_useLightTree) {
+				restirUniforms->flags |= RESTIR_LIGHT_TREE_FLAG;
+			} else {
+				restirUniforms->flags &= ~RESTIR_LIGHT_TREE_FLAG;
+			}
+			if (_useRegir) {
+				restirUniforms->flags |= RESTIR_REGIR_FLAG;
+			} else {
+				restirUniforms->flags &= ~RESTIR_REGIR_FLAG;
+			}
+			restirUniforms->regirCellSize = _regirCellSize;
+
+			if (_sdfParametersChanged) {
+				// the G-buffer pipeline is baked into the recorded command buffers
+				_device->waitIdle();
+				_respecializeSdfPipelines();
+				_recordMainCommandBuffers();
+				restirUniforms->frame = 0;
+				_gBufferHistoryValid = false;
+				_sdfParametersChanged = false;
+			} else if (_commandBuffersOutdated) {
+				_device->waitIdle();
+				_recordMainCommandBuffers();
+			}
+			_commandBuffersOutdated = false;
+
+			// after the SDF pipelines, which may have rebaked the emissive sample pool
+			uint32_t emissiveSampleRefreshCount = _emissiveSampleCount;
+			if (_emissiveSamplesValid) {
+				emissiveSampleRefreshCount = std::clamp(
+					static_cast<uint32_t>(_emissiveSampleRefreshFraction * static_cast<float>(_emissiveSampleCount)),
+					1u, _emissiveSampleCount
+				);
+			}
+			restirUniforms->emissiveSampleRefresh = nvmath::uvec2(
+				_emissiveSampleRefreshOffset, emissiveSampleRefreshCount
+			);
+			_emissiveSampleRefreshOffset =
+				(_emissiveSampleRefreshOffset + emissiveSampleRefreshCount) % _emissiveSampleCount;
+			_emissiveSamplesValid = true;
 
 			if (_cameraUpdated || _viewParamChanged) {
 				_graphicsComputeQueue.waitIdle();
@@ -822,13 +1426,26 @@ void App::mainLoop() {
 				gBufferUniforms->inverseProjectionMatrix = nvmath::invert(_camera.projectionMatrix);
 				gBufferUniforms->inverseViewMatrix = _camera.inverseViewMatrix;
 				gBufferUniforms->cameraPosition = nvmath::vec4f(_camera.position, 1.0f);
-				nvmath::vec4f sdfParams = nvmath::vec4f(2000.0f, 0.001f, 128.0f, 0.0f);
+				nvmath::vec4f sdfParams = nvmath::vec4f(2000.0f, 0.001f, 128.0f, _sphereTraceRelaxation);
 				nvmath::vec4f sdfScene = nvmath::vec4f(0.0f, 0.0f, 0.0f, 1.0f);
 				gBufferUniforms->sdfParams = sdfParams;
 				gBufferUniforms->sdfScene = sdfScene;
+				gBufferUniforms->conePrepass = nvmath::uvec4(
+					_useConePrepass ? _gBufferResources.coneTileSize : 0, 0, 0, 0
+				);
+				// at distance t, a fold cell of size t * sdfLod.x covers _sdfLodPixels pixels
+				float pixelSpread =
+					2.0f * std::tan(0.5f * _camera.fovYRadians) /
+					static_cast<float>(_swapchain.getImageExtent().height);
+				gBufferUniforms->sdfLod = nvmath::vec4f(_sdfLodPixels * pixelSpread, 0.0f, 0.0f, 0.0f);
 				_gBufferResources.uniformBuffer.unmap();
 				_gBufferResources.uniformBuffer.flush();
 
+				_sdfBrickMapBuffers.setEnabled(_useBakedSdf && _canUseSdfBrickMap());
+				if (_viewParamChanged) {
+					_gBufferHistoryValid = false;
+				}
+
 				restirUniforms->cameraPos = _camera.position;
 				restirUniforms->sdfParams = sdfParams;
 				restirUniforms->sdfScene = sdfScene;
@@ -838,6 +1455,8 @@ void App::mainLoop() {
 				lightingPassUniforms->bufferSize = nvmath::uvec2(_swapchain.getImageExtent().width, _swapchain.getImageExtent().height);
 				lightingPassUniforms->debugMode = _debugMode;
 				lightingPassUniforms->gamma = _gamma;
+				lightingPassUniforms->firstProceduralLight = _lightTreeBuffers.firstProceduralLight;
+				lightingPassUniforms->proceduralLightCount = _lightTreeBuffers.proceduralLightCount;
 				_lightingPassUniformBuffer.unmap();
 				_lightingPassUniformBuffer.flush();
 
@@ -861,6 +1480,18 @@ void App::mainLoop() {
 				_renderPathChanged = false;
 			}
 
+			{ // the main fence has been waited on, so the G-buffer uniforms are no longer in use
+				auto* gBufferUniforms = _gBufferResources.uniformBuffer.mapAs<GBufferPass::Uniforms>();
+				gBufferUniforms->prevProjectionViewMatrix = prevFrameProjectionView;
+				gBufferUniforms->temporalHitDistance = nvmath::vec4f(
+					_useTemporalHitDistance && _gBufferHistoryValid ? 1.0f : 0.0f, 0.02f,
+					static_cast<float>(_temporalHitDistanceSamples), 0.0f
+				);
+				_gBufferResources.uniformBuffer.unmap();
+				_gBufferResources.uniformBuffer.flush();
+				_gBufferHistoryValid = true;
+			}
+
 			_restirUniformBuffer.unmap();
 			_restirUniformBuffer.flush();
 
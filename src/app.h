@@ -8,6 +8,14 @@
 #include "sceneBuffers.h"
 #include "camera.h"
 #include "fpsCounter.h"
+#include "memoryReport.h"
+#include "pipelineCache.h"
+#include "sceneResourceUsage.h"
+#include "emissiveSamplePool.h"
+#include "lightTree.h"
+#include "proceduralLights.h"
+#include "sdfBrickMap.h"
+#include "sdfSpecialization.h"
 
 #include "passes/gBufferPass.h"
 #include "passes/emissiveSamplePass.h"
@@ -16,6 +24,7 @@
 #include "passes/restirPass.h"
 #include "passes/unbiasedReusePass.h"
 #include "passes/imguiPass.h"
+#include "passes/sdfValidationPass.h"
 
 enum class VisibilityTestMethod {
 	disabled,
@@ -29,12 +38,37 @@ public:
 	constexpr static std::size_t maxFramesInFlight = 2;
 	constexpr static std::size_t numGBuffers = 2;
 
-	App(std::string scene, bool ignorePointLights);
+	/// Startup options of the application, most of which come from the command line flags in main.cpp.
+	struct Settings {
+		std::string scene; ///< Path to the glTF scene, or empty to only render the SDF.
+		bool ignorePointLights = false;
+		std::filesystem::path pipelineCachePath;
+		bool loadFullScene = false; ///< Load scene resources even if no pass reads them.
+		SdfSpecialization::Parameters sdfParameters;
+		float sphereTraceRelaxation = 1.0f;
+		float sdfLodPixels = 0.0f;
+		uint32_t conePrepassTileSize = 0; ///< 0 disables the cone prepass.
+		bool computeGBuffer = false;
+		std::optional<SdfBrickMap::Settings> sdfBrickMap; ///< No brick map is baked if this is empty.
+		std::filesystem::path sdfBrickMapCachePath;
+		std::filesystem::path emissiveSamplePoolCachePath;
+		std::filesystem::path triangleLightCachePath;
+		/// The bounds are set by the constructor to those of the scene, or of \ref sdfBrickMap without a scene.
+		ProceduralLights proceduralLights;
+		/// Number of procedural lights that scenes without lights get when \ref proceduralLights is empty.
+		std::size_t defaultProceduralLightCount = 200;
+	};
+
+	explicit App(Settings);
 	~App();
 
 	void mainLoop();
 	void updateGui();
 
+	/// Evaluates the SDF and its material at random points on the GPU, compares the results against the C++ port, and
+	/// prints the differences. Returns whether the results match.
+	[[nodiscard]] bool validateSdf(uint32_t pointCount);
+
 	[[nodiscard]] inline static vk::SurfaceFormatKHR chooseSurfaceFormat(
 		const vk::PhysicalDevice& dev, const vk::SurfaceKHR& surface
 	) {
@@ -114,12 +148,39 @@ protected:
 	GBuffer _gBuffers[2];
 	GBufferPass _gBufferPass;
 	GBufferPass::Resources _gBufferResources;
+	/// The frame set of each G-buffer also references the G-buffer of the previous frame.
+	std::array<vk::UniqueDescriptorSet, numGBuffers> _gBufferFrameDescriptors;
 
 	EmissiveSamplePass _emissiveSamplePass;
 	vk::UniqueDescriptorSet _emissiveSampleDescriptor;
 	vma::UniqueBuffer _emissiveSampleBuffer;
 	vk::DeviceSize _emissiveSampleBufferSize = 0;
+	/// CDF of the luminance of the emissive samples, rebuilt every frame by \ref _emissiveSamplePass.
+	vma::UniqueBuffer _emissiveSampleCdfBuffer;
+	vk::DeviceSize _emissiveSampleCdfBufferSize = 0;
+	/// Presampled light tiles, refilled every frame by \ref _emissiveSamplePass.
+	vma::UniqueBuffer _lightTileBuffer;
+	vk::DeviceSize _lightTileBufferSize = 0;
+	uint32_t _lightTileCount = 128;
+	uint32_t _lightTileSize = 1024; ///< Number of samples in each light tile.
+	/// Light reservoirs of the ReGIR grid, refilled every frame by \ref _emissiveSamplePass.
+	vma::UniqueBuffer _regirGridBuffer;
+	vk::DeviceSize _regirGridBufferSize = 0;
+	uint32_t _regirGridCells = 16; ///< Number of cells along each axis of the ReGIR grid.
+	uint32_t _regirCellReservoirs = 32; ///< Number of light reservoirs in each cell.
+	uint32_t _regirCellCandidates = 8; ///< Number of candidates resampled into each light reservoir.
+	float _regirCellSize = 16.0f;
 	uint32_t _emissiveSampleCount = 2048;
+	/// Whether every slot of \ref _emissiveSampleBuffer holds a sample of the current pool. Otherwise the next frame
+	/// redraws all of them.
+	bool _emissiveSamplesValid = false;
+	uint32_t _emissiveSampleRefreshOffset = 0; ///< First slot that is redrawn in the next frame.
+	EmissiveSamplePool _emissiveSamplePool;
+	std::filesystem::path _emissiveSamplePoolCachePath;
+	vma::UniqueBuffer _emissiveSamplePoolBuffer;
+	vk::DeviceSize _emissiveSamplePoolBufferSize = 0;
+	vma::UniqueBuffer _emissiveSamplePoolAliasTableBuffer;
+	vk::DeviceSize _emissiveSamplePoolAliasTableBufferSize = 0;
 
 	vma::UniqueBuffer _restirUniformBuffer;
 	std::array<vma::UniqueBuffer, numGBuffers> _reservoirBuffers;
@@ -147,13 +208,26 @@ protected:
 
 	ImGuiPass _imguiPass;
 
+	SceneResourceUsage _sceneResourceUsage;
 	nvh::GltfScene _gltfScene;
+	/// Lights of the scene, shared by \ref _sceneBuffers and \ref _lightTree until startup has finished.
+	std::vector<shader::pointLight> _scenePointLights;
+	std::vector<shader::triLight> _sceneTriangleLights;
 	SceneBuffers _sceneBuffers;
 	SceneRaytraceBuffers _sceneRtBuffers;
 
 	AabbTree _aabbTree;
 	AabbTreeBuffers _aabbTreeBuffers;
 
+	LightTree _lightTree;
+	LightTreeBuffers _lightTreeBuffers;
+
+	SdfBrickMap _sdfBrickMap;
+	SdfBrickMapBuffers _sdfBrickMapBuffers;
+	vk::UniqueDescriptorSet _sdfBrickMapDescriptor;
+	vma::UniqueBuffer _sphereTraceStatisticsBuffer;
+	std::array<float, SPHERE_TRACE_MARCHER_COUNT> _sphereTraceAverageSteps{};
+
 	float posThreshold = 0.1f;
 	float norThreshold = 25.0f;
 	int spatialReuseNeighbors = 5;
@@ -175,9 +249,36 @@ protected:
 	bool _enableTemporalReuse = true;
 	int _temporalReuseSampleMultiplier = 20;
 	int _spatialReuseIterations = 1;
+	bool _useBakedSdf = true;
+	int _foldSteps = 24;
+	float _foldFloor = 1.0f;
+	float _sphereTraceRelaxation = 1.2f;
+	/// Edge length in pixels below which the fold cells of the SDF are skipped away from the surface, or 0 to always
+	/// evaluate the full fold.
+	float _sdfLodPixels = 1.0f;
+	bool _sphereTraceStatistics = false;
+	bool _useConePrepass = true;
+	/// Whether the march starts at the reprojected hit distance of the previous frame, once the SDF has proven the
+	/// skipped segment empty with at most \ref _temporalHitDistanceSamples samples.
+	bool _useTemporalHitDistance = true;
+	uint32_t _temporalHitDistanceSamples = 8;
+	bool _useComputeGBuffer = false;
+	/// Fraction of the emissive samples that is redrawn every frame.
+	float _emissiveSampleRefreshFraction = 0.0625f;
+	/// Whether the initial candidates of a screen tile are drawn from one presampled light tile.
+	bool _useLightTiles = true;
+	/// Whether half of the initial candidates are drawn from \ref _lightTree.
+	bool _useLightTree = false;
+	/// Whether the initial candidates of points within the ReGIR grid are drawn from the light reservoirs of their cell.
+	bool _useRegir = false;
+	/// Whether the G-buffer of the previous frame was rendered with the current scene and size, so that its hits can
+	/// seed the march.
+	bool _gBufferHistoryValid = false;
 
 	bool _viewParamChanged = false;
 	bool _renderPathChanged = false;
+	bool _sdfParametersChanged = false;
+	bool _commandBuffersOutdated = false;
 
 	bool _unbiasedSpatialReuse = true;
 
@@ -190,6 +291,29 @@ protected:
 	void _onMouseButtonEvent(int button, int action, int mods);
 	void _onScrollEvent(double x, double y);
 
+	// startup steps, scheduled as a task graph by the constructor
+	void _createDevice();
+	void _createSwapchain();
+	void _createDescriptorPools();
+	void _createGBufferResources();
+	void _createRestirUniformBuffer();
+	void _createEmissiveSampleResources();
+	/// Uploads \ref _emissiveSamplePool and writes it to \ref _emissiveSampleDescriptor. The device must be idle.
+	void _uploadEmissiveSamplePool();
+	void _createSpatialReuseDescriptors();
+	void _createRestirDescriptors();
+	void _createUnbiasedReuseDescriptors();
+	void _createSdfBrickMapDescriptor();
+	void _createLightingPassResources();
+	void _initializeImGui();
+	void _createMainCommandBuffers();
+	void _createSynchronizationObjects();
+
+	/// Frees host copies of scene data that has been uploaded to the device. Only compact metadata such as materials,
+	/// nodes, lights and scene dimensions is kept.
+	void _releaseSceneHostData();
+	void _printMemoryReport(std::string_view title) const;
+
 	void _createSwapchainBuffers() {
 		_swapchainBuffers.clear();
 		_swapchainBuffers = _swapchain.getBuffers(_device.get(), _lightingPass.getPass(), _commandPool.get());
@@ -217,39 +341,114 @@ protected:
 		}
 	}
 
+	/// Returns the scene resources read by any pass. All passes are created at startup regardless of the selected render
+	/// path, so this is independent of the render path.
+	[[nodiscard]] static SceneResourceUsage _collectSceneResourceUsage() {
+		SceneResourceUsage result = GBufferPass::getSceneResourceUsage();
+		result |= EmissiveSamplePass::getSceneResourceUsage();
+		result |= SpatialReusePass::getSceneResourceUsage();
+		result |= RestirPass::getSceneResourceUsage();
+		result |= UnbiasedReusePass::getSceneResourceUsage();
+		result |= LightingPass::getSceneResourceUsage();
+		result |= ImGuiPass::getSceneResourceUsage();
+		return result;
+	}
+
+	[[nodiscard]] bool _useSoftwareRayTracing() const {
+#ifdef RENDERDOC_CAPTURE
+		return true;
+#else
+		return _visibilityTestMethod != VisibilityTestMethod::hardware;
+#endif
+	}
+
+	/// Makes sure that all pipelines used by the selected render path have been created. Pipelines of render paths
+	/// that are never selected are never created.
+	void _prepareRenderPath() {
+		_restirPass.prepareRenderPath(_useSoftwareRayTracing(), _device.get(), _allocator, _physicalDevice);
+		if (_unbiasedSpatialReuse) {
+			_unbiasedReusePass.prepareRenderPath(_useSoftwareRayTracing(), _device.get(), _allocator, _physicalDevice);
+		} else {
+			_spatialReusePass.ensurePipelines(_device.get());
+		}
+	}
+
+	/// The baked field is only valid for the fold it was baked with.
+	[[nodiscard]] bool _canUseSdfBrickMap() const {
+		return
+			_sdfBrickMapBuffers.isAvailable() &&
+			_sdfBrickMap.settings.fold == SdfSpecialization::getParameters().fold;
+	}
+	/// Recreates all pipelines that evaluate the SDF with the fold parameters selected in the GUI. The device must be
+	/// idle.
+	void _respecializeSdfPipelines() {
+		SdfSpecialization::Parameters params = SdfSpecialization::getParameters();
+		params.fold.steps = _foldSteps;
+		params.fold.floor = _foldFloor;
+		params.sphereTraceStatistics = _sphereTraceStatistics;
+		SdfSpecialization::set(params);
+
+		_gBufferPass.respecialize(_device.get());
+		_restirPass.respecialize(_device.get(), _allocator, _physicalDevice);
+		_unbiasedReusePass.respecialize(_device.get(), _allocator, _physicalDevice);
+		_sdfBrickMapBuffers.setEnabled(_useBakedSdf && _canUseSdfBrickMap());
+
+		// unlike the brick map, the emissive sample pool has no fallback, so it is loaded or rebaked for the new fold
+		if (_emissiveSamplePool.settings.fold != params.fold) {
+			EmissiveSamplePool::Settings poolSettings = _emissiveSamplePool.settings;
+			poolSettings.fold = params.fold;
+			_emissiveSamplePool = EmissiveSamplePool::loadOrBake(poolSettings, _emissiveSamplePoolCachePath);
+			_uploadEmissiveSamplePool();
+		}
+	}
+
+	/// Computes the average number of steps per ray from the statistics of the last finished frame.
+	void _readSphereTraceStatistics() {
+		_sphereTraceStatisticsBuffer.invalidate();
+		const auto *statistics = _sphereTraceStatisticsBuffer.mapAs<shader::SphereTraceStatistics>();
+		for (std::size_t i = 0; i < SPHERE_TRACE_MARCHER_COUNT; ++i) {
+			_sphereTraceAverageSteps[i] =
+				statistics->rays[i] > 0 ?
+				static_cast<float>(statistics->steps[i]) / static_cast<float>(statistics->rays[i]) :
+				0.0f;
+		}
+		_sphereTraceStatisticsBuffer.unmap();
+	}
+
 	void _recordMainCommandBuffers() {
+		_prepareRenderPath();
 		for (std::size_t i = 0; i < numGBuffers; ++i) {
 			vk::CommandBufferBeginInfo beginInfo;
 			_mainCommandBuffers[i]->begin(beginInfo);
 
-			_gBufferPass.issueCommands(_mainCommandBuffers[i].get(), _gBuffers[i].getFramebuffer());
-
-			_mainCommandBuffers[i]->fillBuffer(_emissiveSampleBuffer.get(), 0, sizeof(uint32_t), 0);
-			vk::BufferMemoryBarrier emissiveSampleBarrier;
-			emissiveSampleBarrier
-				.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
-				.setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
-				.setBuffer(_emissiveSampleBuffer.get())
-				.setOffset(0)
-				.setSize(VK_WHOLE_SIZE);
+			_mainCommandBuffers[i]->fillBuffer(_sphereTraceStatisticsBuffer.get(), 0, VK_WHOLE_SIZE, 0);
+			vk::MemoryBarrier statisticsClearBarrier(
+				vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+			);
 			_mainCommandBuffers[i]->pipelineBarrier(
-				vk::PipelineStageFlagBits::eTransfer,
-				vk::PipelineStageFlagBits::eComputeShader,
-				{}, {}, emissiveSampleBarrier, {}
+				vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+				{}, statisticsClearBarrier, {}, {}
 			);
 
+			_gBufferPass.sdfDescriptorSet = _sdfBrickMapDescriptor.get();
+			_gBufferPass.useConePrepass = _useConePrepass;
+			_gBufferPass.frameDescriptorSet = _gBufferFrameDescriptors[i].get();
+			_gBufferPass.computeTarget = &_gBuffers[i];
+			_gBufferPass.useCompute = _useComputeGBuffer;
+			_gBufferPass.issueCommands(_mainCommandBuffers[i].get(), _gBuffers[i].getFramebuffer());
+
 			_emissiveSamplePass.descriptorSet = _emissiveSampleDescriptor.get();
 			_emissiveSamplePass.sampleCount = _emissiveSampleCount;
 			_emissiveSamplePass.seed = static_cast<uint32_t>(i);
+			_emissiveSamplePass.lightTileSampleCount = _useLightTiles ? _lightTileCount * _lightTileSize : 0;
+			_emissiveSamplePass.regirReservoirCount =
+				_useRegir ? _regirGridCells * _regirGridCells * _regirGridCells * _regirCellReservoirs : 0;
 			_emissiveSamplePass.issueCommands(_mainCommandBuffers[i].get(), nullptr);
 
 			_restirPass.staticDescriptorSet = _restirStaticDescriptor.get();
 			_restirPass.frameDescriptorSet = _restirFrameDescriptors[i].get();
-#ifdef RENDERDOC_CAPTURE
-			_restirPass.useSoftwareRayTracing = true;
-#else
-			_restirPass.useSoftwareRayTracing = _visibilityTestMethod != VisibilityTestMethod::hardware;
-#endif
+			_restirPass.sdfDescriptorSet = _sdfBrickMapDescriptor.get();
+			_restirPass.useSoftwareRayTracing = _useSoftwareRayTracing();
 			_restirPass.raytraceDescriptorSet =
 				_restirPass.useSoftwareRayTracing ?
 				_restirSoftwareRayTraceDescriptor.get() :
@@ -260,11 +459,8 @@ protected:
 
 			if (_unbiasedSpatialReuse) {
 				_unbiasedReusePass.frameDescriptorSet = _unbiasedReusePassFrameDescriptors[i].get();
-#ifdef RENDERDOC_CAPTURE
-				_unbiasedReusePass.useSoftwareRayTracing = true;
-#else
-				_unbiasedReusePass.useSoftwareRayTracing = _visibilityTestMethod != VisibilityTestMethod::hardware;
-#endif
+				_unbiasedReusePass.sdfDescriptorSet = _sdfBrickMapDescriptor.get();
+				_unbiasedReusePass.useSoftwareRayTracing = _useSoftwareRayTracing();
 				_unbiasedReusePass.raytraceDescriptorSet =
 					_unbiasedReusePass.useSoftwareRayTracing ?
 					_unbiasedReusePassSwRaytraceDescriptors.get() :
@@ -282,6 +478,12 @@ protected:
 				}
 			}
 
+			vk::MemoryBarrier statisticsReadBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead);
+			_mainCommandBuffers[i]->pipelineBarrier(
+				vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eHost,
+				{}, statisticsReadBarrier, {}, {}
+			);
+
 			_mainCommandBuffers[i]->end();
 
 
@@ -312,16 +514,23 @@ protected:
 
 		_restirPass.initializeStaticDescriptorSetFor(
 			_emissiveSampleBuffer.get(), _emissiveSampleBufferSize,
+			_emissiveSampleCdfBuffer.get(), _emissiveSampleCdfBufferSize,
+			_lightTileBuffer.get(), _lightTileBufferSize,
+			_lightTreeBuffers, _regirGridBuffer.get(), _regirGridBufferSize,
 			_restirUniformBuffer.get(), _device.get(), _restirStaticDescriptor.get()
 		);
 #ifndef RENDERDOC_CAPTURE
-		_restirPass.initializeHardwareRayTracingDescriptorSet(
-			_sceneRtBuffers, _device.get(), _restirHardwareRayTraceDescriptor.get()
-		);
+		if (_sceneRtBuffers.getTopLevelAccelerationStructure()) {
+			_restirPass.initializeHardwareRayTracingDescriptorSet(
+				_sceneRtBuffers, _device.get(), _restirHardwareRayTraceDescriptor.get()
+			);
+		}
 #endif
-		_restirPass.initializeSoftwareRayTracingDescriptorSet(
-			_aabbTreeBuffers, _device.get(), _restirSoftwareRayTraceDescriptor.get()
-		);
+		if (_aabbTreeBuffers.nodeBuffer.get()) {
+			_restirPass.initializeSoftwareRayTracingDescriptorSet(
+				_aabbTreeBuffers, _device.get(), _restirSoftwareRayTraceDescriptor.get()
+			);
+		}
 		for (std::size_t i = 0; i < numGBuffers; ++i) {
 			_restirPass.initializeFrameDescriptorSetFor(
 				_gBuffers[i], _gBuffers[(i + numGBuffers - 1) % numGBuffers],
@@ -340,13 +549,17 @@ protected:
 					_reservoirTemporaryBuffer.get(), _reservoirBuffers[i].get(), _reservoirBufferSize,
 					_unbiasedReusePassFrameDescriptors[i].get()
 				);
-				_unbiasedReusePass.initializeSoftwareRaytraceDescriptorSet(
-					_device.get(), _aabbTreeBuffers, _unbiasedReusePassSwRaytraceDescriptors.get()
-				);
+				if (_aabbTreeBuffers.nodeBuffer.get()) {
+					_unbiasedReusePass.initializeSoftwareRaytraceDescriptorSet(
+						_device.get(), _aabbTreeBuffers, _unbiasedReusePassSwRaytraceDescriptors.get()
+					);
+				}
 #ifndef RENDERDOC_CAPTURE
-				_unbiasedReusePass.initializeHardwareRaytraceDescriptorSet(
-					_device.get(), _sceneRtBuffers, _unbiasedReusePassHwRaytraceDescriptors.get()
-				);
+				if (_sceneRtBuffers.getTopLevelAccelerationStructure()) {
+					_unbiasedReusePass.initializeHardwareRaytraceDescriptorSet(
+						_device.get(), _sceneRtBuffers, _unbiasedReusePassHwRaytraceDescriptors.get()
+					);
+				}
 #endif
 			} else {
 				_spatialReusePass.initializeDescriptorSetFor(
@@ -363,12 +576,22 @@ protected:
 		}
 	}
 
+	void _initializeGBufferFrameDescriptors() {
+		for (std::size_t i = 0; i < numGBuffers; ++i) {
+			_gBufferPass.initializeFrameDescriptorSet(
+				_gBuffers[i], _gBuffers[(i + numGBuffers - 1) % numGBuffers],
+				_device.get(), _gBufferFrameDescriptors[i].get()
+			);
+		}
+		_gBufferHistoryValid = false;
+	}
+
 	void _initializeLightingPassResources() {
 		for (std::size_t i = 0; i < numGBuffers; ++i) {
 			_lightingPass.initializeDescriptorSetFor(
 				_gBuffers[i], _emissiveSampleBuffer.get(), _emissiveSampleBufferSize,
 				_lightingPassUniformBuffer.get(), _reservoirBuffers[i].get(), _reservoirBufferSize,
-				_device.get(), _lightingPassDescriptorSets[i].get()
+				_lightTreeBuffers, _device.get(), _lightingPassDescriptorSets[i].get()
 			);
 		}
 	}
@@ -0,0 +1,215 @@
+#include "emissiveSamplePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "misc.h"
+#include "sdfBrickMap.h"
+#include "taskGraph.h"
+
+/// Header of the pool cache file. The settings fields come first so that a cached bake can be matched against the
+/// current settings with a single comparison.
+struct EmissiveSamplePoolFileHeader {
+	constexpr static uint32_t expectedMagic = 0x4C4F5045; // "EPOL"
+	constexpr static uint32_t expectedVersion = 1;
+
+	uint32_t magic = expectedMagic;
+	uint32_t version = expectedVersion;
+	uint32_t fieldVersion = SdfBrickMap::fieldVersion;
+	float boundsMin[3]{};
+	float boundsMax[3]{};
+	float shellThickness = 0.0f;
+	uint64_t candidateCount = 0;
+	uint64_t emissiveIterations = 0;
+	uint32_t maxSamples = 0;
+	int32_t foldSteps = 0;
+	float foldFloor = 0.0f;
+	float foldRotationAngle = 0.0f;
+
+	uint32_t numSamples = 0;
+	uint32_t padding = 0;
+};
+constexpr CacheFileFormat _samplePoolCacheFormat{
+	.name = "Emissive sample pool", .fallback = "baking", .mismatch = "was baked with different settings"
+};
+
+[[nodiscard]] EmissiveSamplePoolFileHeader _getHeaderForSettings(const EmissiveSamplePool::Settings &settings) {
+	EmissiveSamplePoolFileHeader header;
+	for (int i = 0; i < 3; ++i) {
+		header.boundsMin[i] = settings.boundsMin[i];
+		header.boundsMax[i] = settings.boundsMax[i];
+	}
+	header.shellThickness = settings.shellThickness;
+	header.candidateCount = settings.candidateCount;
+	header.emissiveIterations = settings.emissiveIterations;
+	header.maxSamples = settings.maxSamples;
+	header.foldSteps = settings.fold.steps;
+	header.foldFloor = settings.fold.floor;
+	header.foldRotationAngle = settings.fold.rotationAngle;
+	return header;
+}
+
+/// Central difference gradient of the distance.
+[[nodiscard]] nvmath::vec3f _getGradient(nvmath::vec3f p, float h, const sdf::FoldParameters &fold) {
+	auto dist = [&](nvmath::vec3f q) {
+		return sdf::getDistMat(q, fold).x;
+	};
+	return nvmath::vec3f(
+		dist(p + nvmath::vec3f(h, 0.0f, 0.0f)) - dist(p - nvmath::vec3f(h, 0.0f, 0.0f)),
+		dist(p + nvmath::vec3f(0.0f, h, 0.0f)) - dist(p - nvmath::vec3f(0.0f, h, 0.0f)),
+		dist(p + nvmath::vec3f(0.0f, 0.0f, h)) - dist(p - nvmath::vec3f(0.0f, 0.0f, h))
+	) / (2.0f * h);
+}
+
+
+EmissiveSamplePool EmissiveSamplePool::bake(const Settings &settings) {
+	constexpr std::size_t candidatesPerBatch = 4096;
+	// matches the normal estimation of the shaders, which use twice the hit threshold
+	constexpr float normalEpsilon = 0.002f;
+
+	auto bakeBegin = std::chrono::high_resolution_clock::now();
+
+	EmissiveSamplePool result;
+	result.settings = settings;
+	nvmath::vec3f extent = settings.boundsMax - settings.boundsMin;
+	// A candidate lies in the shell with a probability proportional to the shell volume, which is the surface area
+	// times 2 * shellThickness / |gradient|. Each accepted candidate therefore represents this much area, times the
+	// gradient length at the candidate.
+	double areaPerCandidate =
+		static_cast<double>(extent.x) * extent.y * extent.z /
+		(2.0 * settings.shellThickness * static_cast<double>(settings.candidateCount));
+
+	// batches are seeded by their index, so the result does not depend on the number of threads
+	std::size_t numBatches = ceilDiv<std::size_t>(settings.candidateCount, candidatesPerBatch);
+	std::vector<std::vector<shader::EmissiveSample>> batchSamples(numBatches);
+	parallelFor(numBatches, [&](std::size_t batch) {
+		std::size_t count = std::min<std::size_t>(
+			candidatesPerBatch, settings.candidateCount - batch * candidatesPerBatch
+		);
+		std::mt19937 random(static_cast<uint32_t>(batch));
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<float> xs(count), ys(count), zs(count), dist(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			xs[i] = settings.boundsMin.x + unit(random) * extent.x;
+			ys[i] = settings.boundsMin.y + unit(random) * extent.y;
+			zs[i] = settings.boundsMin.z + unit(random) * extent.z;
+		}
+		sdf::getDist(xs.data(), ys.data(), zs.data(), dist.data(), count, settings.fold);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			if (std::abs(dist[i]) >= settings.shellThickness) {
+				continue;
+			}
+			nvmath::vec3f candidate(xs[i], ys[i], zs[i]);
+			nvmath::vec3f gradient = _getGradient(candidate, 0.25f * settings.shellThickness, settings.fold);
+			float gradientLength = nvmath::length(gradient);
+			if (gradientLength <= 0.0f) {
+				continue;
+			}
+			nvmath::vec3f position = candidate - gradient * (dist[i] / (gradientLength * gradientLength));
+
+			nvmath::vec2f distMat = sdf::getDistMat(position, settings.fold);
+			if (std::abs(distMat.x) >= settings.shellThickness) {
+				continue; // the projection left the shell, e.g. across a crease
+			}
+			sdf::Material material = sdf::getMaterial(distMat.y, settings.fold, settings.emissiveIterations);
+			float emissionLuminance = shader::luminance(material.emission.x, material.emission.y, material.emission.z);
+			if (emissionLuminance <= 0.0f) {
+				continue;
+			}
+
+			shader::EmissiveSample &sample = batchSamples[batch].emplace_back();
+			sample.position_luminance = nvmath::vec4f(position, emissionLuminance);
+			sample.normal_pdf = nvmath::vec4f(
+				nvmath::normalize(_getGradient(position, normalEpsilon, settings.fold)),
+				static_cast<float>(areaPerCandidate * gradientLength)
+			);
+			sample.emission = nvmath::vec4f(material.emission, 0.0f);
+		}
+	});
+	for (std::vector<shader::EmissiveSample> &batch : batchSamples) {
+		result.samples.insert(result.samples.end(), batch.begin(), batch.end());
+	}
+
+	// keep a uniformly chosen subset, each point of which represents proportionally more area
+	std::size_t numFound = result.samples.size();
+	if (numFound > settings.maxSamples) {
+		std::mt19937 random(0);
+		std::shuffle(result.samples.begin(), result.samples.end(), random);
+		result.samples.resize(settings.maxSamples);
+		float scale = static_cast<float>(numFound) / static_cast<float>(settings.maxSamples);
+		for (shader::EmissiveSample &sample : result.samples) {
+			sample.normal_pdf.w *= scale;
+		}
+	}
+
+	std::vector<float> power(result.samples.size());
+	float totalArea = 0.0f;
+	for (std::size_t i = 0; i < result.samples.size(); ++i) {
+		power[i] = result.samples[i].position_luminance.w * result.samples[i].normal_pdf.w;
+		totalArea += result.samples[i].normal_pdf.w;
+	}
+	if (!power.empty()) {
+		result.aliasTable = createAliasTable(std::move(power));
+	}
+
+	std::cout <<
+		"Emissive sample pool: baked " << result.samples.size() << " of " << numFound << " points, " << totalArea <<
+		" units of emissive area from " << settings.candidateCount << " candidates in " <<
+		std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - bakeBegin).count() <<
+		" ms\n";
+	return result;
+}
+
+EmissiveSamplePool EmissiveSamplePool::loadOrBake(const Settings &settings, const std::filesystem::path &cachePath) {
+	if (std::optional<EmissiveSamplePool> cached = load(settings, cachePath)) {
+		return std::move(cached.value());
+	}
+	EmissiveSamplePool result = bake(settings);
+	result.save(cachePath);
+	return result;
+}
+
+std::optional<EmissiveSamplePool> EmissiveSamplePool::load(
+	const Settings &settings, const std::filesystem::path &path
+) {
+	std::optional<CacheFile<EmissiveSamplePoolFileHeader>> file = loadCacheFile(
+		_samplePoolCacheFormat, path, _getHeaderForSettings(settings),
+		offsetof(EmissiveSamplePoolFileHeader, numSamples),
+		[](const EmissiveSamplePoolFileHeader &header) {
+			return header.numSamples * (sizeof(shader::EmissiveSample) + sizeof(shader::aliasTableColumn));
+		}
+	);
+	if (!file) {
+		return std::nullopt;
+	}
+
+	std::size_t numSamples = file->header.numSamples;
+	EmissiveSamplePool result;
+	result.settings = settings;
+	const char *data = file->getPayload();
+	result.samples.resize(numSamples);
+	std::memcpy(result.samples.data(), data, numSamples * sizeof(shader::EmissiveSample));
+	result.aliasTable.resize(numSamples);
+	std::memcpy(
+		result.aliasTable.data(), data + numSamples * sizeof(shader::EmissiveSample),
+		numSamples * sizeof(shader::aliasTableColumn)
+	);
+
+	std::cout << "Emissive sample pool: loaded " << numSamples << " points from " << path << "\n";
+	return result;
+}
+
+void EmissiveSamplePool::save(const std::filesystem::path &path) const {
+	EmissiveSamplePoolFileHeader header = _getHeaderForSettings(settings);
+	header.numSamples = static_cast<uint32_t>(samples.size());
+	saveCacheFile(
+		_samplePoolCacheFormat, path, header,
+		{ std::as_bytes(std::span(samples)), std::as_bytes(std::span(aliasTable)) }
+	);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <nvmath.h>
+
+#include "sdf.h"
+#include "shaderIncludes.h"
+
+/// Points on the emissive surfaces of the SDF, baked once on the CPU so that the per-frame emissive samples can be drawn
+/// from them in constant time. Candidates are scattered uniformly in a box; those in a thin shell around the surface are
+/// projected onto it, and the ones that land on an emissive fold iteration are kept. Every point stands for an equal
+/// share of the shell volume, from which the surface area it represents follows.
+struct EmissiveSamplePool {
+	struct Settings {
+		nvmath::vec3f boundsMin{ -256.0f, -256.0f, -256.0f };
+		nvmath::vec3f boundsMax{ 256.0f, 256.0f, 256.0f };
+		uint64_t candidateCount = 1ull << 26;
+		/// Candidates with an absolute distance below this value are projected onto the surface.
+		float shellThickness = 0.05f;
+		uint32_t maxSamples = 1u << 16; ///< The pool is thinned out uniformly if more points are found.
+		sdf::FoldParameters fold;
+		uint64_t emissiveIterations = 0; ///< See \ref SdfSpecialization::Parameters::emissiveIterations.
+	};
+
+	Settings settings;
+	/// Points in SDF space. \p position_luminance.w is the luminance of the emission, and \p normal_pdf.w is the surface
+	/// area represented by the point.
+	std::vector<shader::EmissiveSample> samples;
+	/// Selects samples in proportion to their power, i.e., emitted luminance times area.
+	std::vector<shader::aliasTableColumn> aliasTable;
+
+	/// Bakes the pool on all hardware threads.
+	[[nodiscard]] static EmissiveSamplePool bake(const Settings&);
+	/// Loads the pool from the given cache file if it was baked with the same settings and the same field version,
+	/// otherwise bakes it and updates the cache.
+	[[nodiscard]] static EmissiveSamplePool loadOrBake(const Settings&, const std::filesystem::path &cachePath);
+
+	[[nodiscard]] static std::optional<EmissiveSamplePool> load(const Settings&, const std::filesystem::path&);
+	void save(const std::filesystem::path&) const;
+
+	[[nodiscard]] bool empty() const {
+		return samples.empty();
+	}
+};
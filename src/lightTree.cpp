@@ -0,0 +1,323 @@
+#include "lightTree.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <numbers>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#include <nvmath.h>
+
+#include "aliasTable.h"
+#include "misc.h"
+#include "taskGraph.h"
+
+/// Number of procedural lights that a single call of \ref parallelFor() generates.
+constexpr std::size_t _proceduralLightsPerTask = 1 << 12;
+
+/// Bounds of the directions of the normals of a set of lights: all normals are within \p angle of \p axis.
+struct _NormalCone {
+	nvmath::vec3f axis{ 0.0f, 0.0f, 1.0f };
+	float angle = 0.0f;
+
+	/// Returns the smallest cone that contains both cones.
+	[[nodiscard]] static _NormalCone merge(_NormalCone a, _NormalCone b) {
+		if (a.angle < b.angle) {
+			std::swap(a, b);
+		}
+		float cosBetween = std::clamp(nvmath::dot(a.axis, b.axis), -1.0f, 1.0f);
+		float angleBetween = std::acos(cosBetween);
+		if (std::min(angleBetween + b.angle, std::numbers::pi_v<float>) <= a.angle) {
+			return a;
+		}
+		// padded slightly so that rounding cannot leave normals of b outside
+		float angle = 0.5f * (a.angle + angleBetween + b.angle) + 1e-5f;
+		float sinBetween = std::sin(angleBetween);
+		if (angle >= std::numbers::pi_v<float> || sinBetween < 1e-6f) {
+			return _NormalCone{ a.axis, std::numbers::pi_v<float> };
+		}
+		// rotate the axis of a towards the axis of b
+		float rotation = angle - a.angle;
+		nvmath::vec3f axis =
+			a.axis * (std::sin(angleBetween - rotation) / sinBetween) + b.axis * (std::sin(rotation) / sinBetween);
+		return _NormalCone{ nvmath::normalize(axis), angle };
+	}
+};
+
+/// A light as seen by the builder. Primitives are split at the center of their bounds.
+struct _LightTreePrimitive {
+	nvmath::vec3f boundsMin;
+	nvmath::vec3f boundsMax;
+	_NormalCone cone;
+	float intensity = 0.0f;
+	uint32_t lightIndex = 0;
+
+	[[nodiscard]] nvmath::vec3f getCentroid() const {
+		return 0.5f * (boundsMin + boundsMax);
+	}
+};
+using _LightTreePrimitiveIterator = std::vector<_LightTreePrimitive>::iterator;
+
+/// A subtree over a range of primitives. A subtree over n primitives has 2n - 1 nodes, and nodes are stored in
+/// depth-first order, so the index of every node is known before the tree is built and disjoint subtrees can be built
+/// concurrently.
+struct _LightTreeSubtree {
+	_LightTreePrimitiveIterator begin;
+	_LightTreePrimitiveIterator end;
+	std::size_t nodeIndex = 0;
+	_NormalCone cone; ///< Set once the subtree has been built.
+
+	/// Splits the primitives at the median of their centroids along the longest axis of the centroid bounds, and
+	/// returns the two children.
+	[[nodiscard]] std::pair<_LightTreeSubtree, _LightTreeSubtree> split() const {
+		nvmath::vec3f centroidMin = begin->getCentroid(), centroidMax = centroidMin;
+		for (auto it = begin; it != end; ++it) {
+			centroidMin = nvmath::nv_min(centroidMin, it->getCentroid());
+			centroidMax = nvmath::nv_max(centroidMax, it->getCentroid());
+		}
+		nvmath::vec3f extent = centroidMax - centroidMin;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		auto middle = begin + (end - begin) / 2;
+		std::nth_element(begin, middle, end, [axis](const _LightTreePrimitive &lhs, const _LightTreePrimitive &rhs) {
+			return lhs.getCentroid()[axis] < rhs.getCentroid()[axis];
+		});
+		// the left subtree takes up the 2 * (middle - begin) - 1 nodes after this one
+		auto numLeft = static_cast<std::size_t>(middle - begin);
+		return {
+			_LightTreeSubtree{ .begin = begin, .end = middle, .nodeIndex = nodeIndex + 1 },
+			_LightTreeSubtree{ .begin = middle, .end = end, .nodeIndex = nodeIndex + 2 * numLeft }
+		};
+	}
+};
+
+/// Number of subtrees per hardware thread that are built concurrently, so that threads stay busy even though the
+/// sizes of the subtrees vary by one primitive.
+constexpr std::size_t _lightSubtreesPerThread = 4;
+/// Subtrees with fewer primitives are not split further before they are built concurrently.
+constexpr std::size_t _minConcurrentLightSubtreeSize = 1 << 12;
+/// Size of the staging buffers through which the light tree buffers are uploaded.
+constexpr vk::DeviceSize _lightTreeUploadChunkSize = 2 << 20;
+
+/// Sets the node of a single primitive.
+void _setLightTreeLeaf(shader::LightTreeNode &node, const _LightTreePrimitive &primitive) {
+	node.boundsMin_intensity = nvmath::vec4f(primitive.boundsMin, primitive.intensity);
+	node.boundsMax_cosNormalBound = nvmath::vec4f(primitive.boundsMax, std::cos(primitive.cone.angle));
+	node.axis = nvmath::vec4f(primitive.cone.axis, 0.0f);
+	node.children = nvmath::ivec4(-1, static_cast<int32_t>(primitive.lightIndex), 0, 0);
+}
+
+/// Sets an inner node from its two children, which must have been built, and returns its normal cone. The bounds of
+/// the node are merged from those of its children, so that they always contain them.
+_NormalCone _setLightTreeInnerNode(
+	std::vector<shader::LightTreeNode> &nodes, std::size_t nodeIndex,
+	const _LightTreeSubtree &left, const _LightTreeSubtree &right
+) {
+	const shader::LightTreeNode &leftNode = nodes[left.nodeIndex];
+	const shader::LightTreeNode &rightNode = nodes[right.nodeIndex];
+	_NormalCone cone = _NormalCone::merge(left.cone, right.cone);
+	shader::LightTreeNode &node = nodes[nodeIndex];
+	node.boundsMin_intensity = nvmath::vec4f(
+		nvmath::nv_min(nvmath::vec3f(leftNode.boundsMin_intensity), nvmath::vec3f(rightNode.boundsMin_intensity)),
+		leftNode.boundsMin_intensity.w + rightNode.boundsMin_intensity.w
+	);
+	node.boundsMax_cosNormalBound = nvmath::vec4f(
+		nvmath::nv_max(
+			nvmath::vec3f(leftNode.boundsMax_cosNormalBound), nvmath::vec3f(rightNode.boundsMax_cosNormalBound)
+		),
+		std::cos(cone.angle)
+	);
+	node.axis = nvmath::vec4f(cone.axis, 0.0f);
+	node.children = nvmath::ivec4(static_cast<int32_t>(left.nodeIndex), static_cast<int32_t>(right.nodeIndex), 0, 0);
+	return cone;
+}
+
+/// Builds the given subtree on the calling thread and sets its normal cone.
+void _buildLightSubtree(std::vector<shader::LightTreeNode> &nodes, _LightTreeSubtree &subtree) {
+	if (subtree.end - subtree.begin == 1) {
+		_setLightTreeLeaf(nodes[subtree.nodeIndex], *subtree.begin);
+		subtree.cone = subtree.begin->cone;
+		return;
+	}
+	auto [left, right] = subtree.split();
+	_buildLightSubtree(nodes, left);
+	_buildLightSubtree(nodes, right);
+	subtree.cone = _setLightTreeInnerNode(nodes, subtree.nodeIndex, left, right);
+}
+
+/// Builds the tree over all primitives. The top levels are split level by level, with the subtrees of a level split
+/// concurrently, until there are enough subtrees to keep all hardware threads busy; these subtrees are then built
+/// concurrently, and finally the nodes of the top levels are set from their children.
+void _buildLightTree(std::vector<shader::LightTreeNode> &nodes, std::vector<_LightTreePrimitive> &primitives) {
+	nodes.resize(2 * primitives.size() - 1);
+	std::size_t numSubtrees = _lightSubtreesPerThread * std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<std::vector<_LightTreeSubtree>> levels{
+		{ _LightTreeSubtree{ .begin = primitives.begin(), .end = primitives.end(), .nodeIndex = 0 } }
+	};
+	while (
+		levels.back().size() < numSubtrees &&
+		primitives.size() / levels.back().size() >= 2 * _minConcurrentLightSubtreeSize
+	) {
+		std::vector<_LightTreeSubtree> children(2 * levels.back().size());
+		parallelFor(levels.back().size(), [&](std::size_t i) {
+			std::tie(children[2 * i], children[2 * i + 1]) = levels.back()[i].split();
+		});
+		levels.emplace_back(std::move(children));
+	}
+
+	parallelFor(levels.back().size(), [&](std::size_t i) {
+		_buildLightSubtree(nodes, levels.back()[i]);
+	});
+	for (std::size_t level = levels.size() - 1; level-- > 0;) {
+		for (std::size_t i = 0; i < levels[level].size(); ++i) {
+			_LightTreeSubtree &subtree = levels[level][i];
+			subtree.cone = _setLightTreeInnerNode(
+				nodes, subtree.nodeIndex, levels[level + 1][2 * i], levels[level + 1][2 * i + 1]
+			);
+		}
+	}
+}
+
+/// Returns the primitive of a point light.
+[[nodiscard]] _LightTreePrimitive _getPointLightPrimitive(const shader::pointLight &light) {
+	_LightTreePrimitive primitive;
+	primitive.boundsMin = primitive.boundsMax = nvmath::vec3f(light.pos);
+	primitive.cone.angle = std::numbers::pi_v<float>; // point lights emit in all directions
+	primitive.intensity = light.color_luminance.w;
+	return primitive;
+}
+
+LightTree LightTree::build(
+	std::vector<shader::pointLight> pointLights, std::vector<shader::triLight> triangleLights,
+	const ProceduralLights &proceduralLights
+) {
+	LightTree result;
+	result.pointLights = std::move(pointLights);
+	result.triangleLights = std::move(triangleLights);
+	result.proceduralLights = proceduralLights;
+
+	std::vector<_LightTreePrimitive> primitives;
+	primitives.reserve(result.getPointLightCount() + result.triangleLights.size());
+	for (const shader::pointLight &light : result.pointLights) {
+		primitives.emplace_back(_getPointLightPrimitive(light));
+	}
+	{
+		std::size_t first = primitives.size();
+		primitives.resize(first + proceduralLights.count);
+		parallelFor(ceilDiv(proceduralLights.count, _proceduralLightsPerTask), [&](std::size_t task) {
+			std::size_t end = std::min((task + 1) * _proceduralLightsPerTask, proceduralLights.count);
+			for (std::size_t i = task * _proceduralLightsPerTask; i < end; ++i) {
+				primitives[first + i] = _getPointLightPrimitive(proceduralLights.generate(i));
+			}
+		});
+	}
+	for (const shader::triLight &light : result.triangleLights) {
+		nvmath::vec3f p1(light.p1), p2(light.p2), p3(light.p3);
+		_LightTreePrimitive &primitive = primitives.emplace_back();
+		primitive.boundsMin = nvmath::nv_min(nvmath::nv_min(p1, p2), p3);
+		primitive.boundsMax = nvmath::nv_max(nvmath::nv_max(p1, p2), p3);
+		primitive.cone.axis = nvmath::vec3f(light.normalArea);
+		primitive.intensity = light.emission_luminance.w * light.normalArea.w;
+	}
+	{
+		// before the primitives are reordered by the build
+		std::vector<float> intensities(primitives.size());
+		for (std::size_t i = 0; i < primitives.size(); ++i) {
+			primitives[i].lightIndex = static_cast<uint32_t>(i);
+			intensities[i] = primitives[i].intensity;
+		}
+		result.aliasTable = buildAliasTable(intensities);
+	}
+
+	if (!primitives.empty()) {
+		_buildLightTree(result.nodes, primitives);
+	}
+	return result;
+}
+
+
+/// Creates a device local buffer with the element count followed by \p count elements, with room for at least one
+/// element. \p fill writes the elements starting at the given index into a staging buffer, and the elements are
+/// streamed to the device in chunks by \ref streamToBuffer().
+template <typename T> [[nodiscard]] vma::UniqueBuffer _createCountedBuffer(
+	std::size_t count, const std::function<void(std::size_t, std::span<T>)> &fill,
+	vma::Allocator &allocator, TransientCommandBufferPool &cmdBufferPool, vk::Queue queue, vk::DeviceSize &size
+) {
+	constexpr std::size_t headerSize = alignPreArrayBlock<T, uint32_t[4]>();
+	size = headerSize + sizeof(T) * std::max<std::size_t>(count, 1);
+	vma::UniqueBuffer result = allocator.createBuffer(
+		static_cast<uint32_t>(size),
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, VMA_MEMORY_USAGE_GPU_ONLY
+	);
+	{
+		std::array<uint32_t, headerSize / sizeof(uint32_t)> header{};
+		header[0] = static_cast<uint32_t>(count);
+		TransientCommandBuffer cmdBuffer = cmdBufferPool.begin(queue);
+		cmdBuffer->updateBuffer<uint32_t>(result.get(), 0, header);
+		vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+		cmdBuffer->pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, barrier, {}, {}
+		);
+		cmdBuffer.submitAndWait();
+	}
+	// chunks hold whole elements
+	streamToBuffer(
+		result.get(), headerSize, sizeof(T) * count, _lightTreeUploadChunkSize / sizeof(T) * sizeof(T),
+		[&](vk::DeviceSize first, std::span<std::byte> chunk) {
+			fill(first / sizeof(T), std::span(reinterpret_cast<T*>(chunk.data()), chunk.size() / sizeof(T)));
+		},
+		allocator, cmdBufferPool, queue
+	);
+	return result;
+}
+/// \ref _createCountedBuffer() for elements that are stored on the host.
+template <typename T> [[nodiscard]] vma::UniqueBuffer _createCountedBuffer(
+	const std::vector<T> &elements,
+	vma::Allocator &allocator, TransientCommandBufferPool &cmdBufferPool, vk::Queue queue, vk::DeviceSize &size
+) {
+	return _createCountedBuffer<T>(
+		elements.size(),
+		[&](std::size_t first, std::span<T> chunk) {
+			std::copy_n(elements.begin() + first, chunk.size(), chunk.begin());
+		},
+		allocator, cmdBufferPool, queue, size
+	);
+}
+
+LightTreeBuffers LightTreeBuffers::create(
+	const LightTree &tree, vma::Allocator &allocator, TransientCommandBufferPool &cmdBufferPool, vk::Queue queue
+) {
+	LightTreeBuffers result;
+	result.nodeBuffer = _createCountedBuffer(tree.nodes, allocator, cmdBufferPool, queue, result.nodeBufferSize);
+	// the point lights of the scene are followed by the procedural lights, which are generated into the staging buffers
+	result.pointLightBuffer = _createCountedBuffer<shader::pointLight>(
+		tree.getPointLightCount(),
+		[&](std::size_t first, std::span<shader::pointLight> lights) {
+			std::size_t numSceneLights = 0;
+			if (first < tree.pointLights.size()) {
+				numSceneLights = std::min(tree.pointLights.size() - first, lights.size());
+				std::copy_n(tree.pointLights.begin() + first, numSceneLights, lights.begin());
+			}
+			if (numSceneLights < lights.size()) {
+				tree.proceduralLights.generate(
+					first + numSceneLights - tree.pointLights.size(), lights.subspan(numSceneLights)
+				);
+			}
+		},
+		allocator, cmdBufferPool, queue, result.pointLightBufferSize
+	);
+	result.triangleLightBuffer = _createCountedBuffer(
+		tree.triangleLights, allocator, cmdBufferPool, queue, result.triangleLightBufferSize
+	);
+	result.aliasTableBuffer = _createCountedBuffer(
+		tree.aliasTable, allocator, cmdBufferPool, queue, result.aliasTableBufferSize
+	);
+	result.totalIntensity = tree.nodes.empty() ? 0.0f : tree.nodes[0].boundsMin_intensity.w;
+	result.pointLightCount = static_cast<uint32_t>(tree.getPointLightCount());
+	result.triangleLightCount = static_cast<uint32_t>(tree.triangleLights.size());
+	result.firstProceduralLight = static_cast<uint32_t>(tree.pointLights.size());
+	result.proceduralLightCount = static_cast<uint32_t>(tree.proceduralLights.count);
+	return result;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "proceduralLights.h"
+#include "shaderIncludes.h"
+#include "transientCommandBuffer.h"
+#include "vma.h"
+
+/// Binary tree over the point and triangle lights of the scene, used to select lights in proportion to their estimated
+/// contribution to a shading point; see shaders/include/lightTree.glsl. Every node stores the bounds of its lights,
+/// a cone that contains their normals, and their total intensity, following Conty Estevez and Kulla, "Importance
+/// Sampling of Many Lights with Adaptive Tree Splitting". Leaves hold a single light. Point lights come first: the
+/// lights of \ref pointLights followed by those of \ref proceduralLights; the remaining light indices refer to
+/// \ref triangleLights.
+struct LightTree {
+	std::vector<shader::LightTreeNode> nodes; ///< Node 0 is the root.
+	std::vector<shader::pointLight> pointLights;
+	std::vector<shader::triLight> triangleLights;
+	/// Selects the lights in proportion to their intensity regardless of the shading point, with the same light indices
+	/// as the leaves. Used to sample the scene lights together with the emissive samples of the SDF.
+	std::vector<shader::aliasTableColumn> aliasTable;
+	/// Generated again when they are uploaded instead of being stored in \ref pointLights. The build still holds a
+	/// primitive for each of them, and \ref nodes and \ref aliasTable have entries for them.
+	ProceduralLights proceduralLights;
+
+	/// Splits the lights at the median of their centroids along the longest axis of the centroid bounds. The subtrees
+	/// below the top levels are built concurrently.
+	[[nodiscard]] static LightTree build(
+		std::vector<shader::pointLight> pointLights, std::vector<shader::triLight> triangleLights,
+		const ProceduralLights &proceduralLights = {}
+	);
+
+	[[nodiscard]] std::size_t getPointLightCount() const {
+		return pointLights.size() + proceduralLights.count;
+	}
+
+	/// Frees the host copies once they have been uploaded.
+	void releaseHostData() {
+		std::vector<shader::LightTreeNode>().swap(nodes);
+		std::vector<shader::pointLight>().swap(pointLights);
+		std::vector<shader::triLight>().swap(triangleLights);
+		std::vector<shader::aliasTableColumn>().swap(aliasTable);
+	}
+};
+
+/// Device copies of a \ref LightTree. Every buffer starts with the number of its entries and holds at least one
+/// element, so that the buffers can be bound even if the scene has no lights. The light buffers and the alias table are
+/// also used to sample the scene lights together with the emissive samples of the SDF. All buffers are device local and
+/// are streamed in chunks, so that they are never mapped in one piece.
+struct LightTreeBuffers {
+	vma::UniqueBuffer nodeBuffer;
+	vma::UniqueBuffer pointLightBuffer;
+	vma::UniqueBuffer triangleLightBuffer;
+	vma::UniqueBuffer aliasTableBuffer;
+	vk::DeviceSize nodeBufferSize = 0;
+	vk::DeviceSize pointLightBufferSize = 0;
+	vk::DeviceSize triangleLightBufferSize = 0;
+	vk::DeviceSize aliasTableBufferSize = 0;
+	uint32_t pointLightCount = 0;
+	uint32_t triangleLightCount = 0;
+	/// The procedural lights are the \p proceduralLightCount point lights that start at \p firstProceduralLight.
+	uint32_t firstProceduralLight = 0;
+	uint32_t proceduralLightCount = 0;
+	float totalIntensity = 0.0f; ///< Intensity of the root node, i.e., of all lights.
+
+	[[nodiscard]] vk::DeviceSize getDeviceMemorySize() const {
+		return
+			nodeBuffer.getAllocationSize() + pointLightBuffer.getAllocationSize() +
+			triangleLightBuffer.getAllocationSize() + aliasTableBuffer.getAllocationSize();
+	}
+
+	[[nodiscard]] static LightTreeBuffers create(
+		const LightTree&, vma::Allocator&, TransientCommandBufferPool&, vk::Queue
+	);
+};
@@ -13,16 +13,163 @@
 #include <stb_image_write.h>
 #undef STB_IMAGE_WRITE_IMPLEMENTATION
 
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
 #include <gflags/gflags.h>
 
+#include "aliasTable.h"
 #include "app.h"
+#include "sdfBenchmark.h"
 
 DEFINE_string(scene, "", "Path to the scene file.");
 DEFINE_bool(ignore_point_lights, false, "Ignore point lights in the scene.");
+DEFINE_bool(load_full_scene, false, "Load all scene resources, even those that no pass reads.");
+DEFINE_string(pipeline_cache, "pipeline_cache.bin", "Path to the file used to persist the Vulkan pipeline cache.");
+DEFINE_int32(fold_steps, 24, "Number of fold iterations of the SDF. Can be changed at runtime.");
+DEFINE_double(fold_floor, 1.0, "Fold size below which the SDF stops iterating. Can be changed at runtime.");
+DEFINE_string(emissive_iterations, "21", "Comma-separated list of fold iterations, below 64, that are emissive.");
+DEFINE_double(
+	sphere_trace_relaxation, 1.2,
+	"Over-relaxation factor of sphere tracing; 1 disables over-relaxation. Can be changed at runtime."
+);
+DEFINE_double(
+	sdf_lod_pixels, 1.0,
+	"Size in pixels below which G-buffer rays skip the fold cells of the SDF while away from the surface; 0 always "
+	"evaluates the full fold. Can be changed at runtime."
+);
+DEFINE_bool(sphere_trace_statistics, false, "Count the average number of sphere tracing steps per ray.");
+DEFINE_uint64(
+	cone_prepass_tile_size, 8,
+	"Edge length in pixels of the tiles of the G-buffer cone prepass, which finds where rays start marching; 0 "
+	"disables the prepass."
+);
+DEFINE_bool(
+	compute_gbuffer, false,
+	"Write the G-buffer with a compute shader in 8x8 tiles instead of a full screen quad. Can be changed at runtime."
+);
+DEFINE_bool(sdf_brick_map, true, "Bake the SDF into a sparse brick map that shaders trace far away from the surface.");
+DEFINE_bool(sdf_benchmark, false, "Measure the throughput of the CPU port of the SDF and exit.");
+DEFINE_uint64(
+	alias_table_benchmark, 0,
+	"If nonzero, build and verify alias tables for 10^3 up to this many random weights, print the timings, and exit."
+);
+DEFINE_uint64(
+	sdf_validation_points, 0,
+	"If nonzero, compare the CPU port of the SDF against the shaders at this many random points and exit."
+);
+DEFINE_string(sdf_brick_map_cache, "sdf_brick_map.bin", "Path to the file used to cache the baked SDF brick map.");
+DEFINE_string(
+	emissive_sample_pool_cache, "emissive_sample_pool.bin",
+	"Path to the file used to cache the baked points on the emissive surfaces of the SDF."
+);
+DEFINE_string(
+	triangle_light_cache, "triangle_lights.bin",
+	"Path to the file used to cache the emission of the triangle lights of the scene, integrated over their emissive "
+	"textures."
+);
+DEFINE_uint64(
+	procedural_lights, 0,
+	"Number of random point lights added to the lights of the scene, for stress testing light selection. Without a "
+	"scene, they are placed within the bounds of the SDF brick map, and ignored if it is disabled."
+);
+DEFINE_uint64(
+	default_procedural_lights, 200,
+	"Number of random point lights of scenes that have no lights, if -procedural_lights is 0."
+);
+DEFINE_uint64(procedural_light_seed, 0, "Seed of the random point lights; each depends on the seed and its index.");
+DEFINE_string(
+	procedural_light_distribution, "uniform",
+	"Distribution of the random point lights within the scene bounds: uniform, or clustered around random centers."
+);
+DEFINE_uint64(procedural_light_clusters, 64, "Number of clusters of the clustered random point lights.");
+DEFINE_double(
+	procedural_light_cluster_radius, 0.02,
+	"Standard deviation of the clustered random point lights around their centers, relative to the scene diagonal."
+);
+DEFINE_double(sdf_brick_map_extent, 256.0, "Half extent of the cube around the origin that the SDF is baked in.");
+DEFINE_double(sdf_brick_map_cell_size, 8.0, "Edge length of a cell of the SDF brick map.");
 
 int main(int argc, char **argv) {
 	gflags::ParseCommandLineFlags(&argc, &argv, true);
-	App app(FLAGS_scene, FLAGS_ignore_point_lights);
+
+	SdfSpecialization::Parameters sdfParameters;
+	sdfParameters.fold.steps = FLAGS_fold_steps;
+	sdfParameters.fold.floor = static_cast<float>(FLAGS_fold_floor);
+	sdfParameters.sphereTraceStatistics = FLAGS_sphere_trace_statistics;
+	sdfParameters.emissiveIterations = 0;
+	std::stringstream emissiveIterations(FLAGS_emissive_iterations);
+	for (std::string iteration; std::getline(emissiveIterations, iteration, ',');) {
+		int k = std::stoi(iteration);
+		if (k < 0 || k >= 64) {
+			std::cerr << "Emissive iteration " << k << " is out of range\n";
+			return 1;
+		}
+		sdfParameters.emissiveIterations |= 1ull << k;
+	}
+
+	if (FLAGS_alias_table_benchmark > 0) {
+		runAliasTableBenchmark(FLAGS_alias_table_benchmark);
+		return 0;
+	}
+	if (FLAGS_sdf_benchmark) {
+		runSdfBenchmark(sdfParameters.fold, 1 << 22, 1 << 16);
+		return 0;
+	}
+
+	std::optional<SdfBrickMap::Settings> sdfBrickMapSettings;
+	if (FLAGS_sdf_brick_map) {
+		SdfBrickMap::Settings settings;
+		settings.fold = sdfParameters.fold;
+		float extent = static_cast<float>(FLAGS_sdf_brick_map_extent);
+		settings.boundsMin = nvmath::vec3f(-extent, -extent, -extent);
+		settings.boundsMax = nvmath::vec3f(extent, extent, extent);
+		settings.cellSize = static_cast<float>(FLAGS_sdf_brick_map_cell_size);
+		sdfBrickMapSettings = settings;
+	}
+
+	ProceduralLights proceduralLights;
+	proceduralLights.count = FLAGS_procedural_lights;
+	proceduralLights.seed = FLAGS_procedural_light_seed;
+	if (auto distribution = ProceduralLights::parseDistribution(FLAGS_procedural_light_distribution)) {
+		proceduralLights.distribution = *distribution;
+	} else {
+		std::cerr << "Unknown light distribution " << FLAGS_procedural_light_distribution << "\n";
+		return 1;
+	}
+	proceduralLights.clusterCount = static_cast<uint32_t>(FLAGS_procedural_light_clusters);
+	proceduralLights.clusterRadius = static_cast<float>(FLAGS_procedural_light_cluster_radius);
+	// buffer sizes are 32 bits, and the light tree has almost two nodes per light
+	constexpr uint64_t maxProceduralLights = std::numeric_limits<uint32_t>::max() / (2 * sizeof(shader::LightTreeNode));
+	if (std::max(FLAGS_procedural_lights, FLAGS_default_procedural_lights) > maxProceduralLights) {
+		std::cerr << "Too many procedural lights: " <<
+			std::max(FLAGS_procedural_lights, FLAGS_default_procedural_lights) << "\n";
+		return 1;
+	}
+
+	App::Settings settings;
+	settings.scene = FLAGS_scene;
+	settings.ignorePointLights = FLAGS_ignore_point_lights;
+	settings.pipelineCachePath = FLAGS_pipeline_cache;
+	settings.loadFullScene = FLAGS_load_full_scene;
+	settings.sdfParameters = sdfParameters;
+	settings.sphereTraceRelaxation = static_cast<float>(FLAGS_sphere_trace_relaxation);
+	settings.sdfLodPixels = static_cast<float>(FLAGS_sdf_lod_pixels);
+	settings.conePrepassTileSize = static_cast<uint32_t>(FLAGS_cone_prepass_tile_size);
+	settings.computeGBuffer = FLAGS_compute_gbuffer;
+	settings.sdfBrickMap = sdfBrickMapSettings;
+	settings.sdfBrickMapCachePath = FLAGS_sdf_brick_map_cache;
+	settings.emissiveSamplePoolCachePath = FLAGS_emissive_sample_pool_cache;
+	settings.triangleLightCachePath = FLAGS_triangle_light_cache;
+	settings.proceduralLights = proceduralLights;
+	settings.defaultProceduralLightCount = FLAGS_default_procedural_lights;
+	App app(std::move(settings));
+	if (FLAGS_sdf_validation_points > 0) {
+		return app.validateSdf(static_cast<uint32_t>(FLAGS_sdf_validation_points)) ? 0 : 1;
+	}
 	app.mainLoop();
 	return 0;
 }
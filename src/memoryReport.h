@@ -0,0 +1,55 @@
+#pragma once
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+/// Host and device memory held by each subsystem, printed as a table.
+class MemoryReport {
+public:
+	/// Returns the number of bytes allocated by the given vector.
+	template <typename T> [[nodiscard]] inline static std::size_t hostBytes(const std::vector<T> &vec) {
+		return vec.capacity() * sizeof(T);
+	}
+
+	void add(std::string subsystem, std::size_t hostBytes, vk::DeviceSize deviceBytes) {
+		_entries.emplace_back(_Entry{ std::move(subsystem), hostBytes, deviceBytes });
+	}
+
+	void print(std::string_view title) const {
+		auto toMegabytes = [](std::size_t bytes) {
+			return static_cast<double>(bytes) / (1024.0 * 1024.0);
+		};
+
+		std::size_t totalHost = 0;
+		vk::DeviceSize totalDevice = 0;
+		std::cout << "Memory usage (" << title << "):\n";
+		std::cout << std::fixed << std::setprecision(2);
+		for (const _Entry &entry : _entries) {
+			std::cout <<
+				"    " << std::left << std::setw(24) << entry.subsystem << std::right <<
+				" host " << std::setw(10) << toMegabytes(entry.hostBytes) << " MB" <<
+				"  device " << std::setw(10) << toMegabytes(entry.deviceBytes) << " MB\n";
+			totalHost += entry.hostBytes;
+			totalDevice += entry.deviceBytes;
+		}
+		std::cout <<
+			"    " << std::left << std::setw(24) << "total" << std::right <<
+			" host " << std::setw(10) << toMegabytes(totalHost) << " MB" <<
+			"  device " << std::setw(10) << toMegabytes(totalDevice) << " MB\n";
+		std::cout.unsetf(std::ios::fixed);
+		std::cout << std::setprecision(6);
+	}
+private:
+	struct _Entry {
+		std::string subsystem;
+		std::size_t hostBytes = 0;
+		vk::DeviceSize deviceBytes = 0;
+	};
+
+	std::vector<_Entry> _entries;
+};
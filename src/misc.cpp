@@ -1,11 +1,14 @@
 #include "misc.h"
 
+#include <algorithm>
+#include <array>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
-#include <random>
-#include <queue>
+#include <future>
 
+#include "aliasTable.h"
+#include "triangleLights.h"
 #include "vma.h"
 
 
@@ -18,6 +21,48 @@ std::vector<char> readFile(const std::filesystem::path &path) {
 	return result;
 }
 
+std::optional<std::vector<char>> readCacheFile(
+	const CacheFileFormat &format, const std::filesystem::path &path,
+	const void *expectedHeader, std::size_t headerSize, std::size_t keyEnd
+) {
+	if (!std::filesystem::exists(path)) {
+		std::cout << format.name << ": no cache file at " << path << ", " << format.fallback << "\n";
+		return std::nullopt;
+	}
+	std::vector<char> file = readFile(path);
+	if (file.size() < headerSize) {
+		std::cout << format.name << ": " << path << " is truncated, " << format.fallback << "\n";
+		return std::nullopt;
+	}
+	if (std::memcmp(file.data(), expectedHeader, keyEnd) != 0) {
+		std::cout << format.name << ": " << path << " " << format.mismatch << ", " << format.fallback << "\n";
+		return std::nullopt;
+	}
+	return file;
+}
+
+void logInconsistentCacheFile(const CacheFileFormat &format, const std::filesystem::path &path) {
+	std::cout << format.name << ": " << path << " has an inconsistent size, " << format.fallback << "\n";
+}
+
+void writeCacheFile(
+	const CacheFileFormat &format, const std::filesystem::path &path, const void *header, std::size_t headerSize,
+	std::initializer_list<std::span<const std::byte>> payload
+) {
+	std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+	if (!fout) {
+		std::cout << format.name << ": failed to write " << path << "\n";
+		return;
+	}
+	fout.write(static_cast<const char*>(header), static_cast<std::streamsize>(headerSize));
+	std::size_t payloadSize = 0;
+	for (std::span<const std::byte> bytes : payload) {
+		fout.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		payloadSize += bytes.size();
+	}
+	std::cout << format.name << ": saved " << payloadSize << " bytes to " << path << "\n";
+}
+
 void vkCheck(vk::Result res) {
 	if (static_cast<int>(res) < 0) {
 		std::cout << "Vulkan error: " << vk::to_string(res) << "\n";
@@ -285,14 +330,55 @@ vma::UniqueImage loadTexture(
 	return image;
 }
 
-vma::UniqueImage loadTexture(
-	const tinygltf::Image &imageBinary, vk::Format format, uint32_t mipLevels,
+void streamToBuffer(
+	vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, vk::DeviceSize chunkSize,
+	const std::function<void(vk::DeviceSize, std::span<std::byte>)> &fill,
 	vma::Allocator &allocator, TransientCommandBufferPool &cmdBufferPool, vk::Queue queue
 ) {
-	return loadTexture(
-		imageBinary.image.data(), imageBinary.width, imageBinary.height, format, mipLevels,
-		allocator, cmdBufferPool, queue
-	);
+	if (size == 0) {
+		return;
+	}
+	chunkSize = std::min(chunkSize, size);
+	std::array<vma::UniqueBuffer, 2> staging;
+	std::array<std::byte*, 2> stagingData;
+	for (std::size_t i = 0; i < staging.size(); ++i) {
+		staging[i] = allocator.createBuffer(
+			static_cast<uint32_t>(chunkSize), vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_TO_GPU
+		);
+		stagingData[i] = staging[i].mapAs<std::byte>();
+	}
+
+	// copies run on their own threads since they hold the pool until they are complete; declared after the staging
+	// buffers so that pending copies are waited for before the buffers are destroyed
+	std::array<std::future<void>, 2> copies;
+	for (vk::DeviceSize chunk = 0; chunk * chunkSize < size; ++chunk) {
+		std::size_t slot = chunk % staging.size();
+		if (copies[slot].valid()) {
+			copies[slot].get();
+		}
+		vk::DeviceSize first = chunk * chunkSize;
+		vk::DeviceSize numBytes = std::min(chunkSize, size - first);
+		fill(first, std::span(stagingData[slot], static_cast<std::size_t>(numBytes)));
+		staging[slot].flush();
+
+		copies[slot] = std::async(std::launch::async, [&, slot, first, numBytes]() {
+			TransientCommandBuffer cmdBuffer = cmdBufferPool.begin(queue);
+			cmdBuffer->copyBuffer(staging[slot].get(), buffer, vk::BufferCopy(0, offset + first, numBytes));
+			vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead);
+			cmdBuffer->pipelineBarrier(
+				vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, barrier, {}, {}
+			);
+			cmdBuffer.submitAndWait();
+		});
+	}
+	for (std::future<void> &copy : copies) {
+		if (copy.valid()) {
+			copy.get();
+		}
+	}
+	for (vma::UniqueBuffer &stagingBuffer : staging) {
+		stagingBuffer.unmap();
+	}
 }
 
 bool hasEmissiveMaterial(const nvh::GltfScene& m_gltfScene) {
@@ -306,16 +392,43 @@ bool hasEmissiveMaterial(const nvh::GltfScene& m_gltfScene) {
 }
 
 
-void loadScene(const std::string& filename, nvh::GltfScene& m_gltfScene) {
+void loadScene(const std::string& filename, nvh::GltfScene& m_gltfScene, bool loadTextures) {
 	tinygltf::Model    tmodel;
 	tinygltf::TinyGLTF tcontext;
 	std::string        warn, error;
+	// decoding images is where most of the loading time goes for texture-heavy scenes, so images are either kept
+	// encoded or skipped
+	if (loadTextures) {
+		tcontext.SetImageLoader(
+			[](tinygltf::Image *image, const int, std::string*, std::string*, int, int, const unsigned char *bytes, int size, void*) {
+				image->image.assign(bytes, bytes + size);
+				return true;
+			},
+			nullptr
+		);
+	} else {
+		tcontext.SetImageLoader(
+			[](tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*) {
+				return true;
+			},
+			nullptr
+		);
+	}
 	if (!tcontext.LoadASCIIFromFile(&tmodel, &error, &warn, filename)) {
 		assert(!"Error while loading scene");
 	}
-	m_gltfScene.importDrawableNodes(tmodel, nvh::GltfAttributes::Normal | nvh::GltfAttributes::Texcoord_0 | nvh::GltfAttributes::Color_0 | nvh::GltfAttributes::Tangent);
+	nvh::GltfAttributes attributes =
+		nvh::GltfAttributes::Normal | nvh::GltfAttributes::Texcoord_0 | nvh::GltfAttributes::Color_0 |
+		nvh::GltfAttributes::Tangent;
+	if (loadTextures) {
+		// materials may sample their textures with the second set of texture coordinates
+		attributes = attributes | nvh::GltfAttributes::Texcoord_1;
+	}
+	m_gltfScene.importDrawableNodes(tmodel, attributes);
 	m_gltfScene.importMaterials(tmodel);
-	m_gltfScene.importTexutureImages(tmodel);
+	if (loadTextures) {
+		m_gltfScene.importTexutureImages(tmodel);
+	}
 
 	// Show gltf scene info
 	std::cout << "Show gltf scene info" << std::endl;
@@ -355,143 +468,33 @@ std::vector<shader::pointLight> collectPointLightsFromScene(const nvh::GltfScene
 	return result;
 }
 
-std::vector<shader::pointLight> generateRandomPointLights(
-	std::size_t count, nvmath::vec3 min, nvmath::vec3 max,
-	std::uniform_real_distribution<float> distR,
-	std::uniform_real_distribution<float> distG,
-	std::uniform_real_distribution<float> distB
+void collectLightsFromScene(
+	const nvh::GltfScene &scene, std::vector<shader::pointLight> &pointLights,
+	std::vector<shader::triLight> &triangleLights, const std::filesystem::path &triangleLightCachePath
 ) {
-	std::uniform_real_distribution<float> distX(min.x, max.x);
-	std::uniform_real_distribution<float> distY(min.y, max.y);
-	std::uniform_real_distribution<float> distZ(min.z, max.z);
-	std::default_random_engine rand;
-
-	std::vector<shader::pointLight> result(count);
-	for (shader::pointLight &light : result) {
-		light.pos = nvmath::vec4(distX(rand), distY(rand), distZ(rand), 1.0f);
-		light.color_luminance = nvmath::vec4(distR(rand), distG(rand), distB(rand), 0.0f);
-		light.color_luminance.w = shader::luminance(
-			light.color_luminance.x, light.color_luminance.y, light.color_luminance.z
-		);
-	}
-	return result;
-}
-
-std::vector<shader::triLight> collectTriangleLightsFromScene(const nvh::GltfScene &scene) {
-	std::vector<shader::triLight> result;
-	for (const nvh::GltfNode &node : scene.m_nodes) {
-		const nvh::GltfPrimMesh &mesh = scene.m_primMeshes[node.primMesh];
-		const nvh::GltfMaterial &material = scene.m_materials[mesh.materialIndex];
-		if (material.emissiveFactor.sq_norm() > 1e-6) {
-			const uint32_t *indices = scene.m_indices.data() + mesh.firstIndex;
-			const nvmath::vec3* pos = scene.m_positions.data() + mesh.vertexOffset;
-			for (uint32_t i = 0; i < mesh.indexCount; i += 3, indices += 3) {
-				// triangle
-				vec4 p1 = node.worldMatrix * nvmath::vec4(pos[indices[0]], 1.0f);
-				vec4 p2 = node.worldMatrix * nvmath::vec4(pos[indices[1]], 1.0f);
-				vec4 p3 = node.worldMatrix * nvmath::vec4(pos[indices[2]], 1.0f);
-				vec3 p1_vec3(p1.x, p1.y, p1.z), p2_vec3(p2.x, p2.y, p2.z), p3_vec3(p3.x, p3.y, p3.z);
-
-				vec3 normal = nvmath::cross(p2_vec3 - p1_vec3, p3_vec3 - p1_vec3);
-				float area = normal.norm();
-				normal /= area;
-				area *= 0.5f;
-
-				float emissionLuminance = shader::luminance(
-					material.emissiveFactor.x, material.emissiveFactor.y, material.emissiveFactor.z
-				);
-
-				shader::triLight tmpTriLight{ p1, p2, p3, vec4(material.emissiveFactor, 0.0), area };
-				result.push_back(shader::triLight{
-					.p1 = p1, .p2 = p2, .p3 = p3,
-					.emission_luminance = nvmath::vec4(material.emissiveFactor, emissionLuminance),
-					.normalArea = nvmath::vec4(normal, area)
-					});
-			}
-		}
-	}
-	return result;
+	pointLights = collectPointLightsFromScene(scene);
+	triangleLights = collectTriangleLightsFromScene(scene, triangleLightCachePath);
 }
 
-// https://blog.csdn.net/haolexiao/article/details/65157026
-// Vose alias method
 [[nodiscard]] std::vector<shader::aliasTableColumn> createAliasTable(std::vector<shader::pointLight>& ptLights, std::vector<shader::triLight>& triLights) {
-	std::queue<int> biggerThanOneQueue;
-	std::queue<int> smallerThanOneQueue;
 	std::vector<float> lightProbVec;
-	float powerSum = 0.f;
-	std::size_t lightNum = 0;
 
 	// Init samplers' probability
 	if (!ptLights.empty()) {
-		lightNum = ptLights.size();
-
 		for (auto& itr_ptLight : ptLights) {
-			powerSum += itr_ptLight.color_luminance.w;
 			lightProbVec.push_back(itr_ptLight.color_luminance.w);
 		}	
 	}
 	else {
-		lightNum = triLights.size();
-
 		for (auto& itr_triLight : triLights) {
 			float triLightPower = itr_triLight.emission_luminance.w * itr_triLight.normalArea.w;
-			powerSum += triLightPower;
 			lightProbVec.push_back(triLightPower);
 		}
 	}
 
-	std::vector<shader::aliasTableColumn> result(lightNum, shader::aliasTableColumn{ .prob = 0.f, .alias = -1, .oriProb = 0.f });
-
-	for (int i = 0; i < lightProbVec.size(); ++i) {
-		result[i].oriProb = lightProbVec[i] / powerSum;
-		// result[i].oriProb = 1.f / lightNum;
-		lightProbVec[i] = float(lightProbVec.size()) * lightProbVec[i] / powerSum;
-		if (lightProbVec[i] >= 1.f) {
-			biggerThanOneQueue.push(i);
-		}
-		else {
-			smallerThanOneQueue.push(i);
-		}
-	}
-
-	// Construct Alias Table
-	while (!biggerThanOneQueue.empty() && !smallerThanOneQueue.empty()) {
-		int g = biggerThanOneQueue.front();
-		biggerThanOneQueue.pop();
-		int l = smallerThanOneQueue.front();
-		smallerThanOneQueue.pop();
-
-		result[l].prob = lightProbVec[l];
-		result[l].alias = g;
-
-		lightProbVec[g] = (lightProbVec[g] + lightProbVec[l]) - 1.f;
-
-		if (lightProbVec[g] < 1.f) {
-			smallerThanOneQueue.push(g);
-		}
-		else {
-			biggerThanOneQueue.push(g);
-		}
-	}
-
-	while (!biggerThanOneQueue.empty()) {
-		int g = biggerThanOneQueue.front();
-		biggerThanOneQueue.pop();
-		result[g].prob = 1.f;
-		result[g].alias = g;
-	}
-
-	while (!smallerThanOneQueue.empty()) {
-		int l = smallerThanOneQueue.front();
-		smallerThanOneQueue.pop();
-		result[l].prob = 1.f;
-		result[l].alias = l;
-	}
-
-	for (shader::aliasTableColumn &col : result) {
-		col.aliasOriProb = result[col.alias].oriProb;
-	}
+	return createAliasTable(std::move(lightProbVec));
+}
 
-	return result;
+[[nodiscard]] std::vector<shader::aliasTableColumn> createAliasTable(std::vector<float> lightProbVec) {
+	return buildAliasTable(lightProbVec);
 }
@@ -2,10 +2,15 @@
 
 #include <unordered_set>
 #include <vector>
+#include <cstring>
 #include <filesystem>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
 #include <optional>
-#include <random>
+#include <span>
+#include <string_view>
+#include <type_traits>
 
 #include <vulkan/vulkan.hpp>
 
@@ -32,6 +37,69 @@ template <typename Struct, typename PreArray> [[nodiscard]] constexpr std::size_
 [[nodiscard]] std::vector<char> readFile(const std::filesystem::path&);
 
 
+// cache files
+/// Names a kind of cache file in the messages of \ref loadCacheFile() and \ref saveCacheFile(), which all read
+/// "<name>: <path> ...".
+struct CacheFileFormat {
+	std::string_view name; ///< E.g., "SDF brick map".
+	std::string_view fallback; ///< What happens when there is no valid file, e.g., "baking".
+	std::string_view mismatch; ///< Why the key of a file doesn't match, e.g., "was baked with different settings".
+};
+
+/// A cache file loaded by \ref loadCacheFile(): a header followed by the payload.
+template <typename Header> struct CacheFile {
+	Header header;
+	std::vector<char> bytes; ///< The whole file, including the header.
+
+	[[nodiscard]] const char *getPayload() const {
+		return bytes.data() + sizeof(Header);
+	}
+};
+
+/// Reads a cache file whose header of \p headerSize bytes starts with the first \p keyEnd bytes of \p expectedHeader.
+/// Returns nothing, and logs why, if the file doesn't exist, is truncated, or has a different key.
+[[nodiscard]] std::optional<std::vector<char>> readCacheFile(
+	const CacheFileFormat&, const std::filesystem::path&,
+	const void *expectedHeader, std::size_t headerSize, std::size_t keyEnd
+);
+void logInconsistentCacheFile(const CacheFileFormat&, const std::filesystem::path&);
+/// Writes \p headerSize bytes of \p header followed by the concatenation of \p payload, and logs the result.
+void writeCacheFile(
+	const CacheFileFormat&, const std::filesystem::path&, const void *header, std::size_t headerSize,
+	std::initializer_list<std::span<const std::byte>> payload
+);
+
+/// Loads a cache file written by \ref saveCacheFile(). The fields of the header before byte \p keyEnd identify what
+/// the payload was computed from and must equal those of \p expected, and the payload must be
+/// \p getPayloadSize(header) bytes long. Every reason for rejecting the file is logged.
+template <typename Header, typename GetPayloadSize> [[nodiscard]] std::optional<CacheFile<Header>> loadCacheFile(
+	const CacheFileFormat &format, const std::filesystem::path &path, const Header &expected, std::size_t keyEnd,
+	GetPayloadSize &&getPayloadSize
+) {
+	static_assert(std::is_trivially_copyable_v<Header>);
+	std::optional<std::vector<char>> bytes = readCacheFile(format, path, &expected, sizeof(Header), keyEnd);
+	if (!bytes) {
+		return std::nullopt;
+	}
+	CacheFile<Header> result;
+	std::memcpy(&result.header, bytes->data(), sizeof(Header));
+	if (bytes->size() != sizeof(Header) + getPayloadSize(result.header)) {
+		logInconsistentCacheFile(format, path);
+		return std::nullopt;
+	}
+	result.bytes = std::move(*bytes);
+	return result;
+}
+/// Writes \p header followed by the concatenation of \p payload, which \ref loadCacheFile() reads back.
+template <typename Header> void saveCacheFile(
+	const CacheFileFormat &format, const std::filesystem::path &path, const Header &header,
+	std::initializer_list<std::span<const std::byte>> payload
+) {
+	static_assert(std::is_trivially_copyable_v<Header>);
+	writeCacheFile(format, path, &header, sizeof(Header), payload);
+}
+
+
 // vulkan helpers
 void vkCheck(vk::Result);
 inline void vkCheck(VkResult res) {
@@ -120,23 +188,33 @@ vma::UniqueImage loadTexture(
 	vma::Allocator&, TransientCommandBufferPool&, vk::Queue
 );
 
-vma::UniqueImage loadTexture(
-	const tinygltf::Image&, vk::Format, uint32_t mipLevels,
+/// Fills \p size bytes of \p buffer starting at byte \p offset through two mapped staging buffers of at most
+/// \p chunkSize bytes: \p fill writes the bytes that start at the given offset into the data into a staging buffer,
+/// and the next chunk is filled while the previous one is copied, so no host visible copy of the whole data is ever
+/// allocated. Chunks start at multiples of \p chunkSize. Shaders can read the data once this returns.
+void streamToBuffer(
+	vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, vk::DeviceSize chunkSize,
+	const std::function<void(vk::DeviceSize, std::span<std::byte>)> &fill,
 	vma::Allocator&, TransientCommandBufferPool&, vk::Queue
 );
 
 
 // gltf utilities
-void loadScene(const std::string& filename, nvh::GltfScene& m_gltfScene);
+/// Loads the given glTF scene. Images are not decoded: if \p loadTextures is true, the encoded image files are imported
+/// into \ref nvh::GltfScene::m_textures for consumers to decode only the images they need, otherwise they're skipped
+/// entirely.
+void loadScene(const std::string& filename, nvh::GltfScene& m_gltfScene, bool loadTextures = true);
 
 [[nodiscard]] std::vector<shader::pointLight> collectPointLightsFromScene(const nvh::GltfScene&);
-[[nodiscard]] std::vector<shader::pointLight> generateRandomPointLights(
-	std::size_t count, nvmath::vec3 min, nvmath::vec3 max,
-	std::uniform_real_distribution<float> distR = std::uniform_real_distribution<float>(0.0f, 1.0f),
-	std::uniform_real_distribution<float> distG = std::uniform_real_distribution<float>(0.0f, 1.0f),
-	std::uniform_real_distribution<float> distB = std::uniform_real_distribution<float>(0.0f, 1.0f)
-);
 
-[[nodiscard]] std::vector<shader::triLight> collectTriangleLightsFromScene(const nvh::GltfScene&);
+/// Collects the point and triangle lights of the scene; see \ref collectTriangleLightsFromScene() for the triangle
+/// lights and \p triangleLightCachePath. Random lights are added by \ref ProceduralLights.
+void collectLightsFromScene(
+	const nvh::GltfScene&, std::vector<shader::pointLight> &pointLights, std::vector<shader::triLight> &triangleLights,
+	const std::filesystem::path &triangleLightCachePath = {}
+);
 
 [[nodiscard]] std::vector<shader::aliasTableColumn> createAliasTable(std::vector<shader::pointLight>& ptLights, std::vector<shader::triLight>& triLights);
+/// Builds an alias table that selects each index with a probability proportional to the given weight; see
+/// \ref buildAliasTable().
+[[nodiscard]] std::vector<shader::aliasTableColumn> createAliasTable(std::vector<float> weights);
@@ -42,6 +42,9 @@ protected:
 	vk::Format _swapchainFormat;
 	vk::UniquePipelineLayout _pipelineLayout;
 
+	std::string_view _getName() const override {
+		return "demo";
+	}
 	vk::UniqueRenderPass _createPass(vk::Device device) override {
 		std::vector<vk::AttachmentDescription> colorAttachments;
 		colorAttachments.emplace_back()
@@ -2,6 +2,10 @@
 
 #include "pass.h"
 
+/// Draws the emissive samples of a frame from the baked \ref EmissiveSamplePool and builds the CDF over their luminance
+/// that the ReSTIR pass selects them with. Then presamples the light tiles and the ReGIR grid from the samples and the
+/// scene lights, whose alias table is static; see shaders/emissiveSample.comp, emissiveSampleCdf.comp,
+/// emissiveSampleTiles.comp, regirGrid.comp, and include/emissiveSampleCdf.glsl.
 class EmissiveSamplePass : public Pass {
 public:
 	[[nodiscard]] vk::DescriptorSetLayout getDescriptorSetLayout() const {
@@ -15,11 +19,41 @@ public:
 			{}, {}, {}, {}
 		);
 		buffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[0].get());
-		buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _layout.get(), 0, { descriptorSet }, {});
+		buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _layout.get(), 0, descriptorSet, {});
 		SampleParams params{ sampleCount, seed };
 		buffer.pushConstants(_layout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(SampleParams), &params);
 		buffer.dispatch(ceilDiv<uint32_t>(sampleCount, 64u), 1, 1);
 
+		vk::MemoryBarrier samplesBarrier;
+		samplesBarrier
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+		buffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+			{}, samplesBarrier, {}, {}
+		);
+		buffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[1].get());
+		buffer.dispatch(1, 1, 1);
+
+		if (lightTileSampleCount > 0) {
+			buffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+				{}, samplesBarrier, {}, {}
+			);
+			buffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[2].get());
+			buffer.dispatch(ceilDiv<uint32_t>(lightTileSampleCount, 64u), 1, 1);
+		}
+		if (regirReservoirCount > 0) {
+			if (lightTileSampleCount == 0) {
+				buffer.pipelineBarrier(
+					vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+					{}, samplesBarrier, {}, {}
+				);
+			}
+			buffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[3].get());
+			buffer.dispatch(ceilDiv<uint32_t>(regirReservoirCount, 64u), 1, 1);
+		}
+
 		vk::MemoryBarrier barrier;
 		barrier
 			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
@@ -34,6 +68,10 @@ public:
 	vk::DescriptorSet descriptorSet;
 	uint32_t sampleCount = 0;
 	uint32_t seed = 0;
+	/// Total number of samples in all light tiles, or 0 to skip presampling them.
+	uint32_t lightTileSampleCount = 0;
+	/// Total number of light reservoirs in the ReGIR grid, or 0 to skip filling them.
+	uint32_t regirReservoirCount = 0;
 protected:
 	struct SampleParams {
 		uint32_t sampleCount;
@@ -41,9 +79,15 @@ protected:
 	};
 
 	Shader _shader;
+	Shader _cdfShader;
+	Shader _tileShader;
+	Shader _regirShader;
 	vk::UniqueDescriptorSetLayout _descriptorLayout;
 	vk::UniquePipelineLayout _layout;
 
+	std::string_view _getName() const override {
+		return "emissive sample";
+	}
 	vk::UniqueRenderPass _createPass(vk::Device) override {
 		return {};
 	}
@@ -55,30 +99,59 @@ protected:
 			.setStage(_shader.getStageInfo())
 			.setLayout(_layout.get());
 		result.emplace_back(pipelineInfo);
+
+		vk::ComputePipelineCreateInfo cdfPipelineInfo;
+		cdfPipelineInfo
+			.setStage(_cdfShader.getStageInfo())
+			.setLayout(_layout.get());
+		result.emplace_back(cdfPipelineInfo);
+
+		vk::ComputePipelineCreateInfo tilePipelineInfo;
+		tilePipelineInfo
+			.setStage(_tileShader.getStageInfo())
+			.setLayout(_layout.get());
+		result.emplace_back(tilePipelineInfo);
+
+		vk::ComputePipelineCreateInfo regirPipelineInfo;
+		regirPipelineInfo
+			.setStage(_regirShader.getStageInfo())
+			.setLayout(_layout.get());
+		result.emplace_back(regirPipelineInfo);
 		return result;
 	}
 
 	void _initialize(vk::Device dev) override {
 		_shader = Shader::load(dev, "shaders/emissiveSample.comp.spv", "main", vk::ShaderStageFlagBits::eCompute);
+		_cdfShader = Shader::load(dev, "shaders/emissiveSampleCdf.comp.spv", "main", vk::ShaderStageFlagBits::eCompute);
+		_tileShader = Shader::load(
+			dev, "shaders/emissiveSampleTiles.comp.spv", "main", vk::ShaderStageFlagBits::eCompute
+		);
+		_regirShader = Shader::load(dev, "shaders/regirGrid.comp.spv", "main", vk::ShaderStageFlagBits::eCompute);
 
-		std::array<vk::DescriptorSetLayoutBinding, 2> bindings{
+		std::array<vk::DescriptorSetLayoutBinding, 10> bindings{
 			vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
-			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(6, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(7, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(8, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(9, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
 		};
 
 		vk::DescriptorSetLayoutCreateInfo descriptorInfo;
 		descriptorInfo.setBindings(bindings);
 		_descriptorLayout = dev.createDescriptorSetLayoutUnique(descriptorInfo);
 
-		std::array<vk::DescriptorSetLayout, 1> descriptorLayouts{ _descriptorLayout.get() };
-
 		std::array<vk::PushConstantRange, 1> ranges{
 			vk::PushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(SampleParams))
 		};
 
 		vk::PipelineLayoutCreateInfo layoutInfo;
 		layoutInfo
-			.setSetLayouts(descriptorLayouts)
+			.setSetLayouts(_descriptorLayout.get())
 			.setPushConstantRanges(ranges);
 
 		_layout = dev.createPipelineLayoutUnique(layoutInfo);
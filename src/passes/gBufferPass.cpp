@@ -9,6 +9,7 @@ void GBuffer::resize(vma::Allocator &allocator, vk::Device device, vk::Extent2D
 	_framebuffer.reset();
 
 	_albedoView.reset();
+	_albedoStorageView.reset();
 	_normalView.reset();
 	_materialPropertiesView.reset();
 	_worldPosView.reset();
@@ -22,30 +23,38 @@ void GBuffer::resize(vma::Allocator &allocator, vk::Device device, vk::Extent2D
 
 	const Formats &formats = Formats::get();
 
-	_albedoBuffer = allocator.createImage2D(
-		extent, formats.albedo,
-		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled
-	);
-	_normalBuffer = allocator.createImage2D(
-		extent, formats.normal,
-		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled
-	);
-	_materialPropertiesBuffer = allocator.createImage2D(
-		extent, formats.materialProperties,
-		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled
-	);
-	_worldPosBuffer = allocator.createImage2D(
-		extent, formats.worldPosition,
-		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled
-	);
-	_depthBuffer = allocator.createImage2D(
-		extent, formats.depth,
-		vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled
-	);
+	// all buffers are written either as attachments by the graphics path or as storage images by the compute path
+	vk::ImageUsageFlags usage =
+		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+	{ // sRGB formats cannot be used for storage images, so the compute path writes the albedo through a UNORM view
+		vk::ImageCreateInfo albedoInfo;
+		albedoInfo
+			.setFlags(vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage)
+			.setImageType(vk::ImageType::e2D)
+			.setExtent(vk::Extent3D(extent, 1))
+			.setFormat(formats.albedo)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setMipLevels(1)
+			.setArrayLayers(1)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setInitialLayout(vk::ImageLayout::eUndefined)
+			.setUsage(usage)
+			.setSharingMode(vk::SharingMode::eExclusive);
+		VmaAllocationCreateInfo allocationInfo{};
+		allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		_albedoBuffer = allocator.createImage(albedoInfo, allocationInfo);
+	}
+	_normalBuffer = allocator.createImage2D(extent, formats.normal, usage);
+	_materialPropertiesBuffer = allocator.createImage2D(extent, formats.materialProperties, usage);
+	_worldPosBuffer = allocator.createImage2D(extent, formats.worldPosition, usage);
+	_depthBuffer = allocator.createImage2D(extent, formats.depth, usage);
 
 	_albedoView = createImageView2D(
 		device, _albedoBuffer.get(), formats.albedo, vk::ImageAspectFlagBits::eColor
 	);
+	_albedoStorageView = createImageView2D(
+		device, _albedoBuffer.get(), formats.albedoStorage, vk::ImageAspectFlagBits::eColor
+	);
 	_normalView = createImageView2D(
 		device, _normalBuffer.get(), formats.normal, vk::ImageAspectFlagBits::eColor
 	);
@@ -56,7 +65,7 @@ void GBuffer::resize(vma::Allocator &allocator, vk::Device device, vk::Extent2D
 		device, _worldPosBuffer.get(), formats.worldPosition, vk::ImageAspectFlagBits::eColor
 	);
 	_depthView = createImageView2D(
-		device, _depthBuffer.get(), formats.depth, formats.depthAspect
+		device, _depthBuffer.get(), formats.depth, vk::ImageAspectFlagBits::eColor
 	);
 
 	std::array<vk::ImageView, 5> attachments{
@@ -74,10 +83,17 @@ void GBuffer::resize(vma::Allocator &allocator, vk::Device device, vk::Extent2D
 
 void GBuffer::Formats::initialize(vk::PhysicalDevice physicalDevice) {
 	assert(!_formatsInitialized);
+	// every buffer must be writable by both G-buffer paths
+	vk::FormatFeatureFlags features =
+		vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eStorageImage;
 	_gBufferFormats.albedo = findSupportedFormat(
 		{ vk::Format::eR8G8B8A8Srgb },
 		physicalDevice, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eColorAttachment
 	);
+	_gBufferFormats.albedoStorage = findSupportedFormat(
+		{ vk::Format::eR8G8B8A8Unorm },
+		physicalDevice, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eStorageImage
+	);
 	_gBufferFormats.normal = findSupportedFormat(
 		{
 			vk::Format::eR16G16B16Snorm,
@@ -86,24 +102,20 @@ void GBuffer::Formats::initialize(vk::PhysicalDevice physicalDevice) {
 			vk::Format::eR16G16B16A16Sfloat,
 			vk::Format::eR32G32B32Sfloat
 		},
-		physicalDevice, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eColorAttachment
+		physicalDevice, vk::ImageTiling::eOptimal, features
 	);
 	_gBufferFormats.depth = findSupportedFormat(
-		{ vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint },
-		physicalDevice, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment
+		{ vk::Format::eR32Sfloat },
+		physicalDevice, vk::ImageTiling::eOptimal, features
 	);
 	_gBufferFormats.materialProperties = findSupportedFormat(
-		{ vk::Format::eR16G16Unorm },
-		physicalDevice, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eColorAttachment
+		{ vk::Format::eR16G16Unorm, vk::Format::eR16G16Sfloat },
+		physicalDevice, vk::ImageTiling::eOptimal, features
 	);
 	_gBufferFormats.worldPosition = findSupportedFormat(
 		{ vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat },
-		physicalDevice, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eColorAttachment
+		physicalDevice, vk::ImageTiling::eOptimal, features
 	);
-	_gBufferFormats.depthAspect = vk::ImageAspectFlagBits::eDepth;
-	if (_gBufferFormats.depth != vk::Format::eD32Sfloat) {
-		_gBufferFormats.depthAspect |= vk::ImageAspectFlagBits::eStencil;
-	}
 	_formatsInitialized = true;
 }
 
@@ -113,13 +125,122 @@ const GBuffer::Formats &GBuffer::Formats::get() {
 }
 
 
+void GBufferPass::Resources::resizeConePrepass(vma::Allocator &allocator, vk::Device device, vk::Extent2D extent) {
+	coneStartDistanceView.reset();
+	coneStartDistance.reset();
+
+	// a single texel keeps the descriptor valid when the prepass is unavailable
+	coneTileCount = vk::Extent2D(1, 1);
+	if (coneTileSize > 0) {
+		coneTileCount = vk::Extent2D(ceilDiv(extent.width, coneTileSize), ceilDiv(extent.height, coneTileSize));
+	}
+	coneStartDistance = allocator.createImage2D(
+		coneTileCount, vk::Format::eR32Sfloat, vk::ImageUsageFlagBits::eStorage
+	);
+	coneStartDistanceView = createImageView2D(
+		device, coneStartDistance.get(), vk::Format::eR32Sfloat, vk::ImageAspectFlagBits::eColor
+	);
+
+	vk::DescriptorImageInfo imageInfo(nullptr, coneStartDistanceView.get(), vk::ImageLayout::eGeneral);
+	vk::WriteDescriptorSet write;
+	write
+		.setDstSet(uniformDescriptor.get())
+		.setDstBinding(1)
+		.setDescriptorType(vk::DescriptorType::eStorageImage)
+		.setImageInfo(imageInfo);
+	device.updateDescriptorSets(write, {});
+}
+
+void GBufferPass::initializeFrameDescriptorSet(
+	const GBuffer &current, const GBuffer &previous, vk::Device device, vk::DescriptorSet set
+) const {
+	std::vector<vk::WriteDescriptorSet> descriptorWrite;
+
+	vk::DescriptorImageInfo historyInfo(
+		_sampler.get(), previous.getWorldPositionView(), vk::ImageLayout::eShaderReadOnlyOptimal
+	);
+	descriptorWrite.emplace_back()
+		.setDstSet(set)
+		.setDstBinding(0)
+		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+		.setImageInfo(historyInfo);
+
+	std::array<vk::DescriptorImageInfo, 5> storageInfo{
+		vk::DescriptorImageInfo(nullptr, current.getAlbedoStorageView(), vk::ImageLayout::eGeneral),
+		vk::DescriptorImageInfo(nullptr, current.getNormalView(), vk::ImageLayout::eGeneral),
+		vk::DescriptorImageInfo(nullptr, current.getMaterialPropertiesView(), vk::ImageLayout::eGeneral),
+		vk::DescriptorImageInfo(nullptr, current.getWorldPositionView(), vk::ImageLayout::eGeneral),
+		vk::DescriptorImageInfo(nullptr, current.getDepthView(), vk::ImageLayout::eGeneral)
+	};
+	for (std::size_t i = 0; i < storageInfo.size(); ++i) {
+		descriptorWrite.emplace_back()
+			.setDstSet(set)
+			.setDstBinding(static_cast<uint32_t>(i + 1))
+			.setDescriptorType(vk::DescriptorType::eStorageImage)
+			.setPImageInfo(&storageInfo[i])
+			.setDescriptorCount(1);
+	}
+
+	device.updateDescriptorSets(descriptorWrite, {});
+}
+
+
 void GBufferPass::issueCommands(vk::CommandBuffer commandBuffer, vk::Framebuffer framebuffer) const {
+	// the start distances of the previous frame are not needed
+	vk::ImageMemoryBarrier coneStartDistanceBarrier;
+	coneStartDistanceBarrier
+		.setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+		.setDstAccessMask(vk::AccessFlagBits::eShaderWrite)
+		.setOldLayout(vk::ImageLayout::eUndefined)
+		.setNewLayout(vk::ImageLayout::eGeneral)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setImage(descriptorSets->coneStartDistance.get())
+		.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eComputeShader,
+		{}, {}, {}, coneStartDistanceBarrier
+	);
+
+	if (useConePrepass && descriptorSets->coneTileSize > 0) {
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[1].get());
+		commandBuffer.bindDescriptorSets(
+			vk::PipelineBindPoint::eCompute, _pipelineLayout.get(), 0,
+			{ descriptorSets->uniformDescriptor.get(), sdfDescriptorSet }, {}
+		);
+		_ComputeParams params = _getComputeParams();
+		commandBuffer.pushConstants(
+			_pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(_ComputeParams), &params
+		);
+		commandBuffer.dispatch(
+			ceilDiv<uint32_t>(descriptorSets->coneTileCount.width, 8),
+			ceilDiv<uint32_t>(descriptorSets->coneTileCount.height, 8),
+			1
+		);
+	}
+
+	coneStartDistanceBarrier
+		.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+		.setOldLayout(vk::ImageLayout::eGeneral);
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+		{}, {}, {}, coneStartDistanceBarrier
+	);
+
+	if (useCompute) {
+		_issueComputeCommands(commandBuffer);
+		return;
+	}
+
 	std::array<vk::ClearValue, 5> clearValues{
 		vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f }),
 		vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f }),
 		vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f }),
 		vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f }),
-		vk::ClearDepthStencilValue(1.0f)
+		vk::ClearColorValue(std::array<float, 4>{ 1.0f, 0.0f, 0.0f, 0.0f })
 	};
 	vk::RenderPassBeginInfo passBeginInfo;
 	passBeginInfo
@@ -132,13 +253,62 @@ void GBufferPass::issueCommands(vk::CommandBuffer commandBuffer, vk::Framebuffer
 	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, getPipelines()[0].get());
 	commandBuffer.bindDescriptorSets(
 		vk::PipelineBindPoint::eGraphics, _pipelineLayout.get(), 0,
-		{ descriptorSets->uniformDescriptor.get() }, {}
+		{ descriptorSets->uniformDescriptor.get(), sdfDescriptorSet, frameDescriptorSet }, {}
 	);
 	commandBuffer.draw(4, 1, 0, 0);
 
 	commandBuffer.endRenderPass();
 }
 
+void GBufferPass::_issueComputeCommands(vk::CommandBuffer commandBuffer) const {
+	std::array<vk::Image, 5> images{
+		computeTarget->getAlbedoBuffer(), computeTarget->getNormalBuffer(),
+		computeTarget->getMaterialPropertiesBuffer(), computeTarget->getWorldPositionBuffer(),
+		computeTarget->getDepthBuffer()
+	};
+	// the previous contents are overwritten, so only reads of the previous frame need to finish
+	std::array<vk::ImageMemoryBarrier, 5> barriers;
+	for (std::size_t i = 0; i < images.size(); ++i) {
+		barriers[i]
+			.setSrcAccessMask(vk::AccessFlags())
+			.setDstAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setOldLayout(vk::ImageLayout::eUndefined)
+			.setNewLayout(vk::ImageLayout::eGeneral)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setImage(images[i])
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+	}
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eComputeShader,
+		{}, {}, {}, barriers
+	);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[2].get());
+	commandBuffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute, _pipelineLayout.get(), 0,
+		{ descriptorSets->uniformDescriptor.get(), sdfDescriptorSet, frameDescriptorSet }, {}
+	);
+	_ComputeParams params = _getComputeParams();
+	commandBuffer.pushConstants(
+		_pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(_ComputeParams), &params
+	);
+	commandBuffer.dispatch(ceilDiv<uint32_t>(_bufferExtent.width, 8), ceilDiv<uint32_t>(_bufferExtent.height, 8), 1);
+
+	// same final layout as the render pass of the graphics path
+	for (vk::ImageMemoryBarrier &barrier : barriers) {
+		barrier
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+			.setOldLayout(vk::ImageLayout::eGeneral)
+			.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+	}
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eAllCommands,
+		{}, {}, {}, barriers
+	);
+}
+
 vk::UniqueRenderPass GBufferPass::_createPass(vk::Device device) {
 	const GBuffer::Formats &formats = GBuffer::Formats::get();
 
@@ -179,6 +349,8 @@ vk::UniqueRenderPass GBufferPass::_createPass(vk::Device device) {
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
 		.setInitialLayout(vk::ImageLayout::eUndefined)
 		.setFinalLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+	// the depth is written as a color, since depth formats cannot be written by the compute path; the single full
+	// screen quad needs no depth test
 	attachments.emplace_back()
 		.setFormat(formats.depth)
 		.setSamples(vk::SampleCountFlagBits::e1)
@@ -189,23 +361,18 @@ vk::UniqueRenderPass GBufferPass::_createPass(vk::Device device) {
 		.setInitialLayout(vk::ImageLayout::eUndefined)
 		.setFinalLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
 
-	std::array<vk::AttachmentReference, 4> colorAttachmentReferences{
+	std::array<vk::AttachmentReference, 5> colorAttachmentReferences{
 		vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal),
 		vk::AttachmentReference(1, vk::ImageLayout::eColorAttachmentOptimal),
 		vk::AttachmentReference(2, vk::ImageLayout::eColorAttachmentOptimal),
-		vk::AttachmentReference(3, vk::ImageLayout::eColorAttachmentOptimal)
+		vk::AttachmentReference(3, vk::ImageLayout::eColorAttachmentOptimal),
+		vk::AttachmentReference(4, vk::ImageLayout::eColorAttachmentOptimal)
 	};
 
-	vk::AttachmentReference depthAttachmentReference;
-	depthAttachmentReference
-		.setAttachment(4)
-		.setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
-
 	std::vector<vk::SubpassDescription> subpasses;
 	subpasses.emplace_back()
 		.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
-		.setColorAttachments(colorAttachmentReferences)
-		.setPDepthStencilAttachment(&depthAttachmentReference);
+		.setColorAttachments(colorAttachmentReferences);
 
 	std::vector<vk::SubpassDependency> dependencies;
 	dependencies.emplace_back()
@@ -249,44 +416,86 @@ std::vector<Pass::PipelineCreationInfo> GBufferPass::_getPipelineCreationInfo()
 	info.rasterizationState = GraphicsPipelineCreationInfo::getDefaultRasterizationState();
 	info.rasterizationState.setCullMode(vk::CullModeFlagBits::eNone);
 
-	info.depthStencilState = GraphicsPipelineCreationInfo::getDefaultDepthTestState();
-
 	info.multisampleState = GraphicsPipelineCreationInfo::getNoMultisampleState();
 
 	info.attachmentColorBlendStorage.emplace_back(GraphicsPipelineCreationInfo::getNoBlendAttachment());
 	info.attachmentColorBlendStorage.emplace_back(GraphicsPipelineCreationInfo::getNoBlendAttachment());
 	info.attachmentColorBlendStorage.emplace_back(GraphicsPipelineCreationInfo::getNoBlendAttachment());
 	info.attachmentColorBlendStorage.emplace_back(GraphicsPipelineCreationInfo::getNoBlendAttachment());
+	info.attachmentColorBlendStorage.emplace_back(GraphicsPipelineCreationInfo::getNoBlendAttachment());
 	info.colorBlendState.setAttachments(info.attachmentColorBlendStorage);
 
-	info.shaderStages.emplace_back(_frag.getStageInfo());
+	info.shaderStages.emplace_back(_frag.getStageInfo(SdfSpecialization::getInfo()));
 	info.shaderStages.emplace_back(_vert.getStageInfo());
 
 	info.pipelineLayout = _pipelineLayout.get();
 
 	result.emplace_back(std::move(info));
 
+	vk::ComputePipelineCreateInfo conePrepassInfo;
+	conePrepassInfo
+		.setStage(_conePrepass.getStageInfo(SdfSpecialization::getInfo()))
+		.setLayout(_pipelineLayout.get());
+	result.emplace_back(conePrepassInfo);
+
+	vk::ComputePipelineCreateInfo computeInfo;
+	computeInfo
+		.setStage(_compute.getStageInfo(SdfSpecialization::getInfo()))
+		.setLayout(_pipelineLayout.get());
+	result.emplace_back(computeInfo);
+
 	return result;
 }
 
 void GBufferPass::_initialize(vk::Device dev) {
 	_vert = Shader::load(dev, "shaders/gBuffer.vert.spv", "main", vk::ShaderStageFlagBits::eVertex);
 	_frag = Shader::load(dev, "shaders/gBuffer.frag.spv", "main", vk::ShaderStageFlagBits::eFragment);
-
-	std::array<vk::DescriptorSetLayoutBinding, 1> uniformsDescriptorBindings{
-		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment)
+	_conePrepass = Shader::load(
+		dev, "shaders/sdfConePrepass.comp.spv", "main", vk::ShaderStageFlagBits::eCompute
+	);
+	_compute = Shader::load(dev, "shaders/gBuffer.comp.spv", "main", vk::ShaderStageFlagBits::eCompute);
+
+	std::array<vk::DescriptorSetLayoutBinding, 2> uniformsDescriptorBindings{
+		vk::DescriptorSetLayoutBinding(
+			0, vk::DescriptorType::eUniformBuffer, 1,
+			vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute
+		),
+		vk::DescriptorSetLayoutBinding(
+			1, vk::DescriptorType::eStorageImage, 1,
+			vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute
+		)
 	};
 	vk::DescriptorSetLayoutCreateInfo uniformsDescriptorSetInfo;
 	uniformsDescriptorSetInfo.setBindings(uniformsDescriptorBindings);
 	_uniformsDescriptorSetLayout = dev.createDescriptorSetLayoutUnique(uniformsDescriptorSetInfo);
+	_sdfDescriptorSetLayout = SdfBrickMapBuffers::createDescriptorSetLayout(dev);
+
+	_sampler = createSampler(dev, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest);
+	std::array<vk::DescriptorSetLayoutBinding, 6> frameDescriptorBindings{
+		vk::DescriptorSetLayoutBinding(
+			0, vk::DescriptorType::eCombinedImageSampler, 1,
+			vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute
+		),
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+		vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+		vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+		vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+		vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute)
+	};
+	vk::DescriptorSetLayoutCreateInfo frameDescriptorSetInfo;
+	frameDescriptorSetInfo.setBindings(frameDescriptorBindings);
+	_frameDescriptorSetLayout = dev.createDescriptorSetLayoutUnique(frameDescriptorSetInfo);
 
-	std::array<vk::DescriptorSetLayout, 1> descriptorSetLayouts{
-		_uniformsDescriptorSetLayout.get()
+	std::array<vk::DescriptorSetLayout, 3> descriptorSetLayouts{
+		_uniformsDescriptorSetLayout.get(), _sdfDescriptorSetLayout.get(), _frameDescriptorSetLayout.get()
 	};
 
+	vk::PushConstantRange computePushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(_ComputeParams));
+
 	vk::PipelineLayoutCreateInfo pipelineInfo;
 	pipelineInfo
-		.setSetLayouts(descriptorSetLayouts);
+		.setSetLayouts(descriptorSetLayouts)
+		.setPushConstantRanges(computePushConstants);
 	_pipelineLayout = dev.createPipelineLayoutUnique(pipelineInfo);
 
 	Pass::_initialize(dev);
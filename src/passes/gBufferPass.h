@@ -6,6 +6,8 @@
 #include "../vma.h"
 #include "../misc.h"
 #include "../shader.h"
+#include "../sdfBrickMap.h"
+#include "../sdfSpecialization.h"
 
 class GBufferPass;
 
@@ -30,6 +32,10 @@ public:
 	[[nodiscard]] vk::ImageView getAlbedoView() const {
 		return _albedoView.get();
 	}
+	/// UNORM view of the albedo buffer through which the compute path writes sRGB-encoded values.
+	[[nodiscard]] vk::ImageView getAlbedoStorageView() const {
+		return _albedoStorageView.get();
+	}
 	[[nodiscard]] vk::ImageView getNormalView() const {
 		return _normalView.get();
 	}
@@ -47,6 +53,13 @@ public:
 		return _framebuffer.get();
 	}
 
+	[[nodiscard]] vk::DeviceSize getDeviceMemorySize() const {
+		return
+			_albedoBuffer.getAllocationSize() + _normalBuffer.getAllocationSize() +
+			_materialPropertiesBuffer.getAllocationSize() + _worldPosBuffer.getAllocationSize() +
+			_depthBuffer.getAllocationSize();
+	}
+
 	void resize(vma::Allocator&, vk::Device, vk::Extent2D, Pass&);
 
 	[[nodiscard]] inline static GBuffer create(
@@ -59,11 +72,11 @@ public:
 
 	struct Formats {
 		vk::Format albedo;
+		vk::Format albedoStorage;
 		vk::Format normal;
-		vk::Format depth;
+		vk::Format depth; ///< A color format, since the compute path cannot write depth formats.
 		vk::Format materialProperties;
 		vk::Format worldPosition;
-		vk::ImageAspectFlags depthAspect;
 
 		[[nodiscard]] static void initialize(vk::PhysicalDevice);
 		[[nodiscard]] static const Formats &get();
@@ -76,6 +89,7 @@ private:
 	vma::UniqueImage _depthBuffer;
 
 	vk::UniqueImageView _albedoView;
+	vk::UniqueImageView _albedoStorageView;
 	vk::UniqueImageView _normalView;
 	vk::UniqueImageView _materialPropertiesView;
 	vk::UniqueImageView _worldPosView;
@@ -95,11 +109,29 @@ public:
 		nvmath::vec4 cameraPosition;
 		nvmath::vec4 sdfParams;
 		nvmath::vec4 sdfScene;
+		nvmath::uvec4 conePrepass; ///< x: edge length of a prepass tile in pixels, or 0 if the prepass is disabled.
+		nvmath::mat4 prevProjectionViewMatrix;
+		/// x: nonzero if the hits of the previous frame can seed the march, y: fraction of the reprojected hit distance
+		/// by which the march backs off, z: number of SDF samples that may be spent on proving the skipped segment
+		/// empty.
+		nvmath::vec4f temporalHitDistance;
+		/// x: growth of the level of detail of the SDF per unit of distance along a view ray, or 0 to disable the LOD;
+		/// see \p GetDistMatLod() in SDF.glsl.
+		nvmath::vec4f sdfLod;
 	};
 
 	struct Resources {
 		vma::UniqueBuffer uniformBuffer;
 		vk::UniqueDescriptorSet uniformDescriptor;
+
+		/// Distances from which the G-buffer rays of each tile start marching, written by the cone prepass.
+		vma::UniqueImage coneStartDistance;
+		vk::UniqueImageView coneStartDistanceView;
+		uint32_t coneTileSize = 0; ///< Edge length of a prepass tile in pixels, or 0 if the prepass is unavailable.
+		vk::Extent2D coneTileCount;
+
+		/// (Re)creates \ref coneStartDistance for the given G-buffer size and writes it to \ref uniformDescriptor.
+		void resizeConePrepass(vma::Allocator&, vk::Device, vk::Extent2D);
 	};
 
 	GBufferPass() = default;
@@ -114,20 +146,59 @@ public:
 	[[nodiscard]] vk::DescriptorSetLayout getUniformsDescriptorSetLayout() const {
 		return _uniformsDescriptorSetLayout.get();
 	}
+	[[nodiscard]] vk::DescriptorSetLayout getSdfDescriptorSetLayout() const {
+		return _sdfDescriptorSetLayout.get();
+	}
+	[[nodiscard]] vk::DescriptorSetLayout getFrameDescriptorSetLayout() const {
+		return _frameDescriptorSetLayout.get();
+	}
+
+	/// Writes the G-buffer that is rendered in a frame, along with the world positions of the G-buffer rendered in the
+	/// previous frame, to the given frame set.
+	void initializeFrameDescriptorSet(
+		const GBuffer &current, const GBuffer &previous, vk::Device, vk::DescriptorSet
+	) const;
 
 	const Resources *descriptorSets;
+	vk::DescriptorSet sdfDescriptorSet;
+	vk::DescriptorSet frameDescriptorSet;
+	/// The G-buffer written by the compute path, which is the one \ref frameDescriptorSet has been initialized with.
+	const GBuffer *computeTarget = nullptr;
+	bool useConePrepass = true;
+	/// Whether to write the G-buffer with gBuffer.comp in 8x8 tiles instead of rendering a full screen quad.
+	bool useCompute = false;
 protected:
 	explicit GBufferPass(vk::Extent2D extent) : _bufferExtent(extent) {
 	}
 
+	/// Push constants of the cone prepass and of the compute path.
+	struct _ComputeParams {
+		nvmath::uvec2 bufferSize;
+		nvmath::uvec2 tileCount; ///< Number of cone prepass tiles.
+	};
+
 	vk::Extent2D _bufferExtent;
-	Shader _vert, _frag;
+	Shader _vert, _frag, _conePrepass, _compute;
 	vk::UniqueDescriptorSetLayout _uniformsDescriptorSetLayout;
+	vk::UniqueDescriptorSetLayout _sdfDescriptorSetLayout;
+	vk::UniqueDescriptorSetLayout _frameDescriptorSetLayout;
+	vk::UniqueSampler _sampler;
 	vk::UniquePipelineLayout _pipelineLayout;
 
+	std::string_view _getName() const override {
+		return "G-buffer";
+	}
 	vk::UniqueRenderPass _createPass(vk::Device) override;
 	std::vector<PipelineCreationInfo> _getPipelineCreationInfo() override;
 
+	[[nodiscard]] _ComputeParams _getComputeParams() const {
+		_ComputeParams result;
+		result.bufferSize = nvmath::uvec2(_bufferExtent.width, _bufferExtent.height);
+		result.tileCount = nvmath::uvec2(descriptorSets->coneTileCount.width, descriptorSets->coneTileCount.height);
+		return result;
+	}
+	void _issueComputeCommands(vk::CommandBuffer) const;
+
 
 	void _initialize(vk::Device dev) override;
 };
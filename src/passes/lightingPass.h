@@ -4,6 +4,7 @@
 #include "gBufferPass.h"
 #include "shaderIncludes.h"
 #include "../aabbTreeBuilder.h"
+#include "../lightTree.h"
 #include "../shaders/include/gBufferDebugConstants.glsl"
 
 class LightingPass : public Pass {
@@ -48,7 +49,7 @@ public:
 	void initializeDescriptorSetFor(
 		const GBuffer &gBuffer, vk::Buffer emissiveSampleBuffer, vk::DeviceSize emissiveSampleBufferSize,
 		vk::Buffer uniformBuffer, vk::Buffer reservoirBuffer, vk::DeviceSize reservoirBufferSize,
-		vk::Device device, vk::DescriptorSet set
+		const LightTreeBuffers &lightTreeBuffers, vk::Device device, vk::DescriptorSet set
 	) {
 		std::vector<vk::WriteDescriptorSet> descriptorWrite;
 
@@ -70,6 +71,12 @@ public:
 		vk::DescriptorBufferInfo uniformInfo(uniformBuffer, 0, sizeof(shader::LightingPassUniforms));
 		vk::DescriptorBufferInfo reservoirsInfo(reservoirBuffer, 0, reservoirBufferSize);
 		vk::DescriptorBufferInfo emissiveSamplesInfo(emissiveSampleBuffer, 0, emissiveSampleBufferSize);
+		vk::DescriptorBufferInfo pointLightsInfo(
+			lightTreeBuffers.pointLightBuffer.get(), 0, lightTreeBuffers.pointLightBufferSize
+		);
+		vk::DescriptorBufferInfo triangleLightsInfo(
+			lightTreeBuffers.triangleLightBuffer.get(), 0, lightTreeBuffers.triangleLightBufferSize
+		);
 		descriptorWrite.emplace_back()
 			.setDstSet(set)
 			.setDstBinding(4)
@@ -85,6 +92,16 @@ public:
 			.setDstBinding(6)
 			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
 			.setBufferInfo(emissiveSamplesInfo);
+		descriptorWrite.emplace_back()
+			.setDstSet(set)
+			.setDstBinding(7)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(pointLightsInfo);
+		descriptorWrite.emplace_back()
+			.setDstSet(set)
+			.setDstBinding(8)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(triangleLightsInfo);
 
 		device.updateDescriptorSets(descriptorWrite, {});
 	}
@@ -101,6 +118,9 @@ protected:
 	vk::UniquePipelineLayout _pipelineLayout;
 	vk::UniqueDescriptorSetLayout _descriptorSetLayout;
 
+	std::string_view _getName() const override {
+		return "lighting";
+	}
 	vk::UniqueRenderPass _createPass(vk::Device device) override {
 		std::array<vk::AttachmentDescription, 1> colorAttachments;
 		colorAttachments[0]
@@ -167,14 +187,16 @@ protected:
 
 		_sampler = createSampler(dev, vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest);
 
-		std::array<vk::DescriptorSetLayoutBinding, 7> descriptorBindings{
+		std::array<vk::DescriptorSetLayoutBinding, 9> descriptorBindings{
 			vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment),
 			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment),
 			vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment),
 			vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment),
 			vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eFragment),
 			vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment),
-			vk::DescriptorSetLayoutBinding(6, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment)
+			vk::DescriptorSetLayoutBinding(6, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment),
+			vk::DescriptorSetLayoutBinding(7, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment),
+			vk::DescriptorSetLayoutBinding(8, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment)
 		};
 		vk::DescriptorSetLayoutCreateInfo descriptorInfo;
 		descriptorInfo
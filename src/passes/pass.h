@@ -5,6 +5,8 @@
 #include <vulkan/vulkan.hpp>
 
 #include "../misc.h"
+#include "../pipelineCache.h"
+#include "../sceneResourceUsage.h"
 
 class SceneBuffers;
 
@@ -102,13 +104,34 @@ public:
 
 	virtual void issueCommands(vk::CommandBuffer, vk::Framebuffer) const = 0;
 
+	/// Scene resources read by the shaders of this pass. Passes that read scene resources hide this function.
+	[[nodiscard]] inline static SceneResourceUsage getSceneResourceUsage() {
+		return SceneResourceUsage();
+	}
+
 	[[nodiscard]] vk::RenderPass getPass() const {
 		return _pass.get();
 	}
 	[[nodiscard]] const std::vector<vk::UniquePipeline> &getPipelines() const {
+		assert(_pipelinesCreated);
 		return _pipelines;
 	}
 
+	/// Creates the pipelines of a pass that defers pipeline creation, if that hasn't happened yet.
+	void ensurePipelines(vk::Device dev) {
+		if (!_pipelinesCreated) {
+			_pipelines = _createPipelines(dev);
+			_pipelinesCreated = true;
+		}
+	}
+	/// Recreates the pipelines that have already been created so that they pick up changed specialization constants.
+	/// Pipelines must not be in use.
+	void respecialize(vk::Device dev) {
+		if (_pipelinesCreated) {
+			_recreatePipelines(dev);
+		}
+	}
+
 	template <typename PassT, typename ...Args> [[nodiscard]] inline static PassT create(
 		vk::Device dev, Args &&...args
 	) {
@@ -120,6 +143,15 @@ public:
 protected:
 	Pass() = default;
 
+	/// Passes that are only used by some render paths return \p true here so that their pipelines are only created
+	/// once \ref ensurePipelines() is called.
+	[[nodiscard]] virtual bool _hasLazyPipelines() const {
+		return false;
+	}
+	/// Name used when logging pipeline creation.
+	[[nodiscard]] virtual std::string_view _getName() const {
+		return "pass";
+	}
 	[[nodiscard]] virtual vk::UniqueRenderPass _createPass(vk::Device) = 0;
 	[[nodiscard]] virtual std::vector<PipelineCreationInfo> _getPipelineCreationInfo() = 0;
 	[[nodiscard]] vk::UniquePipeline _createGraphicsPipeline(
@@ -149,9 +181,11 @@ protected:
 			.setPDynamicState(&dynamicStateInfo)
 			.setRenderPass(_pass.get())
 			.setSubpass(subpass);
-		auto [result, pipe] = dev.createGraphicsPipelineUnique(nullptr, thisPipelineInfo).asTuple();
-		vkCheck(result);
-		return std::move(pipe);
+		return PipelineCache::timed(_getName(), [&]() {
+			auto [result, pipe] = dev.createGraphicsPipelineUnique(PipelineCache::get(), thisPipelineInfo).asTuple();
+			vkCheck(result);
+			return std::move(pipe);
+		});
 	}
 	[[nodiscard]] virtual std::vector<vk::UniquePipeline> _createPipelines(vk::Device dev) {
 		std::vector<PipelineCreationInfo> pipelineInfo = _getPipelineCreationInfo();
@@ -163,9 +197,11 @@ protected:
 				);
 			} else if (std::holds_alternative<vk::ComputePipelineCreateInfo>(pipelineInfo[i])) {
 				const auto &info = std::get<vk::ComputePipelineCreateInfo>(pipelineInfo[i]);
-				auto [result, pipe] = dev.createComputePipelineUnique(nullptr, info);
-				vkCheck(result);
-				pipelines[i] = std::move(pipe);
+				pipelines[i] = PipelineCache::timed(_getName(), [&]() {
+					auto [result, pipe] = dev.createComputePipelineUnique(PipelineCache::get(), info);
+					vkCheck(result);
+					return std::move(pipe);
+				});
 			}
 		}
 		return pipelines;
@@ -173,12 +209,16 @@ protected:
 	void _recreatePipelines(vk::Device dev) {
 		_pipelines.clear();
 		_pipelines = _createPipelines(dev);
+		_pipelinesCreated = true;
 	}
 	virtual void _initialize(vk::Device dev) {
 		_pass = _createPass(dev);
-		_pipelines = _createPipelines(dev);
+		if (!_hasLazyPipelines()) {
+			ensurePipelines(dev);
+		}
 	}
 private:
 	vk::UniqueRenderPass _pass;
 	std::vector<vk::UniquePipeline> _pipelines;
+	bool _pipelinesCreated = false;
 };
@@ -4,6 +4,9 @@
 
 #include "pass.h"
 #include "vma.h"
+#include "../lightTree.h"
+#include "../sdfBrickMap.h"
+#include "../sdfSpecialization.h"
 
 class RestirPass : public Pass {
 	friend Pass;
@@ -33,6 +36,35 @@ public:
 		}
 	}
 
+	/// Both visibility test methods march the SDF, so the AABB tree and acceleration structure bindings of the ray trace
+	/// descriptor sets are declared but never read. The light tree is an optional source of initial candidates.
+	[[nodiscard]] inline static SceneResourceUsage getSceneResourceUsage() {
+		SceneResourceUsage result;
+		result.lightTree = true;
+		return result;
+	}
+
+	/// Creates the pipeline used by the given visibility test method if it hasn't been created yet. The software
+	/// pipeline and the ray tracing pipeline with its shader binding table are created independently and kept once
+	/// created, so switching back to a previously used method is free.
+	void prepareRenderPath(bool software, vk::Device dev, vma::Allocator &allocator, vk::PhysicalDevice physicalDev) {
+		if (software) {
+			ensurePipelines(dev);
+		} else if (!_hwRayTracePipeline) {
+			_hwRayTracePipeline = _createHardwareRayTracePipeline(dev);
+			createShaderBindingTable(dev, allocator, physicalDev);
+		}
+	}
+	/// Recreates the pipelines that have already been created after the SDF specialization constants have changed.
+	void respecialize(vk::Device dev, vma::Allocator &allocator, vk::PhysicalDevice physicalDev) {
+		Pass::respecialize(dev);
+		if (_hwRayTracePipeline) {
+			_hwRayTracePipeline.reset();
+			_hwRayTracePipeline = _createHardwareRayTracePipeline(dev);
+			createShaderBindingTable(dev, allocator, physicalDev);
+		}
+	}
+
 	void issueCommands(vk::CommandBuffer commandBuffer, vk::Framebuffer) const override {
 		commandBuffer.pipelineBarrier(
 			vk::PipelineStageFlagBits::eAllCommands,
@@ -44,7 +76,7 @@ public:
 			commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[0].get());
 			commandBuffer.bindDescriptorSets(
 				vk::PipelineBindPoint::eCompute, _swPipelineLayout.get(), 0,
-				{ staticDescriptorSet, frameDescriptorSet, raytraceDescriptorSet }, {}
+				{ staticDescriptorSet, frameDescriptorSet, raytraceDescriptorSet, sdfDescriptorSet }, {}
 			);
 			commandBuffer.dispatch(
 				ceilDiv<uint32_t>(bufferExtent.width, OMNI_GROUP_SIZE_X),
@@ -52,10 +84,11 @@ public:
 				1
 			);
 		} else {
+			assert(_hwRayTracePipeline);
 			commandBuffer.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, _hwRayTracePipeline.get());
 			commandBuffer.bindDescriptorSets(
 				vk::PipelineBindPoint::eRayTracingKHR, _hwPipelineLayout.get(), 0,
-				{ staticDescriptorSet, frameDescriptorSet, raytraceDescriptorSet }, {}
+				{ staticDescriptorSet, frameDescriptorSet, raytraceDescriptorSet, sdfDescriptorSet }, {}
 			);
 			commandBuffer.traceRaysKHR(rayGenSBT, rayMissSBT, rayHitSBT, rayCallSBT, bufferExtent.width, bufferExtent.height, 1, *dynamicLoader);
 		}
@@ -119,12 +152,28 @@ public:
 
 	void initializeStaticDescriptorSetFor(
 		vk::Buffer emissiveSampleBuffer, vk::DeviceSize emissiveSampleBufferSize,
+		vk::Buffer emissiveSampleCdfBuffer, vk::DeviceSize emissiveSampleCdfBufferSize,
+		vk::Buffer lightTileBuffer, vk::DeviceSize lightTileBufferSize,
+		const LightTreeBuffers &lightTreeBuffers, vk::Buffer regirGridBuffer, vk::DeviceSize regirGridBufferSize,
 		vk::Buffer uniformBuffer, vk::Device device, vk::DescriptorSet set
 	) {
-		std::array<vk::WriteDescriptorSet, 2> writes;
+		std::array<vk::WriteDescriptorSet, 9> writes;
 
 		vk::DescriptorBufferInfo emissiveSampleInfo(emissiveSampleBuffer, 0, emissiveSampleBufferSize);
 		vk::DescriptorBufferInfo uniformBufferInfo(uniformBuffer, 0, sizeof(shader::RestirUniforms));
+		vk::DescriptorBufferInfo emissiveSampleCdfInfo(emissiveSampleCdfBuffer, 0, emissiveSampleCdfBufferSize);
+		vk::DescriptorBufferInfo lightTileInfo(lightTileBuffer, 0, lightTileBufferSize);
+		vk::DescriptorBufferInfo lightTreeInfo(lightTreeBuffers.nodeBuffer.get(), 0, lightTreeBuffers.nodeBufferSize);
+		vk::DescriptorBufferInfo pointLightInfo(
+			lightTreeBuffers.pointLightBuffer.get(), 0, lightTreeBuffers.pointLightBufferSize
+		);
+		vk::DescriptorBufferInfo triangleLightInfo(
+			lightTreeBuffers.triangleLightBuffer.get(), 0, lightTreeBuffers.triangleLightBufferSize
+		);
+		vk::DescriptorBufferInfo regirGridInfo(regirGridBuffer, 0, regirGridBufferSize);
+		vk::DescriptorBufferInfo sceneLightAliasTableInfo(
+			lightTreeBuffers.aliasTableBuffer.get(), 0, lightTreeBuffers.aliasTableBufferSize
+		);
 
 		writes[0]
 			.setDstSet(set)
@@ -138,6 +187,48 @@ public:
 			.setDescriptorType(vk::DescriptorType::eUniformBuffer)
 			.setBufferInfo(uniformBufferInfo);
 
+		writes[2]
+			.setDstSet(set)
+			.setDstBinding(2)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(emissiveSampleCdfInfo);
+
+		writes[3]
+			.setDstSet(set)
+			.setDstBinding(3)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(lightTileInfo);
+
+		writes[4]
+			.setDstSet(set)
+			.setDstBinding(4)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(lightTreeInfo);
+
+		writes[5]
+			.setDstSet(set)
+			.setDstBinding(5)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(pointLightInfo);
+
+		writes[6]
+			.setDstSet(set)
+			.setDstBinding(6)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(triangleLightInfo);
+
+		writes[7]
+			.setDstSet(set)
+			.setDstBinding(7)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(regirGridInfo);
+
+		writes[8]
+			.setDstSet(set)
+			.setDstBinding(8)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setBufferInfo(sceneLightAliasTableInfo);
+
 		device.updateDescriptorSets(writes, {});
 	}
 
@@ -302,6 +393,7 @@ public:
 	vk::DescriptorSet staticDescriptorSet;
 	vk::DescriptorSet frameDescriptorSet;
 	vk::DescriptorSet raytraceDescriptorSet;
+	vk::DescriptorSet sdfDescriptorSet;
 
 	vk::Extent2D bufferExtent;
 	const vk::DispatchLoaderDynamic *dynamicLoader = nullptr;
@@ -319,8 +411,15 @@ protected:
 	vk::UniqueDescriptorSetLayout _frameDescriptorSetLayout;
 	vk::UniqueDescriptorSetLayout _hwRayTraceDescriptorSetLayout;
 	vk::UniqueDescriptorSetLayout _swRayTraceDescriptorSetLayout;
+	vk::UniqueDescriptorSetLayout _sdfDescriptorSetLayout;
 	vk::UniqueHandle<vk::Pipeline, vk::DispatchLoaderDynamic> _hwRayTracePipeline;
 
+	[[nodiscard]] bool _hasLazyPipelines() const override {
+		return true;
+	}
+	[[nodiscard]] std::string_view _getName() const override {
+		return "ReSTIR software";
+	}
 	[[nodiscard]] vk::UniqueRenderPass _createPass(vk::Device) override {
 		return {};
 	}
@@ -335,16 +434,46 @@ protected:
 		{ // compute pipeline
 			vk::ComputePipelineCreateInfo pipelineInfo;
 			pipelineInfo
-				.setStage(_software.getStageInfo())
+				.setStage(_software.getStageInfo(SdfSpecialization::getInfo()))
 				.setLayout(_swPipelineLayout.get());
-			auto [res, pipeline] = dev.createComputePipelineUnique(nullptr, pipelineInfo);
-			vkCheck(res);
-			pipelines.emplace_back(std::move(pipeline));
+			pipelines.emplace_back(PipelineCache::timed(_getName(), [&]() {
+				auto [res, pipeline] = dev.createComputePipelineUnique(PipelineCache::get(), pipelineInfo);
+				vkCheck(res);
+				return std::move(pipeline);
+			}));
 		}
 
 		return pipelines;
 	}
 
+	[[nodiscard]] vk::UniqueHandle<vk::Pipeline, vk::DispatchLoaderDynamic> _createHardwareRayTracePipeline(vk::Device dev) {
+		std::vector<vk::RayTracingShaderGroupCreateInfoKHR> shaderGroups;
+		shaderGroups.emplace_back(getRtGenShaderGroupCreate());
+		shaderGroups.emplace_back(getRtHitShaderGroupCreate());
+		shaderGroups.emplace_back(getRtMissShaderGroupCreate());
+		shaderGroups.emplace_back(getRtShadowMissShaderGroupCreate());
+
+		std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+		shaderStages.emplace_back(_rayGen.getStageInfo(SdfSpecialization::getInfo()));
+		shaderStages.emplace_back(_rayChit.getStageInfo());
+		shaderStages.emplace_back(_rayMiss.getStageInfo());
+		shaderStages.emplace_back(_rayShadowMiss.getStageInfo());
+
+		vk::RayTracingPipelineCreateInfoKHR rtPipelineInfo;
+		rtPipelineInfo
+			.setStages(shaderStages)
+			.setGroups(shaderGroups)
+			.setMaxPipelineRayRecursionDepth(1)
+			.setLayout(_hwPipelineLayout.get());
+		return PipelineCache::timed("ReSTIR hardware", [&]() {
+			auto [res, pipeline] = dev.createRayTracingPipelineKHRUnique(
+				nullptr, PipelineCache::get(), rtPipelineInfo, nullptr, *dynamicLoader
+			);
+			vkCheck(res);
+			return std::move(pipeline);
+		});
+	}
+
 	void _initialize(vk::Device dev) override {
 		constexpr vk::ShaderStageFlags stageFlags = vk::ShaderStageFlagBits::eRaygenKHR | vk::ShaderStageFlagBits::eCompute;
 
@@ -357,9 +486,16 @@ protected:
 		_software = Shader::load(dev, "shaders/restirOmniSoftware.comp.spv", "main", vk::ShaderStageFlagBits::eCompute);
 
 
-		std::array<vk::DescriptorSetLayoutBinding, 2> staticBindings{
+		std::array<vk::DescriptorSetLayoutBinding, 9> staticBindings{
 			vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, stageFlags),
-			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eUniformBuffer, 1, stageFlags)
+			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eUniformBuffer, 1, stageFlags),
+			vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, stageFlags),
+			vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, stageFlags),
+			vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, stageFlags),
+			vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eStorageBuffer, 1, stageFlags),
+			vk::DescriptorSetLayoutBinding(6, vk::DescriptorType::eStorageBuffer, 1, stageFlags),
+			vk::DescriptorSetLayoutBinding(7, vk::DescriptorType::eStorageBuffer, 1, stageFlags),
+			vk::DescriptorSetLayoutBinding(8, vk::DescriptorType::eStorageBuffer, 1, stageFlags)
 		};
 
 		vk::DescriptorSetLayoutCreateInfo staticLayoutInfo;
@@ -409,17 +545,21 @@ protected:
 		swRayTraceLayoutInfo.setBindings(swRayTraceBindings);
 		_swRayTraceDescriptorSetLayout = dev.createDescriptorSetLayoutUnique(swRayTraceLayoutInfo);
 
+		_sdfDescriptorSetLayout = SdfBrickMapBuffers::createDescriptorSetLayout(dev);
 
-		std::array<vk::DescriptorSetLayout, 3> hwDescriptorLayouts{
-			_staticDescriptorSetLayout.get(), _frameDescriptorSetLayout.get(), _hwRayTraceDescriptorSetLayout.get()
+
+		std::array<vk::DescriptorSetLayout, 4> hwDescriptorLayouts{
+			_staticDescriptorSetLayout.get(), _frameDescriptorSetLayout.get(), _hwRayTraceDescriptorSetLayout.get(),
+			_sdfDescriptorSetLayout.get()
 		};
 
 		vk::PipelineLayoutCreateInfo hwPipelineLayoutInfo;
 		hwPipelineLayoutInfo.setSetLayouts(hwDescriptorLayouts);
 		_hwPipelineLayout = dev.createPipelineLayoutUnique(hwPipelineLayoutInfo);
 
-		std::array<vk::DescriptorSetLayout, 3> swDescriptorLayouts{
-			_staticDescriptorSetLayout.get(), _frameDescriptorSetLayout.get(), _swRayTraceDescriptorSetLayout.get()
+		std::array<vk::DescriptorSetLayout, 4> swDescriptorLayouts{
+			_staticDescriptorSetLayout.get(), _frameDescriptorSetLayout.get(), _swRayTraceDescriptorSetLayout.get(),
+			_sdfDescriptorSetLayout.get()
 		};
 
 		vk::PipelineLayoutCreateInfo swPipelineLayoutInfo;
@@ -427,33 +567,6 @@ protected:
 		_swPipelineLayout = dev.createPipelineLayoutUnique(swPipelineLayoutInfo);
 
 
-#ifndef RENDERDOC_CAPTURE
-		{ // create ray tracing pipeline
-			std::vector<vk::RayTracingShaderGroupCreateInfoKHR> shaderGroups;
-			shaderGroups.emplace_back(getRtGenShaderGroupCreate());
-			shaderGroups.emplace_back(getRtHitShaderGroupCreate());
-			shaderGroups.emplace_back(getRtMissShaderGroupCreate());
-			shaderGroups.emplace_back(getRtShadowMissShaderGroupCreate());
-
-			std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
-			shaderStages.emplace_back(_rayGen.getStageInfo());
-			shaderStages.emplace_back(_rayChit.getStageInfo());
-			shaderStages.emplace_back(_rayMiss.getStageInfo());
-			shaderStages.emplace_back(_rayShadowMiss.getStageInfo());
-
-			vk::RayTracingPipelineCreateInfoKHR rtPipelineInfo;
-			rtPipelineInfo
-				.setStages(shaderStages)
-				.setGroups(shaderGroups)
-				.setMaxPipelineRayRecursionDepth(1)
-				.setLayout(_hwPipelineLayout.get());
-			auto [res, pipeline] = dev.createRayTracingPipelineKHRUnique(nullptr, nullptr, rtPipelineInfo, nullptr, *dynamicLoader);
-			vkCheck(res);
-			_hwRayTracePipeline = std::move(pipeline);
-		}
-#endif
-
-
 		Pass::_initialize(dev);
 	}
 private:
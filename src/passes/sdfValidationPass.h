@@ -0,0 +1,96 @@
+#pragma once
+
+#include "pass.h"
+#include "../sdfSpecialization.h"
+
+/// Evaluates the SDF in a compute shader at points given in a storage buffer; see shaders/sdfValidation.comp.
+class SdfValidationPass : public Pass {
+	friend Pass;
+public:
+	[[nodiscard]] vk::DescriptorSetLayout getDescriptorSetLayout() const {
+		return _descriptorLayout.get();
+	}
+
+	void initializeDescriptorSet(
+		vk::Buffer points, vk::Buffer results, vk::Device device, vk::DescriptorSet set
+	) const {
+		std::array<vk::DescriptorBufferInfo, 2> bufferInfo{
+			vk::DescriptorBufferInfo(points, 0, VK_WHOLE_SIZE),
+			vk::DescriptorBufferInfo(results, 0, VK_WHOLE_SIZE)
+		};
+		std::array<vk::WriteDescriptorSet, 2> writes;
+		for (std::size_t i = 0; i < writes.size(); ++i) {
+			writes[i]
+				.setDstSet(set)
+				.setDstBinding(static_cast<uint32_t>(i))
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setPBufferInfo(&bufferInfo[i])
+				.setDescriptorCount(1);
+		}
+		device.updateDescriptorSets(writes, {});
+	}
+
+	void issueCommands(vk::CommandBuffer buffer, vk::Framebuffer) const override {
+		buffer.bindPipeline(vk::PipelineBindPoint::eCompute, getPipelines()[0].get());
+		buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _layout.get(), 0, descriptorSet, {});
+		buffer.pushConstants(_layout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t), &pointCount);
+		buffer.dispatch(ceilDiv<uint32_t>(pointCount, 64u), 1, 1);
+
+		vk::MemoryBarrier barrier;
+		barrier
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eHostRead);
+		buffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, barrier, {}, {}
+		);
+	}
+
+	vk::DescriptorSet descriptorSet;
+	uint32_t pointCount = 0;
+protected:
+	SdfValidationPass() = default;
+
+	Shader _shader;
+	vk::UniqueDescriptorSetLayout _descriptorLayout;
+	vk::UniquePipelineLayout _layout;
+
+	std::string_view _getName() const override {
+		return "SDF validation";
+	}
+	vk::UniqueRenderPass _createPass(vk::Device) override {
+		return {};
+	}
+
+	std::vector<PipelineCreationInfo> _getPipelineCreationInfo() override {
+		std::vector<PipelineCreationInfo> result;
+		vk::ComputePipelineCreateInfo pipelineInfo;
+		pipelineInfo
+			.setStage(_shader.getStageInfo(SdfSpecialization::getInfo()))
+			.setLayout(_layout.get());
+		result.emplace_back(pipelineInfo);
+		return result;
+	}
+
+	void _initialize(vk::Device dev) override {
+		_shader = Shader::load(dev, "shaders/sdfValidation.comp.spv", "main", vk::ShaderStageFlagBits::eCompute);
+
+		std::array<vk::DescriptorSetLayoutBinding, 2> bindings{
+			vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)
+		};
+		vk::DescriptorSetLayoutCreateInfo descriptorInfo;
+		descriptorInfo.setBindings(bindings);
+		_descriptorLayout = dev.createDescriptorSetLayoutUnique(descriptorInfo);
+
+		std::array<vk::PushConstantRange, 1> ranges{
+			vk::PushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t))
+		};
+		vk::PipelineLayoutCreateInfo layoutInfo;
+		layoutInfo
+			.setSetLayouts(_descriptorLayout.get())
+			.setPushConstantRanges(ranges);
+		_layout = dev.createPipelineLayoutUnique(layoutInfo);
+
+		Pass::_initialize(dev);
+	}
+};
@@ -97,6 +97,12 @@ protected:
 	vk::UniquePipelineLayout _layout;
 	vk::UniqueSampler _sampler;
 
+	bool _hasLazyPipelines() const override {
+		return true;
+	}
+	std::string_view _getName() const override {
+		return "spatial reuse";
+	}
 	vk::UniqueRenderPass _createPass(vk::Device) override {
 		return {};
 	}
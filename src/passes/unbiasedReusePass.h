@@ -3,6 +3,10 @@
 #include <vulkan/vulkan.hpp>
 
 #include "vma.h"
+#include "../pipelineCache.h"
+#include "../sceneResourceUsage.h"
+#include "../sdfBrickMap.h"
+#include "../sdfSpecialization.h"
 
 class UnbiasedReusePass {
 public:
@@ -20,6 +24,36 @@ public:
 		return _swRaytraceDescriptorLayout.get();
 	}
 
+	/// Like \ref RestirPass, visibility is tested by marching the SDF and the ray trace bindings are never read.
+	[[nodiscard]] inline static SceneResourceUsage getSceneResourceUsage() {
+		return SceneResourceUsage();
+	}
+
+	/// Creates the pipeline used by the given visibility test method if it hasn't been created yet. Pipelines are kept
+	/// once created, so switching back to a previously used method is free.
+	void prepareRenderPath(bool software, vk::Device dev, vma::Allocator &allocator, vk::PhysicalDevice physicalDev) {
+		if (software) {
+			if (!_softwarePipeline) {
+				_softwarePipeline = _createSoftwarePipeline(dev);
+			}
+		} else if (!_hwRaytracePipeline) {
+			_hwRaytracePipeline = _createHardwareRaytracePipeline(dev, *_dld);
+			createShaderBindingTable(dev, allocator, physicalDev, *_dld);
+		}
+	}
+	/// Recreates the pipelines that have already been created after the SDF specialization constants have changed.
+	void respecialize(vk::Device dev, vma::Allocator &allocator, vk::PhysicalDevice physicalDev) {
+		if (_softwarePipeline) {
+			_softwarePipeline.reset();
+			_softwarePipeline = _createSoftwarePipeline(dev);
+		}
+		if (_hwRaytracePipeline) {
+			_hwRaytracePipeline.reset();
+			_hwRaytracePipeline = _createHardwareRaytracePipeline(dev, *_dld);
+			createShaderBindingTable(dev, allocator, physicalDev, *_dld);
+		}
+	}
+
 	void issueCommands(vk::CommandBuffer commandBuffer, vk::DispatchLoaderDynamic dld) {
 		commandBuffer.pipelineBarrier(
 			vk::PipelineStageFlagBits::eRayTracingShaderKHR | vk::PipelineStageFlagBits::eComputeShader,
@@ -28,10 +62,11 @@ public:
 		);
 
 		if (useSoftwareRayTracing) {
+			assert(_softwarePipeline);
 			commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _softwarePipeline.get());
 			commandBuffer.bindDescriptorSets(
 				vk::PipelineBindPoint::eCompute, _swPipelineLayout.get(), 0,
-				{ frameDescriptorSet, raytraceDescriptorSet }, {}
+				{ frameDescriptorSet, raytraceDescriptorSet, sdfDescriptorSet }, {}
 			);
 			commandBuffer.dispatch(
 				ceilDiv<uint32_t>(bufferExtent.width, UNBIASED_REUSE_GROUP_SIZE_X),
@@ -39,10 +74,11 @@ public:
 				1
 			);
 		} else {
+			assert(_hwRaytracePipeline);
 			commandBuffer.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, _hwRaytracePipeline.get());
 			commandBuffer.bindDescriptorSets(
 				vk::PipelineBindPoint::eRayTracingKHR, _hwPipelineLayout.get(), 0,
-				{ frameDescriptorSet, raytraceDescriptorSet }, {}
+				{ frameDescriptorSet, raytraceDescriptorSet, sdfDescriptorSet }, {}
 			);
 			commandBuffer.traceRaysKHR(rayGenSBT, rayMissSBT, rayHitSBT, rayCallSBT, bufferExtent.width, bufferExtent.height, 1, dld);
 		}
@@ -281,6 +317,7 @@ public:
 	vk::StridedDeviceAddressRegionKHR rayCallSBT;
 	vk::DescriptorSet frameDescriptorSet;
 	vk::DescriptorSet raytraceDescriptorSet;
+	vk::DescriptorSet sdfDescriptorSet;
 	vk::Extent2D bufferExtent;
 	bool useSoftwareRayTracing = false;
 protected:
@@ -292,6 +329,7 @@ protected:
 	vk::UniqueDescriptorSetLayout _frameDescriptorSetLayout;
 	vk::UniqueDescriptorSetLayout _hwRaytraceDescriptorLayout;
 	vk::UniqueDescriptorSetLayout _swRaytraceDescriptorLayout;
+	vk::UniqueDescriptorSetLayout _sdfDescriptorLayout;
 
 	[[nodiscard]] vk::UniqueHandle<vk::Pipeline, vk::DispatchLoaderDynamic> _createHardwareRaytracePipeline(vk::Device dev, vk::DispatchLoaderDynamic& dld) {
 		// Set ray tracing pipeline
@@ -300,7 +338,7 @@ protected:
 		info.shaderGroups.emplace_back(PipelineCreationInfo::getRtHitShaderGroupCreate());
 		info.shaderGroups.emplace_back(PipelineCreationInfo::getRtMissShaderGroupCreate());
 		info.shaderGroups.emplace_back(PipelineCreationInfo::getRtShadowMissShaderGroupCreate());
-		info.shaderStages.emplace_back(_rayGen.getStageInfo());
+		info.shaderStages.emplace_back(_rayGen.getStageInfo(SdfSpecialization::getInfo()));
 		info.shaderStages.emplace_back(_rayChit.getStageInfo());
 		info.shaderStages.emplace_back(_rayMiss.getStageInfo());
 		info.shaderStages.emplace_back(_rayShadowMiss.getStageInfo());
@@ -312,9 +350,25 @@ protected:
 			.setMaxPipelineRayRecursionDepth(1)
 			.setLayout(_hwPipelineLayout.get());
 
-		auto [res, pipeline] = dev.createRayTracingPipelineKHRUnique(nullptr, nullptr, rtPipelineInfo, nullptr, dld).asTuple();
-		vkCheck(res);
-		return std::move(pipeline);
+		return PipelineCache::timed("unbiased reuse hardware", [&]() {
+			auto [res, pipeline] = dev.createRayTracingPipelineKHRUnique(
+				nullptr, PipelineCache::get(), rtPipelineInfo, nullptr, dld
+			).asTuple();
+			vkCheck(res);
+			return std::move(pipeline);
+		});
+	}
+
+	[[nodiscard]] vk::UniquePipeline _createSoftwarePipeline(vk::Device dev) {
+		vk::ComputePipelineCreateInfo swPipelineInfo;
+		swPipelineInfo
+			.setLayout(_swPipelineLayout.get())
+			.setStage(_software.getStageInfo(SdfSpecialization::getInfo()));
+		return PipelineCache::timed("unbiased reuse software", [&]() {
+			auto [res, pipeline] = dev.createComputePipelineUnique(PipelineCache::get(), swPipelineInfo);
+			vkCheck(res);
+			return std::move(pipeline);
+		});
 	}
 
 	void _initialize(vk::Device dev, vk::DispatchLoaderDynamic& dld) {
@@ -367,33 +421,29 @@ protected:
 		swRaytraceLayoutInfo.setBindings(swRaytraceBindings);
 		_swRaytraceDescriptorLayout = dev.createDescriptorSetLayoutUnique(swRaytraceLayoutInfo);
 
+		_sdfDescriptorLayout = SdfBrickMapBuffers::createDescriptorSetLayout(dev);
+
 
-		std::array<vk::DescriptorSetLayout, 2> hwDescriptorLayouts{ _frameDescriptorSetLayout.get(), _hwRaytraceDescriptorLayout.get() };
+		std::array<vk::DescriptorSetLayout, 3> hwDescriptorLayouts{
+			_frameDescriptorSetLayout.get(), _hwRaytraceDescriptorLayout.get(), _sdfDescriptorLayout.get()
+		};
 
 		vk::PipelineLayoutCreateInfo hwPipelineLayoutInfo;
 		hwPipelineLayoutInfo.setSetLayouts(hwDescriptorLayouts);
 		_hwPipelineLayout = dev.createPipelineLayoutUnique(hwPipelineLayoutInfo);
 
 
-		std::array<vk::DescriptorSetLayout, 2> swDescriptorLayouts{ _frameDescriptorSetLayout.get(), _swRaytraceDescriptorLayout.get() };
+		std::array<vk::DescriptorSetLayout, 3> swDescriptorLayouts{
+			_frameDescriptorSetLayout.get(), _swRaytraceDescriptorLayout.get(), _sdfDescriptorLayout.get()
+		};
 
 		vk::PipelineLayoutCreateInfo swPipelineLayoutInfo;
 		swPipelineLayoutInfo.setSetLayouts(swDescriptorLayouts);
 		_swPipelineLayout = dev.createPipelineLayoutUnique(swPipelineLayoutInfo);
 
 
-		//Pipeline
-#ifndef RENDERDOC_CAPTURE
-		_hwRaytracePipeline = _createHardwareRaytracePipeline(dev, dld);
-#endif
-
-		vk::ComputePipelineCreateInfo swPipelineInfo;
-		swPipelineInfo
-			.setLayout(_swPipelineLayout.get())
-			.setStage(_software.getStageInfo());
-		auto [res, pipeline] = dev.createComputePipelineUnique(nullptr, swPipelineInfo);
-		vkCheck(res);
-		_softwarePipeline = std::move(pipeline);
+		// pipelines are created by prepareRenderPath() once a visibility test method selects them
+		_dld = &dld;
 	}
 private:
 	vk::UniqueRenderPass _pass;
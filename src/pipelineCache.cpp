@@ -0,0 +1,115 @@
+#include "pipelineCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+
+#include "misc.h"
+
+/// Header written in front of the driver's cache blob. The driver validates its own header as well, but checking
+/// the driver version ourselves means a stale cache is dropped instead of being handed to a new driver.
+struct PipelineCacheFileHeader {
+	constexpr static uint32_t expectedMagic = 0x48435052; // "RPCH"
+	constexpr static uint32_t expectedVersion = 2;
+
+	uint32_t magic = expectedMagic;
+	uint32_t version = expectedVersion;
+	uint32_t vendorID = 0;
+	uint32_t deviceID = 0;
+	uint32_t driverVersion = 0;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE]{};
+	uint32_t padding = 0; ///< Explicit so that the whole key can be compared bytewise.
+	uint64_t dataSize = 0;
+};
+constexpr CacheFileFormat _pipelineCacheFormat{
+	.name = "Pipeline cache", .fallback = "starting cold", .mismatch = "was created by a different device or driver"
+};
+
+vk::Device _pipelineCacheDevice;
+vk::UniquePipelineCache _pipelineCache;
+std::filesystem::path _pipelineCachePath;
+PipelineCacheFileHeader _pipelineCacheDeviceHeader;
+bool _pipelineCacheWarm = false;
+
+std::mutex _pipelineCacheLogMutex;
+std::size_t _numPipelinesCreated = 0;
+PipelineCache::Clock::duration _totalPipelineCreationTime{ 0 };
+
+[[nodiscard]] PipelineCacheFileHeader _getHeaderForDevice(vk::PhysicalDevice physicalDevice) {
+	vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+	PipelineCacheFileHeader header;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	std::copy(
+		std::begin(properties.pipelineCacheUUID), std::end(properties.pipelineCacheUUID),
+		std::begin(header.pipelineCacheUUID)
+	);
+	return header;
+}
+
+void PipelineCache::initialize(vk::Device device, vk::PhysicalDevice physicalDevice, std::filesystem::path path) {
+	assert(!_pipelineCache);
+	_pipelineCacheDevice = device;
+	_pipelineCachePath = std::move(path);
+	_pipelineCacheDeviceHeader = _getHeaderForDevice(physicalDevice);
+
+	std::optional<CacheFile<PipelineCacheFileHeader>> file = loadCacheFile(
+		_pipelineCacheFormat, _pipelineCachePath, _pipelineCacheDeviceHeader,
+		offsetof(PipelineCacheFileHeader, dataSize),
+		[](const PipelineCacheFileHeader &header) {
+			return header.dataSize;
+		}
+	);
+	_pipelineCacheWarm = file && file->header.dataSize > 0;
+	if (_pipelineCacheWarm) {
+		std::cout <<
+			"Pipeline cache: loaded " << file->header.dataSize << " bytes from " << _pipelineCachePath << "\n";
+	}
+
+	vk::PipelineCacheCreateInfo cacheInfo;
+	if (_pipelineCacheWarm) {
+		cacheInfo
+			.setInitialDataSize(file->header.dataSize)
+			.setPInitialData(file->getPayload());
+	}
+	_pipelineCache = device.createPipelineCacheUnique(cacheInfo);
+}
+
+void PipelineCache::saveAndDestroy() {
+	if (!_pipelineCache) {
+		return;
+	}
+
+	std::vector<uint8_t> data = _pipelineCacheDevice.getPipelineCacheData(_pipelineCache.get());
+	PipelineCacheFileHeader header = _pipelineCacheDeviceHeader;
+	header.dataSize = data.size();
+
+	saveCacheFile(_pipelineCacheFormat, _pipelineCachePath, header, { std::as_bytes(std::span(data)) });
+
+	_pipelineCache.reset();
+	_pipelineCacheDevice = nullptr;
+}
+
+vk::PipelineCache PipelineCache::get() {
+	return _pipelineCache.get();
+}
+
+void PipelineCache::logPipelineCreation(std::string_view name, Clock::duration duration) {
+	std::lock_guard<std::mutex> lock(_pipelineCacheLogMutex);
+	++_numPipelinesCreated;
+	_totalPipelineCreationTime += duration;
+	std::cout <<
+		"Pipeline " << name << " created in " <<
+		std::chrono::duration<double, std::milli>(duration).count() << " ms\n";
+}
+
+void PipelineCache::printStatistics() {
+	std::lock_guard<std::mutex> lock(_pipelineCacheLogMutex);
+	std::cout <<
+		"Created " << _numPipelinesCreated << " pipelines in " <<
+		std::chrono::duration<double, std::milli>(_totalPipelineCreationTime).count() << " ms (" <<
+		(_pipelineCacheWarm ? "warm" : "cold") << " pipeline cache)\n";
+}
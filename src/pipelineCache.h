@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+#include <vulkan/vulkan.hpp>
+
+/// Process-wide pipeline cache shared by all passes. The cache is loaded from disk at startup and written back on
+/// exit; cache files produced by a different device or driver version are discarded.
+class PipelineCache {
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	static void initialize(vk::Device, vk::PhysicalDevice, std::filesystem::path);
+	/// Writes the cache back to disk and destroys it. Must be called before the device is destroyed.
+	static void saveAndDestroy();
+
+	/// Returns the shared cache, or a null handle if the cache has not been initialized.
+	[[nodiscard]] static vk::PipelineCache get();
+
+	static void logPipelineCreation(std::string_view name, Clock::duration);
+	/// Prints the number of pipelines created so far and the total time spent creating them.
+	static void printStatistics();
+
+	/// Invokes the given pipeline creation function and logs the time it took.
+	template <typename Fn> inline static auto timed(std::string_view name, Fn &&fn) {
+		Clock::time_point start = Clock::now();
+		auto result = fn();
+		logPipelineCreation(name, Clock::now() - start);
+		return result;
+	}
+};
@@ -0,0 +1,96 @@
+#include "proceduralLights.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "misc.h"
+#include "taskGraph.h"
+
+/// Number of lights that a single call of \ref parallelFor() generates.
+constexpr std::size_t _lightsPerTask = 1 << 12;
+
+/// Key of the streams of the cluster centers, so that they differ from the streams of the lights.
+constexpr uint64_t _clusterStreamKey = 0xC2B2AE3D27D4EB4Full;
+
+/// SplitMix64 finalizer, a bijection that mixes every input bit into every output bit.
+[[nodiscard]] constexpr uint64_t _mix(uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+/// Counter-based random number generator: the n-th number of the stream with a given key is the SplitMix64 output for
+/// the state key + n times the golden ratio, which only depends on the key and n.
+struct _CounterRng {
+	uint64_t key = 0;
+	uint64_t counter = 0;
+
+	/// Returns the stream with the given index among those of the given seed.
+	[[nodiscard]] static _CounterRng stream(uint64_t seed, uint64_t index) {
+		return _CounterRng{ .key = _mix(_mix(seed) + index) };
+	}
+
+	[[nodiscard]] uint64_t next() {
+		return _mix(key + ++counter * 0x9E3779B97F4A7C15ull);
+	}
+	/// Uniformly distributed in [0, 1).
+	[[nodiscard]] float nextFloat() {
+		return static_cast<float>(next() >> 40) * 0x1.0p-24f;
+	}
+	/// Standard normal distribution, using the Box-Muller transform.
+	[[nodiscard]] float nextNormal() {
+		float radius = std::sqrt(-2.0f * std::log(1.0f - nextFloat()));
+		return radius * std::cos(2.0f * std::numbers::pi_v<float> * nextFloat());
+	}
+	/// Uniformly distributed within the given box.
+	[[nodiscard]] nvmath::vec3f nextPoint(nvmath::vec3f min, nvmath::vec3f max) {
+		float x = nextFloat(), y = nextFloat(), z = nextFloat();
+		return min + nvmath::vec3f(x, y, z) * (max - min);
+	}
+};
+
+shader::pointLight ProceduralLights::generate(std::size_t index) const {
+	_CounterRng rand = _CounterRng::stream(seed, index);
+	nvmath::vec3f position;
+	switch (distribution) {
+	case Distribution::uniform:
+		position = rand.nextPoint(boundsMin, boundsMax);
+		break;
+	case Distribution::clustered:
+		{
+			uint64_t cluster = rand.next() % std::max(clusterCount, 1u);
+			_CounterRng clusterRand = _CounterRng::stream(seed ^ _clusterStreamKey, cluster);
+			nvmath::vec3f center = clusterRand.nextPoint(boundsMin, boundsMax);
+			float sigma = clusterRadius * nvmath::length(boundsMax - boundsMin);
+			float x = rand.nextNormal(), y = rand.nextNormal(), z = rand.nextNormal();
+			position = nvmath::nv_max(nvmath::nv_min(center + sigma * nvmath::vec3f(x, y, z), boundsMax), boundsMin);
+		}
+		break;
+	}
+
+	shader::pointLight result;
+	result.pos = nvmath::vec4f(position, 1.0f);
+	float r = rand.nextFloat(), g = rand.nextFloat(), b = rand.nextFloat();
+	result.color_luminance = nvmath::vec4f(r, g, b, shader::luminance(r, g, b));
+	return result;
+}
+
+void ProceduralLights::generate(std::size_t first, std::span<shader::pointLight> lights) const {
+	parallelFor(ceilDiv(lights.size(), _lightsPerTask), [&](std::size_t task) {
+		std::size_t end = std::min((task + 1) * _lightsPerTask, lights.size());
+		for (std::size_t i = task * _lightsPerTask; i < end; ++i) {
+			lights[i] = generate(first + i);
+		}
+	});
+}
+
+std::optional<ProceduralLights::Distribution> ProceduralLights::parseDistribution(std::string_view name) {
+	if (name == "uniform") {
+		return Distribution::uniform;
+	}
+	if (name == "clustered") {
+		return Distribution::clustered;
+	}
+	return std::nullopt;
+}
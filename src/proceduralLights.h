@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <nvmath.h>
+
+#include "shaderIncludes.h"
+
+/// Random point lights within a box, used to stress test light selection with millions of lights. Light \p i is a pure
+/// function of \ref seed and \p i computed with a counter-based generator, so lights can be generated in any order on
+/// any number of threads, the first lights stay the same when \ref count grows, and the lights never need to be stored
+/// on the host.
+struct ProceduralLights {
+	enum class Distribution {
+		uniform, ///< Uniformly distributed within the bounds.
+		clustered ///< Normally distributed around \ref clusterCount uniformly distributed centers.
+	};
+
+	std::size_t count = 0;
+	uint64_t seed = 0;
+	Distribution distribution = Distribution::uniform;
+	uint32_t clusterCount = 64;
+	float clusterRadius = 0.02f; ///< Standard deviation around the cluster centers, relative to the diagonal.
+	nvmath::vec3f boundsMin{ 0.0f, 0.0f, 0.0f };
+	nvmath::vec3f boundsMax{ 0.0f, 0.0f, 0.0f };
+
+	[[nodiscard]] shader::pointLight generate(std::size_t index) const;
+	/// Generates the lights starting at index \p first into \p lights on all hardware threads.
+	void generate(std::size_t first, std::span<shader::pointLight> lights) const;
+
+	/// Parses the name of a distribution as used on the command line, i.e., "uniform" or "clustered".
+	[[nodiscard]] static std::optional<Distribution> parseDistribution(std::string_view);
+};
@@ -15,18 +15,6 @@
 
 class SceneBuffers {
 public:
-	struct SceneTexture {
-		vk::UniqueImageView imageView;
-		vk::UniqueSampler sampler;
-		vma::UniqueImage image;
-
-		[[nodiscard]] vk::DescriptorImageInfo getDescriptorInfo(
-			vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal
-		) const {
-			return vk::DescriptorImageInfo(sampler.get(), imageView.get(), layout);
-		}
-	};
-
 	[[nodiscard]] vk::Buffer getVertices() const {
 		return _vertices.get();
 	}
@@ -48,15 +36,6 @@ public:
 	[[nodiscard]] vk::Buffer getAliasTable() const {
 		return _aliasTableBuffer.get();
 	}
-	[[nodiscard]] const std::vector<SceneTexture> &getTextures() const {
-		return _textureImages;
-	}
-	[[nodiscard]] const SceneTexture &getDefaultNormal() const {
-		return _defaultNormal;
-	}
-	[[nodiscard]] const SceneTexture &getDefaultWhite() const {
-		return _defaultWhite;
-	}
 	[[nodiscard]] const vk::DeviceSize getPtLightsBufferSize() const {
 		return _ptLightsBufferSize;
 	}
@@ -66,21 +45,24 @@ public:
 	[[nodiscard]] const vk::DeviceSize getAliasTableBufferSize() const {
 		return _aliasTableBufferSize;
 	}
+	[[nodiscard]] vk::DeviceSize getDeviceMemorySize() const {
+		return
+			_vertices.getAllocationSize() + _indices.getAllocationSize() + _matrices.getAllocationSize() +
+			_materials.getAllocationSize() + _ptLightsBuffer.getAllocationSize() +
+			_triLightsBuffer.getAllocationSize() + _aliasTableBuffer.getAllocationSize();
+	}
 	
 
+	/// The lights are those returned by \ref collectLightsFromScene().
 	[[nodiscard]] static SceneBuffers create(
 		const nvh::GltfScene &scene,
+		std::vector<shader::pointLight> pointLights,
+		std::vector<shader::triLight> triangleLights,
 		vma::Allocator &allocator,
 		TransientCommandBufferPool &oneTimeBufferPool,
 		vk::Device l_device,
 		vk::Queue graphicsQueue
 	) {
-		std::vector<shader::pointLight> pointLights = collectPointLightsFromScene(scene);
-		std::vector<shader::triLight> triangleLights = collectTriangleLightsFromScene(scene);
-		if (pointLights.empty() && triangleLights.empty()) {
-			pointLights = generateRandomPointLights(200, scene.m_dimensions.min, scene.m_dimensions.max);
-		}
-
 		std::vector<shader::aliasTableColumn> aliasTable = createAliasTable(pointLights, triangleLights);
 
 		SceneBuffers result;
@@ -124,53 +106,6 @@ public:
 		);
 
 
-		vk::Format format = vk::Format::eR8G8B8A8Unorm;
-
-		result._textureImages.resize(scene.m_textures.size());
-
-		// load textures
-		for (int i = 0; i < scene.m_textures.size(); ++i) {
-			auto& gltfimage = scene.m_textures[i];
-			std::cout << "Loading Texture: " << gltfimage.uri << std::endl;
-
-			// Create vma::Uniqueimage
-			uint32_t numMipLevels = 1 + static_cast<uint32_t>(std::ceil(std::log2(
-				std::max(gltfimage.width, gltfimage.height)
-			)));
-			result._textureImages[i].image = loadTexture(
-				gltfimage, format, numMipLevels, allocator, oneTimeBufferPool, graphicsQueue
-			);
-
-			result._textureImages[i].sampler = createSampler(
-				l_device, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear, 16.0f
-			);
-			result._textureImages[i].imageView = createImageView2D(
-				l_device, result._textureImages[i].image.get(),
-				format, vk::ImageAspectFlagBits::eColor, 0, numMipLevels
-			);
-		}
-
-		// generate default textures
-		{
-			unsigned char defaultNormal[4]{ 127, 127, 255, 255 };
-			result._defaultNormal.image = loadTexture(
-				defaultNormal, 1, 1, vk::Format::eR8G8B8A8Unorm, 1, allocator, oneTimeBufferPool, graphicsQueue
-			);
-			result._defaultNormal.sampler = createSampler(l_device);
-			result._defaultNormal.imageView = createImageView2D(
-				l_device, result._defaultNormal.image.get(), format, vk::ImageAspectFlagBits::eColor
-			);
-
-			unsigned char defaultWhite[4]{ 255, 255, 255, 255 };
-			result._defaultWhite.image = loadTexture(
-				defaultWhite, 1, 1, vk::Format::eR8G8B8A8Unorm, 1, allocator, oneTimeBufferPool, graphicsQueue
-			);
-			result._defaultWhite.sampler = createSampler(l_device);
-			result._defaultWhite.imageView = createImageView2D(
-				l_device, result._defaultWhite.image.get(), format, vk::ImageAspectFlagBits::eColor
-			);
-		}
-
 		// collect vertices
 		Vertex *vertices = result._vertices.mapAs<Vertex>();
 		for (std::size_t i = 0; i < scene.m_positions.size(); ++i) {
@@ -279,9 +214,6 @@ private:
 	vma::UniqueBuffer _ptLightsBuffer;
 	vma::UniqueBuffer _triLightsBuffer;
 	vma::UniqueBuffer _aliasTableBuffer;
-	std::vector<SceneTexture> _textureImages;
-	SceneTexture _defaultNormal;
-	SceneTexture _defaultWhite;
 	vk::DeviceSize _ptLightsBufferSize;
 	vk::DeviceSize _triLightsBufferSize;
 	vk::DeviceSize _aliasTableBufferSize;
@@ -296,6 +228,13 @@ public:
 	[[nodiscard]] vk::AccelerationStructureKHR getTopLevelAccelerationStructure() const {
 		return _topLevelAS.get();
 	}
+	[[nodiscard]] vk::DeviceSize getDeviceMemorySize() const {
+		vk::DeviceSize result = _instance.getAllocationSize();
+		for (const vma::UniqueBuffer &buffer : _asAllocations) {
+			result += buffer.getAllocationSize();
+		}
+		return result;
+	}
 
 	[[nodiscard]] inline static SceneRaytraceBuffers create(
 		vk::Device dev,
@@ -0,0 +1,38 @@
+#pragma once
+
+/// Scene resources read by the shaders of a pass. Resources that no active pass reads are not loaded at all.
+struct SceneResourceUsage {
+	bool meshGeometry = false; ///< Vertex, index, matrix and material buffers.
+	bool textures = false; ///< Encoded material images, which are never uploaded as a whole.
+	bool lights = false; ///< Point and triangle light buffers, and the light alias table.
+	bool aabbTree = false; ///< The AABB tree used for software ray tracing.
+	bool accelerationStructures = false; ///< Bottom and top level acceleration structures.
+	bool lightTree = false; ///< The \ref LightTree over the point and triangle lights, with its own light buffers.
+
+	[[nodiscard]] inline static SceneResourceUsage all() {
+		SceneResourceUsage result;
+		result.meshGeometry = result.textures = result.lights = result.aabbTree = result.accelerationStructures =
+			result.lightTree = true;
+		return result;
+	}
+
+	SceneResourceUsage &operator|=(const SceneResourceUsage &rhs) {
+		meshGeometry = meshGeometry || rhs.meshGeometry;
+		textures = textures || rhs.textures;
+		lights = lights || rhs.lights;
+		aabbTree = aabbTree || rhs.aabbTree;
+		accelerationStructures = accelerationStructures || rhs.accelerationStructures;
+		lightTree = lightTree || rhs.lightTree;
+		return *this;
+	}
+
+	/// Returns whether the scene file needs to be parsed at all.
+	[[nodiscard]] bool needsScene() const {
+		return meshGeometry || textures || lights || aabbTree || accelerationStructures || lightTree;
+	}
+	/// Returns whether \ref SceneBuffers need to be created. Acceleration structures are built from the vertex and
+	/// index buffers.
+	[[nodiscard]] bool needsSceneBuffers() const {
+		return meshGeometry || lights || accelerationStructures;
+	}
+};
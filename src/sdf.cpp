@@ -0,0 +1,348 @@
+#include "sdf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define SDF_X86
+#	include <immintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#endif
+
+// MSVC allows intrinsics of any instruction set without changing the target of the whole translation unit; GCC and
+// Clang need the target on the functions that use them
+#if defined(SDF_X86) && (defined(__GNUC__) || defined(__clang__))
+#	define SDF_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#	define SDF_TARGET_AVX2
+#endif
+
+#include "shaderIncludes.h"
+
+namespace sdf {
+	FoldRotation::FoldRotation(float angle) {
+		// same as rotate3D() in the shader
+		nvmath::vec3f axis(0.0f, 1.0f, 0.0f);
+		float s = std::sin(angle), c = std::cos(angle), oc = 1.0f - c;
+		columns[0] = nvmath::vec3f(
+			oc * axis.x * axis.x + c, oc * axis.x * axis.y - axis.z * s, oc * axis.z * axis.x + axis.y * s
+		);
+		columns[1] = nvmath::vec3f(
+			oc * axis.x * axis.y + axis.z * s, oc * axis.y * axis.y + c, oc * axis.y * axis.z - axis.x * s
+		);
+		columns[2] = nvmath::vec3f(
+			oc * axis.z * axis.x - axis.y * s, oc * axis.y * axis.z + axis.x * s, oc * axis.z * axis.z + c
+		);
+	}
+
+	bool isAvx2Supported() {
+		static const bool supported = []() {
+#if defined(SDF_X86) && defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) {
+				return false;
+			}
+			__cpuid(info, 1);
+			bool fma = (info[2] & (1 << 12)) != 0;
+			bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+			return fma && osSavesYmm && avx2;
+#elif defined(SDF_X86)
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+			return false;
+#endif
+		}();
+		return supported;
+	}
+
+	/// GLSL \p mod(), which unlike \p std::fmod() always has the sign of \p y.
+	[[nodiscard]] inline float _glslMod(float x, float y) {
+		return x - y * std::floor(x / y);
+	}
+
+	nvmath::vec2f getDistMat(nvmath::vec3f p, const FoldParameters &params) {
+		FoldRotation rotation(params.rotationAngle);
+		nvmath::vec3f q = p;
+		float d = q.y;
+		float mat = 0.0f;
+		float size = SDF_FOLD_INITIAL_SIZE;
+		for (int k = 0; k < params.steps; ++k) {
+			nvmath::vec3f rotated(
+				nvmath::dot(q, rotation.columns[0]),
+				nvmath::dot(q, rotation.columns[1]),
+				nvmath::dot(q, rotation.columns[2])
+			);
+			float period = size + size;
+			q.x = size * SDF_FOLD_THICKNESS - std::abs(_glslMod(rotated.x, period) - size);
+			q.y = size * SDF_FOLD_THICKNESS - std::abs(_glslMod(rotated.y, period) - size);
+			q.z = size * SDF_FOLD_THICKNESS - std::abs(_glslMod(rotated.z, period) - size);
+
+			float prevD = d;
+			d = std::max(d, std::min(std::min(q.x, q.y), q.z));
+			if (d != prevD) {
+				mat = static_cast<float>(k) / static_cast<float>(std::max(params.steps - 1, 1));
+			}
+
+			size *= SDF_FOLD_SIZE_FALLOFF;
+			if (size < params.floor) {
+				break;
+			}
+		}
+		return nvmath::vec2f(d, mat);
+	}
+
+	void _getDistScalar(
+		const float *x, const float *y, const float *z, float *dist, std::size_t count, const FoldParameters &params
+	) {
+		constexpr std::size_t batchSize = 64;
+		FoldRotation rotation(params.rotationAngle);
+		const nvmath::vec3f &c0 = rotation.columns[0];
+		const nvmath::vec3f &c1 = rotation.columns[1];
+		const nvmath::vec3f &c2 = rotation.columns[2];
+
+		float qx[batchSize], qy[batchSize], qz[batchSize], d[batchSize];
+		for (std::size_t begin = 0; begin < count; begin += batchSize) {
+			std::size_t n = std::min(batchSize, count - begin);
+			for (std::size_t i = 0; i < n; ++i) {
+				qx[i] = x[begin + i];
+				qy[i] = y[begin + i];
+				qz[i] = z[begin + i];
+				d[i] = qy[i];
+			}
+
+			// the fold size doesn't depend on the point, so all points run the same number of iterations
+			float size = SDF_FOLD_INITIAL_SIZE;
+			for (int k = 0; k < params.steps; ++k) {
+				float period = size + size;
+				float thickness = size * SDF_FOLD_THICKNESS;
+				for (std::size_t i = 0; i < n; ++i) {
+					float rx = qx[i] * c0.x + qy[i] * c0.y + qz[i] * c0.z;
+					float ry = qx[i] * c1.x + qy[i] * c1.y + qz[i] * c1.z;
+					float rz = qx[i] * c2.x + qy[i] * c2.y + qz[i] * c2.z;
+					qx[i] = thickness - std::abs(rx - period * std::floor(rx / period) - size);
+					qy[i] = thickness - std::abs(ry - period * std::floor(ry / period) - size);
+					qz[i] = thickness - std::abs(rz - period * std::floor(rz / period) - size);
+					d[i] = std::max(d[i], std::min(std::min(qx[i], qy[i]), qz[i]));
+				}
+				size *= SDF_FOLD_SIZE_FALLOFF;
+				if (size < params.floor) {
+					break;
+				}
+			}
+
+			std::copy(d, d + n, dist + begin);
+		}
+	}
+
+#ifdef SDF_X86
+	/// Same as \ref _getDistScalar(), but with eight points in the lanes of one AVX register.
+	SDF_TARGET_AVX2 void _getDistAvx2(
+		const float *x, const float *y, const float *z, float *dist, std::size_t count, const FoldParameters &params
+	) {
+		constexpr std::size_t width = 8;
+		FoldRotation rotation(params.rotationAngle);
+		__m256 rotationColumns[3][3];
+		for (std::size_t i = 0; i < 3; ++i) {
+			rotationColumns[i][0] = _mm256_set1_ps(rotation.columns[i].x);
+			rotationColumns[i][1] = _mm256_set1_ps(rotation.columns[i].y);
+			rotationColumns[i][2] = _mm256_set1_ps(rotation.columns[i].z);
+		}
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+		for (std::size_t begin = 0; begin < count; begin += width) {
+			std::size_t n = std::min(width, count - begin);
+			__m256 qx, qy, qz;
+			if (n == width) {
+				qx = _mm256_loadu_ps(x + begin);
+				qy = _mm256_loadu_ps(y + begin);
+				qz = _mm256_loadu_ps(z + begin);
+			} else { // the remaining lanes evaluate the origin and are discarded
+				float tail[3][width]{};
+				std::copy(x + begin, x + begin + n, tail[0]);
+				std::copy(y + begin, y + begin + n, tail[1]);
+				std::copy(z + begin, z + begin + n, tail[2]);
+				qx = _mm256_loadu_ps(tail[0]);
+				qy = _mm256_loadu_ps(tail[1]);
+				qz = _mm256_loadu_ps(tail[2]);
+			}
+			__m256 d = qy;
+
+			float size = SDF_FOLD_INITIAL_SIZE;
+			for (int k = 0; k < params.steps; ++k) {
+				__m256 sizeVec = _mm256_set1_ps(size);
+				__m256 period = _mm256_set1_ps(size + size);
+				__m256 thickness = _mm256_set1_ps(size * SDF_FOLD_THICKNESS);
+
+				__m256 rotated[3];
+				for (std::size_t i = 0; i < 3; ++i) {
+					rotated[i] = _mm256_fmadd_ps(
+						qx, rotationColumns[i][0],
+						_mm256_fmadd_ps(qy, rotationColumns[i][1], _mm256_mul_ps(qz, rotationColumns[i][2]))
+					);
+					// thickness - abs(mod(r, period) - size)
+					__m256 cell = _mm256_sub_ps(
+						_mm256_fnmadd_ps(period, _mm256_floor_ps(_mm256_div_ps(rotated[i], period)), rotated[i]),
+						sizeVec
+					);
+					rotated[i] = _mm256_sub_ps(thickness, _mm256_andnot_ps(signMask, cell));
+				}
+				qx = rotated[0];
+				qy = rotated[1];
+				qz = rotated[2];
+				d = _mm256_max_ps(d, _mm256_min_ps(_mm256_min_ps(qx, qy), qz));
+
+				size *= SDF_FOLD_SIZE_FALLOFF;
+				if (size < params.floor) {
+					break;
+				}
+			}
+
+			if (n == width) {
+				_mm256_storeu_ps(dist + begin, d);
+			} else {
+				float tail[width];
+				_mm256_storeu_ps(tail, d);
+				std::copy(tail, tail + n, dist + begin);
+			}
+		}
+	}
+#endif
+
+	void getDist(
+		const float *x, const float *y, const float *z, float *dist, std::size_t count,
+		const FoldParameters &params, Kernel kernel
+	) {
+#ifdef SDF_X86
+		if (kernel != Kernel::scalar && isAvx2Supported()) {
+			_getDistAvx2(x, y, z, dist, count, params);
+			return;
+		}
+#endif
+		_getDistScalar(x, y, z, dist, count, params);
+	}
+
+	Material getMaterial(float matId, const FoldParameters &params, uint64_t emissiveIterations) {
+		constexpr float tau = 6.28318530718f;
+		float iterF = matId * static_cast<float>(params.steps - 1);
+		int iter = static_cast<int>(std::floor(iterF + 0.5f));
+		float cycle = matId;
+
+		Material result;
+		// palette() with a = b = 0.5, c = 1 and d = (0, 0.33, 0.67)
+		result.albedo = nvmath::vec3f(
+			0.5f + 0.5f * std::cos(tau * cycle),
+			0.5f + 0.5f * std::cos(tau * (cycle + 0.33f)),
+			0.5f + 0.5f * std::cos(tau * (cycle + 0.67f))
+		);
+		result.roughness = std::clamp(0.15f + 0.8f * std::abs(std::sin(tau * cycle)), 0.05f, 0.98f);
+		float metallic = std::clamp((cycle - 0.55f) / (0.95f - 0.55f), 0.0f, 1.0f);
+		result.metallic = metallic * metallic * (3.0f - 2.0f * metallic); // smoothstep()
+
+		bool emissive = iter >= 0 && iter < 64 && ((emissiveIterations >> iter) & 1) != 0;
+		result.emission = emissive ? result.albedo * SDF_EMISSION_STRENGTH : nvmath::vec3f(0.0f, 0.0f, 0.0f);
+		return result;
+	}
+
+	/// State of a ray between two steps of \ref sphereTrace().
+	struct _MarchState {
+		float t = 0.0f;
+		float prevRadius = 0.0f;
+		float stepLength = 0.0f;
+		float omega = 1.0f;
+		uint32_t steps = 0;
+
+		/// Takes one step given the distance at the current position, like the loop body in sphereTrace.glsl. Returns
+		/// whether the surface has been hit.
+		bool step(float dist, float epsilon) {
+			++steps;
+			float radius = std::abs(dist);
+			bool relaxationFailed = omega > 1.0f && radius + prevRadius < stepLength;
+			if (relaxationFailed) {
+				stepLength -= omega * stepLength;
+				omega = 1.0f;
+			} else {
+				if (dist < epsilon) {
+					return true;
+				}
+				stepLength = dist * omega;
+			}
+			prevRadius = radius;
+			t += stepLength;
+			return false;
+		}
+	};
+
+	SphereTraceResult sphereTrace(
+		nvmath::vec3f origin, nvmath::vec3f dir, float tMin, float tMax,
+		const SphereTraceSettings &settings, const FoldParameters &params
+	) {
+		SphereTraceResult result;
+		_MarchState state;
+		state.t = tMin;
+		state.omega = std::max(settings.relaxation, 1.0f);
+		while (state.steps < settings.maxSteps) {
+			nvmath::vec2f distMat = getDistMat(origin + dir * state.t, params);
+			if (state.step(distMat.x, settings.epsilon)) {
+				result.hit = true;
+				result.matId = distMat.y;
+				break;
+			}
+			if (state.t > tMax) {
+				break;
+			}
+		}
+		result.t = state.t;
+		result.steps = state.steps;
+		return result;
+	}
+
+	void sphereTrace(
+		const nvmath::vec3f *origins, const nvmath::vec3f *dirs, std::size_t count, float tMin, float tMax,
+		SphereTraceResult *results, const SphereTraceSettings &settings, const FoldParameters &params, Kernel kernel
+	) {
+		std::vector<_MarchState> states(count);
+		std::vector<std::size_t> active(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			states[i].t = tMin;
+			states[i].omega = std::max(settings.relaxation, 1.0f);
+			active[i] = i;
+			results[i] = SphereTraceResult();
+		}
+
+		std::vector<float> x(count), y(count), z(count), dist(count);
+		while (!active.empty()) {
+			for (std::size_t i = 0; i < active.size(); ++i) {
+				nvmath::vec3f p = origins[active[i]] + dirs[active[i]] * states[active[i]].t;
+				x[i] = p.x;
+				y[i] = p.y;
+				z[i] = p.z;
+			}
+			getDist(x.data(), y.data(), z.data(), dist.data(), active.size(), params, kernel);
+
+			std::size_t remaining = 0;
+			for (std::size_t i = 0; i < active.size(); ++i) {
+				std::size_t ray = active[i];
+				_MarchState &state = states[ray];
+				bool hit = state.step(dist[i], settings.epsilon);
+				if (hit || state.t > tMax || state.steps >= settings.maxSteps) {
+					results[ray].hit = hit;
+					results[ray].t = state.t;
+					results[ray].steps = state.steps;
+					if (hit) { // the batched evaluation only computes distances
+						results[ray].matId = getDistMat(origins[ray] + dirs[ray] * state.t, params).y;
+					}
+				} else {
+					active[remaining++] = ray;
+				}
+			}
+			active.resize(remaining);
+		}
+	}
+}
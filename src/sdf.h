@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <nvmath.h>
+
+/// CPU port of the procedural fold SDF in shaders/include/SDF.glsl and of its materials in SDF-Material.glsl. Results
+/// match the shaders up to floating point differences; the constants of the fold are shared with the shaders through
+/// shaders/include/structs/sdfStructs.glsl. When the field changes, \ref SdfBrickMap::fieldVersion must be updated.
+namespace sdf {
+	/// Iteration parameters of the fold, corresponding to the specialization constants in
+	/// shaders/include/sdfSpecialization.glsl.
+	struct FoldParameters {
+		int steps = 24;
+		float floor = 1.0f;
+		float rotationAngle = 0.5f; ///< Angle of the rotation around the Y axis applied before every fold.
+
+		[[nodiscard]] friend bool operator==(const FoldParameters&, const FoldParameters&) = default;
+	};
+
+	/// The rotation applied before every fold. \p q * M in GLSL dots \p q with each column.
+	struct FoldRotation {
+		nvmath::vec3f columns[3];
+
+		explicit FoldRotation(float angle);
+	};
+
+	/// Implementation of the batched functions below.
+	enum class Kernel {
+		automatic, ///< AVX2 if the CPU supports it, scalar otherwise.
+		scalar,
+		avx2 ///< Evaluates eight points at once. Falls back to \ref scalar if the CPU does not support AVX2 and FMA.
+	};
+	/// Returns whether \ref Kernel::avx2 is supported by this CPU.
+	[[nodiscard]] bool isAvx2Supported();
+
+	/// Returns the distance and the material parameter at the given point, like \p GetDistMat().
+	[[nodiscard]] nvmath::vec2f getDistMat(nvmath::vec3f p, const FoldParameters& = FoldParameters());
+
+	/// Evaluates the distance at \p count points given in structure-of-arrays layout. Points are processed in fixed-size
+	/// batches with the fold iterations in the outer loop, so the inner loop is free of dependencies between points.
+	void getDist(
+		const float *x, const float *y, const float *z, float *dist, std::size_t count,
+		const FoldParameters& = FoldParameters(), Kernel = Kernel::automatic
+	);
+
+	/// Outputs of \p GetMaterial().
+	struct Material {
+		nvmath::vec3f albedo;
+		float roughness = 0.0f;
+		float metallic = 0.0f;
+		nvmath::vec3f emission;
+	};
+	/// Returns the material for the given material parameter, like \p GetMaterial(). Bit \p k of
+	/// \p emissiveIterations is set if fold iteration \p k is emissive.
+	[[nodiscard]] Material getMaterial(float matId, const FoldParameters&, uint64_t emissiveIterations);
+
+	/// Parameters of \ref sphereTrace(), corresponding to \p sdfParams in the shaders.
+	struct SphereTraceSettings {
+		float epsilon = 0.001f;
+		uint32_t maxSteps = 128;
+		float relaxation = 1.2f; ///< Over-relaxation factor; 1 disables over-relaxation.
+	};
+	struct SphereTraceResult {
+		bool hit = false;
+		float t = 0.0f;
+		float matId = 0.0f;
+		uint32_t steps = 0;
+	};
+	/// Traces a ray like \p sphereTrace() in shaders/include/sphereTrace.glsl. \p dir must be normalized.
+	[[nodiscard]] SphereTraceResult sphereTrace(
+		nvmath::vec3f origin, nvmath::vec3f dir, float tMin, float tMax,
+		const SphereTraceSettings& = SphereTraceSettings(), const FoldParameters& = FoldParameters()
+	);
+	/// Traces \p count rays. All rays that are still marching advance together, so that every step evaluates the
+	/// distances of all of them with a single call to \ref getDist().
+	void sphereTrace(
+		const nvmath::vec3f *origins, const nvmath::vec3f *dirs, std::size_t count, float tMin, float tMax,
+		SphereTraceResult *results, const SphereTraceSettings& = SphereTraceSettings(),
+		const FoldParameters& = FoldParameters(), Kernel = Kernel::automatic
+	);
+}
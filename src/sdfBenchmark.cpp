@@ -0,0 +1,61 @@
+#include "sdfBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+void runSdfBenchmark(const sdf::FoldParameters &params, std::size_t pointCount, std::size_t rayCount) {
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> coordinate(-256.0f, 256.0f);
+
+	std::vector<float> x(pointCount), y(pointCount), z(pointCount), dist(pointCount);
+	for (std::size_t i = 0; i < pointCount; ++i) {
+		x[i] = coordinate(random);
+		y[i] = coordinate(random);
+		z[i] = coordinate(random);
+	}
+
+	// rays from above the ground plane towards it, like the default camera
+	std::vector<nvmath::vec3f> origins(rayCount), dirs(rayCount);
+	std::vector<sdf::SphereTraceResult> results(rayCount);
+	for (std::size_t i = 0; i < rayCount; ++i) {
+		origins[i] = nvmath::vec3f(coordinate(random), 100.0f, coordinate(random));
+		dirs[i] = nvmath::normalize(nvmath::vec3f(coordinate(random), -std::abs(coordinate(random)), coordinate(random)));
+	}
+
+	std::cout << "SDF benchmark (" << params.steps << " fold steps, floor " << params.floor << "):\n";
+	auto measure = [&](std::string_view name, sdf::Kernel kernel) {
+		auto begin = std::chrono::high_resolution_clock::now();
+		sdf::getDist(x.data(), y.data(), z.data(), dist.data(), pointCount, params, kernel);
+		auto mid = std::chrono::high_resolution_clock::now();
+		sdf::sphereTrace(
+			origins.data(), dirs.data(), rayCount, 0.0f, 2000.0f, results.data(), sdf::SphereTraceSettings(), params,
+			kernel
+		);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		std::size_t steps = 0, hits = 0;
+		for (const sdf::SphereTraceResult &result : results) {
+			steps += result.steps;
+			hits += result.hit ? 1 : 0;
+		}
+		double evaluationSeconds = std::chrono::duration<double>(mid - begin).count();
+		double traceSeconds = std::chrono::duration<double>(end - mid).count();
+		std::cout <<
+			"    " << name << ": " <<
+			static_cast<double>(pointCount) / evaluationSeconds << " evaluations/s, " <<
+			static_cast<double>(rayCount) / traceSeconds << " rays/s (" <<
+			static_cast<double>(steps) / static_cast<double>(std::max<std::size_t>(rayCount, 1)) << " steps per ray, " <<
+			hits << " hits)\n";
+	};
+	measure("scalar", sdf::Kernel::scalar);
+	if (sdf::isAvx2Supported()) {
+		measure("AVX2", sdf::Kernel::avx2);
+	} else {
+		std::cout << "    AVX2: not supported by this CPU\n";
+	}
+}
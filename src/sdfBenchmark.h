@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+#include "sdf.h"
+
+/// Measures the throughput of the CPU port of the SDF with every kernel that this CPU supports, and prints distance
+/// evaluations and traced rays per second.
+void runSdfBenchmark(const sdf::FoldParameters&, std::size_t pointCount, std::size_t rayCount);
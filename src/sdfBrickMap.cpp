@@ -0,0 +1,443 @@
+#include "sdfBrickMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include "misc.h"
+#include "taskGraph.h"
+
+/// Header of the brick map cache file. The settings fields come first so that a cached bake can be matched against
+/// the current settings with a single comparison.
+struct SdfBrickMapFileHeader {
+	constexpr static uint32_t expectedMagic = 0x504D4B42; // "BKMP"
+	constexpr static uint32_t expectedVersion = 3;
+
+	uint32_t magic = expectedMagic;
+	uint32_t version = expectedVersion;
+	uint32_t fieldVersion = SdfBrickMap::fieldVersion;
+	float boundsMin[3]{};
+	float boundsMax[3]{};
+	float cellSize = 0.0f;
+	float narrowBand = 0.0f;
+	uint32_t brickResolution = 0;
+	int32_t foldSteps = 0;
+	float foldFloor = 0.0f;
+	float foldRotationAngle = 0.0f;
+
+	uint32_t gridSize[3]{};
+	uint32_t numBricks = 0;
+};
+constexpr CacheFileFormat _brickMapCacheFormat{
+	.name = "SDF brick map", .fallback = "baking", .mismatch = "was baked with different settings"
+};
+
+[[nodiscard]] SdfBrickMapFileHeader _getHeaderForSettings(const SdfBrickMap::Settings &settings) {
+	SdfBrickMapFileHeader header;
+	for (int i = 0; i < 3; ++i) {
+		header.boundsMin[i] = settings.boundsMin[i];
+		header.boundsMax[i] = settings.boundsMax[i];
+	}
+	header.cellSize = settings.cellSize;
+	header.narrowBand = settings.narrowBand;
+	header.brickResolution = settings.brickResolution;
+	header.foldSteps = settings.fold.steps;
+	header.foldFloor = settings.fold.floor;
+	header.foldRotationAngle = settings.fold.rotationAngle;
+	return header;
+}
+
+/// Converts to half precision by truncating the mantissa, which rounds positive distances down. Values too small to be
+/// represented as normalized halves are flushed to zero, and values too large are clamped to the largest half.
+[[nodiscard]] uint16_t _floatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(float));
+	auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFFu) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFFu;
+	if (exponent <= 0) {
+		return sign;
+	}
+	if (exponent >= 31) {
+		return static_cast<uint16_t>(sign | 0x7BFFu);
+	}
+	return static_cast<uint16_t>(sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13));
+}
+
+
+SdfBrickMap SdfBrickMap::bake(const Settings &settings) {
+	auto bakeBegin = std::chrono::high_resolution_clock::now();
+
+	SdfBrickMap result;
+	result.settings = settings;
+	nvmath::vec3f extent = settings.boundsMax - settings.boundsMin;
+	for (int i = 0; i < 3; ++i) {
+		result.gridSize[i] = std::max(1u, static_cast<uint32_t>(std::ceil(extent[i] / settings.cellSize)));
+	}
+	std::size_t numCells =
+		static_cast<std::size_t>(result.gridSize[0]) * result.gridSize[1] * result.gridSize[2];
+	result.cells.resize(numCells);
+
+	// distance at all cell centers, one row of cells at a time
+	parallelFor(static_cast<std::size_t>(result.gridSize[1]) * result.gridSize[2], [&](std::size_t row) {
+		std::size_t rowLength = result.gridSize[0];
+		float y = settings.boundsMin.y + (static_cast<float>(row % result.gridSize[1]) + 0.5f) * settings.cellSize;
+		float z = settings.boundsMin.z + (static_cast<float>(row / result.gridSize[1]) + 0.5f) * settings.cellSize;
+		std::vector<float> xs(rowLength), ys(rowLength, y), zs(rowLength, z), dist(rowLength);
+		for (std::size_t x = 0; x < rowLength; ++x) {
+			xs[x] = settings.boundsMin.x + (static_cast<float>(x) + 0.5f) * settings.cellSize;
+		}
+		sdf::getDist(xs.data(), ys.data(), zs.data(), dist.data(), rowLength, settings.fold);
+		for (std::size_t x = 0; x < rowLength; ++x) {
+			Cell &cell = result.cells[row * rowLength + x];
+			cell.centerDistance = dist[x];
+			cell.brickIndex = -1.0f;
+			cell.errorBound = 0.0f;
+			cell.padding = 0.0f;
+		}
+	});
+
+	// the field is 1-Lipschitz, so no point of a cell is closer to the surface than its center distance minus half
+	// the cell diagonal
+	float halfDiagonal = 0.5f * std::sqrt(3.0f) * settings.cellSize;
+	std::vector<std::size_t> brickCells;
+	for (std::size_t i = 0; i < numCells; ++i) {
+		if (std::abs(result.cells[i].centerDistance) <= halfDiagonal + settings.narrowBand) {
+			result.cells[i].brickIndex = static_cast<float>(brickCells.size());
+			brickCells.emplace_back(i);
+		}
+	}
+	result.numBricks = static_cast<uint32_t>(brickCells.size());
+
+	uint32_t edge = settings.brickResolution + 1;
+	uint32_t samplesPerBrick = settings.getSamplesPerBrick();
+	float voxelSize = settings.getVoxelSize();
+	result.brickSamples.resize(static_cast<std::size_t>(samplesPerBrick) * result.numBricks);
+	parallelFor(brickCells.size(), [&](std::size_t brick) {
+		std::size_t cellIndex = brickCells[brick];
+		nvmath::vec3f origin = settings.boundsMin + settings.cellSize * nvmath::vec3f(
+			static_cast<float>(cellIndex % result.gridSize[0]),
+			static_cast<float>((cellIndex / result.gridSize[0]) % result.gridSize[1]),
+			static_cast<float>(cellIndex / (static_cast<std::size_t>(result.gridSize[0]) * result.gridSize[1]))
+		);
+
+		std::vector<float> xs(samplesPerBrick), ys(samplesPerBrick), zs(samplesPerBrick), corners(samplesPerBrick);
+		for (uint32_t z = 0, i = 0; z < edge; ++z) {
+			for (uint32_t y = 0; y < edge; ++y) {
+				for (uint32_t x = 0; x < edge; ++x, ++i) {
+					xs[i] = origin.x + static_cast<float>(x) * voxelSize;
+					ys[i] = origin.y + static_cast<float>(y) * voxelSize;
+					zs[i] = origin.z + static_cast<float>(z) * voxelSize;
+				}
+			}
+		}
+		sdf::getDist(xs.data(), ys.data(), zs.data(), corners.data(), samplesPerBrick, settings.fold);
+		uint16_t *samples = result.brickSamples.data() + brick * samplesPerBrick;
+		for (uint32_t i = 0; i < samplesPerBrick; ++i) {
+			samples[i] = _floatToHalf(corners[i]);
+		}
+
+		// trilinear interpolation is a weighted average of the corners and the field is 1-Lipschitz, so the
+		// interpolated value exceeds the distance at a point by at most the weighted distance to the corners; by
+		// Jensen's inequality that is at most the square root of the sum of t * (1 - t) over the axes, i.e., half the
+		// voxel diagonal. Texture units quantize the weights to 8 bits, which moves the interpolated point by up to
+		// 1/512 of a voxel per axis, and truncation to half precision raises negative samples by less than 2^-10 of
+		// their magnitude and flushes them to zero below 2^-14.
+		float largestNegative = 0.0f;
+		for (uint32_t i = 0; i < samplesPerBrick; ++i) {
+			largestNegative = std::max(largestNegative, -corners[i]);
+		}
+		float errorBound =
+			0.5f * std::sqrt(3.0f) * voxelSize * (1.0f + 1.0f / 256.0f) + largestNegative * 0x1.0p-10f + 0x1.0p-14f;
+		result.cells[cellIndex].errorBound = errorBound;
+	});
+
+	std::cout <<
+		"SDF brick map: baked " << result.gridSize[0] << "x" << result.gridSize[1] << "x" << result.gridSize[2] <<
+		" cells, " << result.numBricks << " bricks in " <<
+		std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - bakeBegin).count() <<
+		" ms\n";
+	return result;
+}
+
+SdfBrickMap SdfBrickMap::loadOrBake(const Settings &settings, const std::filesystem::path &cachePath) {
+	if (std::optional<SdfBrickMap> cached = load(settings, cachePath)) {
+		return std::move(cached.value());
+	}
+	SdfBrickMap result = bake(settings);
+	result.save(cachePath);
+	return result;
+}
+
+std::optional<SdfBrickMap> SdfBrickMap::load(const Settings &settings, const std::filesystem::path &path) {
+	std::size_t samplesPerBrick = settings.getSamplesPerBrick();
+	std::optional<CacheFile<SdfBrickMapFileHeader>> file = loadCacheFile(
+		_brickMapCacheFormat, path, _getHeaderForSettings(settings), offsetof(SdfBrickMapFileHeader, gridSize),
+		[&](const SdfBrickMapFileHeader &header) {
+			std::size_t numCells =
+				static_cast<std::size_t>(header.gridSize[0]) * header.gridSize[1] * header.gridSize[2];
+			return numCells * sizeof(Cell) + samplesPerBrick * header.numBricks * sizeof(uint16_t);
+		}
+	);
+	if (!file) {
+		return std::nullopt;
+	}
+
+	SdfBrickMap result;
+	result.settings = settings;
+	std::copy(std::begin(file->header.gridSize), std::end(file->header.gridSize), result.gridSize.begin());
+	result.numBricks = file->header.numBricks;
+	std::size_t numCells =
+		static_cast<std::size_t>(result.gridSize[0]) * result.gridSize[1] * result.gridSize[2];
+	std::size_t numSamples = samplesPerBrick * result.numBricks;
+
+	const char *data = file->getPayload();
+	result.cells.resize(numCells);
+	std::memcpy(result.cells.data(), data, numCells * sizeof(Cell));
+	result.brickSamples.resize(numSamples);
+	std::memcpy(result.brickSamples.data(), data + numCells * sizeof(Cell), numSamples * sizeof(uint16_t));
+
+	std::cout << "SDF brick map: loaded " << result.numBricks << " bricks from " << path << "\n";
+	return result;
+}
+
+void SdfBrickMap::save(const std::filesystem::path &path) const {
+	SdfBrickMapFileHeader header = _getHeaderForSettings(settings);
+	std::copy(gridSize.begin(), gridSize.end(), std::begin(header.gridSize));
+	header.numBricks = numBricks;
+	saveCacheFile(
+		_brickMapCacheFormat, path, header, { std::as_bytes(std::span(cells)), std::as_bytes(std::span(brickSamples)) }
+	);
+}
+
+
+vk::UniqueDescriptorSetLayout SdfBrickMapBuffers::createDescriptorSetLayout(vk::Device device) {
+	constexpr vk::ShaderStageFlags stageFlags =
+		vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eRaygenKHR;
+	std::array<vk::DescriptorSetLayoutBinding, 4> bindings{
+		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, stageFlags),
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, 1, stageFlags),
+		vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eUniformBuffer, 1, stageFlags),
+		vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, stageFlags)
+	};
+	vk::DescriptorSetLayoutCreateInfo layoutInfo;
+	layoutInfo.setBindings(bindings);
+	return device.createDescriptorSetLayoutUnique(layoutInfo);
+}
+
+/// Creates a sampled 3D image that can be copied to, along with a view of it.
+[[nodiscard]] vma::UniqueImage _createImage3D(
+	vma::Allocator &allocator, vk::Device device, vk::Extent3D extent, vk::Format format, vk::UniqueImageView &view
+) {
+	vk::ImageCreateInfo imageInfo;
+	imageInfo
+		.setImageType(vk::ImageType::e3D)
+		.setExtent(extent)
+		.setFormat(format)
+		.setMipLevels(1)
+		.setArrayLayers(1)
+		.setSamples(vk::SampleCountFlagBits::e1)
+		.setTiling(vk::ImageTiling::eOptimal)
+		.setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)
+		.setSharingMode(vk::SharingMode::eExclusive)
+		.setInitialLayout(vk::ImageLayout::eUndefined);
+	VmaAllocationCreateInfo allocationInfo{};
+	allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	vma::UniqueImage image = allocator.createImage(imageInfo, allocationInfo);
+
+	vk::ImageViewCreateInfo viewInfo;
+	viewInfo
+		.setImage(image.get())
+		.setViewType(vk::ImageViewType::e3D)
+		.setFormat(format)
+		.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+	view = device.createImageViewUnique(viewInfo);
+	return image;
+}
+
+SdfBrickMapBuffers SdfBrickMapBuffers::create(
+	const SdfBrickMap &brickMap, vk::PhysicalDevice physicalDevice, vk::Device device, vma::Allocator &allocator,
+	TransientCommandBufferPool &cmdBufferPool, vk::Queue queue
+) {
+	constexpr vk::Format cellFormat = vk::Format::eR32G32B32A32Sfloat;
+	constexpr vk::Format atlasFormat = vk::Format::eR16Sfloat;
+
+	SdfBrickMapBuffers result;
+	const SdfBrickMap::Settings &settings = brickMap.settings;
+	uint32_t edge = settings.brickResolution + 1;
+
+	// bricks are laid out in a 3D grid in the atlas, filling x first
+	std::array<uint32_t, 3> atlasBricks{ 1, 1, 1 };
+	if (!brickMap.empty() && brickMap.numBricks > 0) {
+		uint32_t maxBricksPerAxis = physicalDevice.getProperties().limits.maxImageDimension3D / edge;
+		atlasBricks[0] = std::min(brickMap.numBricks, maxBricksPerAxis);
+		atlasBricks[1] = std::min(ceilDiv(brickMap.numBricks, atlasBricks[0]), maxBricksPerAxis);
+		atlasBricks[2] = ceilDiv(brickMap.numBricks, atlasBricks[0] * atlasBricks[1]);
+		if (atlasBricks[2] > maxBricksPerAxis) {
+			std::cout <<
+				"SDF brick map: " << brickMap.numBricks << " bricks don't fit into a 3D image on this device, " <<
+				"using the exact field\n";
+		} else {
+			result._available = true;
+		}
+	}
+
+	vk::Extent3D cellExtent(1, 1, 1);
+	vk::Extent3D atlasExtent(1, 1, 1);
+	if (result._available) {
+		cellExtent = vk::Extent3D(brickMap.gridSize[0], brickMap.gridSize[1], brickMap.gridSize[2]);
+		atlasExtent = vk::Extent3D(atlasBricks[0] * edge, atlasBricks[1] * edge, atlasBricks[2] * edge);
+	}
+	result._cellImage = _createImage3D(allocator, device, cellExtent, cellFormat, result._cellView);
+	result._atlasImage = _createImage3D(allocator, device, atlasExtent, atlasFormat, result._atlasView);
+	result._sampler = createSampler(
+		device, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest, std::nullopt,
+		0.0f, 0.0f, 0.0f, vk::SamplerAddressMode::eClampToEdge
+	);
+
+	{
+		TransientCommandBuffer cmdBuffer = cmdBufferPool.begin(queue);
+		transitionImageLayout(
+			cmdBuffer.get(), result._cellImage.get(), cellFormat,
+			vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal
+		);
+		transitionImageLayout(
+			cmdBuffer.get(), result._atlasImage.get(), atlasFormat,
+			vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal
+		);
+
+		vma::UniqueBuffer staging;
+		if (result._available) {
+			// buffer offsets of copies must be multiples of 4
+			std::size_t cellBytes = brickMap.cells.size() * sizeof(SdfBrickMap::Cell);
+			std::size_t brickBytes = settings.getSamplesPerBrick() * sizeof(uint16_t);
+			std::size_t brickStride = ceilDiv<std::size_t>(brickBytes, 4) * 4;
+			staging = allocator.createTypedBuffer<char>(
+				cellBytes + brickStride * brickMap.numBricks,
+				vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_CPU_TO_GPU
+			);
+			char *stagingData = staging.mapAs<char>();
+			std::memcpy(stagingData, brickMap.cells.data(), cellBytes);
+			for (uint32_t brick = 0; brick < brickMap.numBricks; ++brick) {
+				std::memcpy(
+					stagingData + cellBytes + brick * brickStride,
+					brickMap.brickSamples.data() + static_cast<std::size_t>(brick) * settings.getSamplesPerBrick(),
+					brickBytes
+				);
+			}
+			staging.unmap();
+			staging.flush();
+
+			vk::BufferImageCopy cellCopy;
+			cellCopy
+				.setImageExtent(cellExtent)
+				.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1));
+			cmdBuffer->copyBufferToImage(
+				staging.get(), result._cellImage.get(), vk::ImageLayout::eTransferDstOptimal, cellCopy
+			);
+
+			std::vector<vk::BufferImageCopy> brickCopies(brickMap.numBricks);
+			for (uint32_t brick = 0; brick < brickMap.numBricks; ++brick) {
+				brickCopies[brick]
+					.setBufferOffset(cellBytes + brick * brickStride)
+					.setImageOffset(vk::Offset3D(
+						static_cast<int32_t>((brick % atlasBricks[0]) * edge),
+						static_cast<int32_t>(((brick / atlasBricks[0]) % atlasBricks[1]) * edge),
+						static_cast<int32_t>((brick / (atlasBricks[0] * atlasBricks[1])) * edge)
+					))
+					.setImageExtent(vk::Extent3D(edge, edge, edge))
+					.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1));
+			}
+			cmdBuffer->copyBufferToImage(
+				staging.get(), result._atlasImage.get(), vk::ImageLayout::eTransferDstOptimal, brickCopies
+			);
+		}
+
+		transitionImageLayout(
+			cmdBuffer.get(), result._cellImage.get(), cellFormat,
+			vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal
+		);
+		transitionImageLayout(
+			cmdBuffer.get(), result._atlasImage.get(), atlasFormat,
+			vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal
+		);
+		// the staging buffer must outlive the copy
+		cmdBuffer.submitAndWait();
+	}
+
+	result._uniformBuffer = allocator.createTypedBuffer<shader::SdfBrickMapParams>(
+		1, vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_CPU_TO_GPU
+	);
+	{
+		auto *params = result._uniformBuffer.mapAs<shader::SdfBrickMapParams>();
+		params->boundsMin_cellSize = nvmath::vec4f(settings.boundsMin, settings.cellSize);
+		params->gridSize_enabled = nvmath::ivec4(
+			static_cast<int32_t>(cellExtent.width), static_cast<int32_t>(cellExtent.height),
+			static_cast<int32_t>(cellExtent.depth), 0
+		);
+		params->atlasBricks_brickResolution = nvmath::ivec4(
+			static_cast<int32_t>(atlasBricks[0]), static_cast<int32_t>(atlasBricks[1]),
+			static_cast<int32_t>(atlasBricks[2]), static_cast<int32_t>(settings.brickResolution)
+		);
+		// below one voxel, the interpolated field is too coarse to resolve the fold; the error bound is added so that
+		// the exact function also takes over wherever the bound makes the baked distance too pessimistic
+		float largestErrorBound = 0.0f;
+		for (const SdfBrickMap::Cell &cell : brickMap.cells) {
+			largestErrorBound = std::max(largestErrorBound, cell.errorBound);
+		}
+		params->invAtlasSize_exactDistance = nvmath::vec4f(
+			1.0f / static_cast<float>(atlasExtent.width), 1.0f / static_cast<float>(atlasExtent.height),
+			1.0f / static_cast<float>(atlasExtent.depth), settings.getVoxelSize() + largestErrorBound
+		);
+		result._uniformBuffer.unmap();
+		result._uniformBuffer.flush();
+	}
+	result.setEnabled(result._available);
+
+	return result;
+}
+
+void SdfBrickMapBuffers::initializeDescriptorSet(
+	vk::Device device, vk::DescriptorSet set, vk::Buffer sphereTraceStatistics
+) const {
+	std::array<vk::DescriptorImageInfo, 2> imageInfo{
+		vk::DescriptorImageInfo(_sampler.get(), _cellView.get(), vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::DescriptorImageInfo(_sampler.get(), _atlasView.get(), vk::ImageLayout::eShaderReadOnlyOptimal)
+	};
+	vk::DescriptorBufferInfo uniformInfo(_uniformBuffer.get(), 0, sizeof(shader::SdfBrickMapParams));
+	vk::DescriptorBufferInfo statisticsInfo(sphereTraceStatistics, 0, sizeof(shader::SphereTraceStatistics));
+
+	std::array<vk::WriteDescriptorSet, 4> writes;
+	writes[0]
+		.setDstSet(set)
+		.setDstBinding(0)
+		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+		.setImageInfo(imageInfo[0]);
+	writes[1]
+		.setDstSet(set)
+		.setDstBinding(1)
+		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+		.setImageInfo(imageInfo[1]);
+	writes[2]
+		.setDstSet(set)
+		.setDstBinding(2)
+		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
+		.setBufferInfo(uniformInfo);
+	writes[3]
+		.setDstSet(set)
+		.setDstBinding(3)
+		.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+		.setBufferInfo(statisticsInfo);
+	device.updateDescriptorSets(writes, {});
+}
+
+void SdfBrickMapBuffers::setEnabled(bool enabled) {
+	_enabled = enabled && _available;
+	auto *params = _uniformBuffer.mapAs<shader::SdfBrickMapParams>();
+	params->gridSize_enabled.w = _enabled ? 1 : 0;
+	_uniformBuffer.unmap();
+	_uniformBuffer.flush();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <nvmath.h>
+
+#include "sdf.h"
+#include "shaderIncludes.h"
+#include "transientCommandBuffer.h"
+#include "vma.h"
+
+/// The procedural SDF sampled into a sparse brick map. The baked region is divided into a grid of cells. Every cell
+/// stores the distance at its center, and cells close to the surface additionally store a brick of distance samples at
+/// the corners of its voxels. Shaders sphere-trace the baked field far away from the surface and switch to the exact
+/// function close to it; see shaders/include/sdfBrickMap.glsl.
+struct SdfBrickMap {
+	/// Increment when the field in SDF.glsl and sdf.cpp changes, so that cached bakes are discarded.
+	constexpr static uint32_t fieldVersion = 1;
+
+	struct Settings {
+		nvmath::vec3f boundsMin{ -256.0f, -256.0f, -256.0f };
+		nvmath::vec3f boundsMax{ 256.0f, 256.0f, 256.0f };
+		float cellSize = 8.0f;
+		uint32_t brickResolution = 8; ///< Number of voxels along the edge of a brick.
+		/// Cells that are further away from the surface than this get no brick.
+		float narrowBand = 8.0f;
+		sdf::FoldParameters fold;
+
+		[[nodiscard]] float getVoxelSize() const {
+			return cellSize / static_cast<float>(brickResolution);
+		}
+		[[nodiscard]] uint32_t getSamplesPerBrick() const {
+			uint32_t edge = brickResolution + 1;
+			return edge * edge * edge;
+		}
+	};
+	/// Layout of a texel of the cell texture.
+	struct Cell {
+		float centerDistance;
+		float brickIndex; ///< -1 if the cell has no brick.
+		/// Largest amount by which the trilinearly interpolated brick can overestimate the distance, given that the
+		/// field is 1-Lipschitz.
+		float errorBound;
+		float padding;
+	};
+
+	Settings settings;
+	std::array<uint32_t, 3> gridSize{ 0, 0, 0 };
+	std::vector<Cell> cells; ///< Cells with x varying fastest.
+	/// Half-precision distance samples, \ref Settings::getSamplesPerBrick() per brick with x varying fastest.
+	std::vector<uint16_t> brickSamples;
+	uint32_t numBricks = 0;
+
+	/// Bakes the brick map on all hardware threads.
+	[[nodiscard]] static SdfBrickMap bake(const Settings&);
+	/// Loads the brick map from the given cache file if it was baked with the same settings and the same field
+	/// version, otherwise bakes it and updates the cache.
+	[[nodiscard]] static SdfBrickMap loadOrBake(const Settings&, const std::filesystem::path &cachePath);
+
+	[[nodiscard]] static std::optional<SdfBrickMap> load(const Settings&, const std::filesystem::path&);
+	void save(const std::filesystem::path&) const;
+
+	[[nodiscard]] bool empty() const {
+		return cells.empty();
+	}
+
+	/// Frees the cells and bricks once they have been uploaded; only the settings and sizes are kept.
+	void releaseHostData() {
+		std::vector<Cell>().swap(cells);
+		std::vector<uint16_t>().swap(brickSamples);
+	}
+};
+
+/// Device copy of a \ref SdfBrickMap, bound as one descriptor set that is shared by all passes that march the SDF.
+class SdfBrickMapBuffers {
+public:
+	/// Creates the layout of the shared descriptor set. Every pass creates its own copy; since the copies are
+	/// identically defined, a set allocated with any of them can be bound to all passes.
+	[[nodiscard]] static vk::UniqueDescriptorSetLayout createDescriptorSetLayout(vk::Device);
+
+	/// Uploads the given brick map. If the brick map is empty, placeholder resources are created and the baked field is
+	/// never used.
+	[[nodiscard]] static SdfBrickMapBuffers create(
+		const SdfBrickMap&, vk::PhysicalDevice, vk::Device, vma::Allocator&, TransientCommandBufferPool&, vk::Queue
+	);
+
+	/// Writes the brick map to the given set, along with the \p shader::SphereTraceStatistics buffer that is bound to
+	/// the same set since it is written by the same marchers.
+	void initializeDescriptorSet(vk::Device, vk::DescriptorSet, vk::Buffer sphereTraceStatistics) const;
+
+	/// Returns whether shaders use the baked field. Always false if no brick map has been uploaded.
+	[[nodiscard]] bool isEnabled() const {
+		return _enabled;
+	}
+	[[nodiscard]] bool isAvailable() const {
+		return _available;
+	}
+	/// Switches between the baked and the exact field. Has no effect if no brick map has been uploaded.
+	void setEnabled(bool);
+
+	[[nodiscard]] vk::DeviceSize getDeviceMemorySize() const {
+		return
+			_cellImage.getAllocationSize() + _atlasImage.getAllocationSize() + _uniformBuffer.getAllocationSize();
+	}
+private:
+	vma::UniqueImage _cellImage;
+	vk::UniqueImageView _cellView;
+	vma::UniqueImage _atlasImage;
+	vk::UniqueImageView _atlasView;
+	vk::UniqueSampler _sampler;
+	vma::UniqueBuffer _uniformBuffer;
+	bool _available = false;
+	bool _enabled = false;
+};
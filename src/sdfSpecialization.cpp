@@ -0,0 +1,76 @@
+#include "sdfSpecialization.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+/// Layout of the specialization data, with one member per constant.
+struct SdfSpecializationData {
+	int32_t foldSteps;
+	float foldFloor;
+	float foldRotation[9];
+	uint32_t emissiveIterationsLow;
+	uint32_t emissiveIterationsHigh;
+	vk::Bool32 sphereTraceStatistics;
+};
+
+SdfSpecialization::Parameters _sdfSpecializationParameters;
+SdfSpecializationData _sdfSpecializationData;
+std::array<vk::SpecializationMapEntry, 14> _sdfSpecializationEntries;
+vk::SpecializationInfo _sdfSpecializationInfo;
+bool _sdfSpecializationInitialized = false;
+
+void SdfSpecialization::set(const Parameters &params) {
+	_sdfSpecializationParameters = params;
+
+	// the rotation is constant across the whole fold, so it is computed once here instead of in every iteration
+	sdf::FoldRotation rotation(params.fold.rotationAngle);
+	_sdfSpecializationData.foldSteps = params.fold.steps;
+	_sdfSpecializationData.foldFloor = params.fold.floor;
+	for (int column = 0; column < 3; ++column) {
+		for (int row = 0; row < 3; ++row) {
+			_sdfSpecializationData.foldRotation[column * 3 + row] = rotation.columns[column][row];
+		}
+	}
+	_sdfSpecializationData.emissiveIterationsLow = static_cast<uint32_t>(params.emissiveIterations);
+	_sdfSpecializationData.emissiveIterationsHigh = static_cast<uint32_t>(params.emissiveIterations >> 32);
+	_sdfSpecializationData.sphereTraceStatistics = params.sphereTraceStatistics ? VK_TRUE : VK_FALSE;
+
+	_sdfSpecializationEntries[0] = vk::SpecializationMapEntry(
+		foldStepsId, offsetof(SdfSpecializationData, foldSteps), sizeof(int32_t)
+	);
+	_sdfSpecializationEntries[1] = vk::SpecializationMapEntry(
+		foldFloorId, offsetof(SdfSpecializationData, foldFloor), sizeof(float)
+	);
+	for (uint32_t i = 0; i < 9; ++i) {
+		_sdfSpecializationEntries[2 + i] = vk::SpecializationMapEntry(
+			foldRotationId + i,
+			static_cast<uint32_t>(offsetof(SdfSpecializationData, foldRotation) + i * sizeof(float)), sizeof(float)
+		);
+	}
+	_sdfSpecializationEntries[11] = vk::SpecializationMapEntry(
+		emissiveIterationsLowId, offsetof(SdfSpecializationData, emissiveIterationsLow), sizeof(uint32_t)
+	);
+	_sdfSpecializationEntries[12] = vk::SpecializationMapEntry(
+		emissiveIterationsHighId, offsetof(SdfSpecializationData, emissiveIterationsHigh), sizeof(uint32_t)
+	);
+	_sdfSpecializationEntries[13] = vk::SpecializationMapEntry(
+		sphereTraceStatisticsId, offsetof(SdfSpecializationData, sphereTraceStatistics), sizeof(vk::Bool32)
+	);
+
+	_sdfSpecializationInfo
+		.setMapEntries(_sdfSpecializationEntries)
+		.setDataSize(sizeof(SdfSpecializationData))
+		.setPData(&_sdfSpecializationData);
+	_sdfSpecializationInitialized = true;
+}
+
+const SdfSpecialization::Parameters &SdfSpecialization::getParameters() {
+	assert(_sdfSpecializationInitialized);
+	return _sdfSpecializationParameters;
+}
+
+const vk::SpecializationInfo &SdfSpecialization::getInfo() {
+	assert(_sdfSpecializationInitialized);
+	return _sdfSpecializationInfo;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+#include "sdf.h"
+
+/// Process-wide values of the SDF specialization constants declared in shaders/include/sdfSpecialization.glsl. Passes
+/// that evaluate the SDF attach \ref getInfo() to the shader stages that include it, so that the fold is compiled with
+/// a constant iteration count and a precomputed rotation. After \ref set() changes the parameters, those passes must
+/// recreate their pipelines.
+class SdfSpecialization {
+public:
+	/// Constant IDs, matching the \p constant_id qualifiers in the shaders.
+	enum ConstantId : uint32_t {
+		foldStepsId = 0,
+		foldFloorId = 1,
+		foldRotationId = 2, ///< Nine consecutive IDs, one per element of the column-major rotation matrix.
+		emissiveIterationsLowId = 11,
+		emissiveIterationsHighId = 12,
+		sphereTraceStatisticsId = 13
+	};
+
+	struct Parameters {
+		sdf::FoldParameters fold;
+		/// Bit \p k is set if fold iteration \p k is emissive. Only the first 64 iterations can be emissive.
+		uint64_t emissiveIterations = 1ull << 21;
+		/// Whether marchers count their rays and steps; see \p shader::SphereTraceStatistics.
+		bool sphereTraceStatistics = false;
+
+		[[nodiscard]] friend bool operator==(const Parameters&, const Parameters&) = default;
+	};
+
+	/// Sets the specialization constants used by pipelines created from now on. Must be called before any pass is
+	/// created, and never while pipelines are being created on other threads.
+	static void set(const Parameters&);
+	[[nodiscard]] static const Parameters &getParameters();
+	/// Returns the specialization info for the current parameters. The returned object stays valid until the next call
+	/// to \ref set().
+	[[nodiscard]] static const vk::SpecializationInfo &getInfo();
+};
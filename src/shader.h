@@ -12,6 +12,13 @@ public:
 	[[nodiscard]] const vk::PipelineShaderStageCreateInfo &getStageInfo() const {
 		return _shaderInfo;
 	}
+	/// Returns the stage info with the given specialization constants attached. The specialization info must stay
+	/// valid until the pipeline has been created.
+	[[nodiscard]] vk::PipelineShaderStageCreateInfo getStageInfo(const vk::SpecializationInfo &specialization) const {
+		vk::PipelineShaderStageCreateInfo info = _shaderInfo;
+		info.setPSpecializationInfo(&specialization);
+		return info;
+	}
 
 	[[nodiscard]] bool empty() const {
 		return !_module;
@@ -29,6 +29,9 @@ namespace shader {
 #include "shaders/include/structs/lightingPassStructs.glsl"
 #include "shaders/include/structs/restirStructs.glsl"
 #include "shaders/include/structs/sceneStructs.glsl"
+#include "shaders/include/structs/sdfBrickMapStructs.glsl"
+#include "shaders/include/structs/sdfStructs.glsl"
+#include "shaders/include/structs/sphereTraceStructs.glsl"
 #include "shaders/include/structs/light.glsl"
 
 #ifdef SHADER_DEFINE_INT_UB
@@ -1,6 +1,3 @@
-//comment out do disable emissive materials, which are assigned by the iteration count
-#define EMISSIVE_MATERIALS
-
 #ifndef TAU
 #define TAU 6.28318530718
 #endif
@@ -13,25 +10,14 @@ vec3 palette(float t) {
     return a + b * cos(TAU * (c * t + d));
 }
 
-// EMISSIVE ITERATIONS
+// emissive materials are assigned by the iteration count; the list of emissive iterations is a specialization
+// constant, see sdfSpecialization.glsl
 bool isEmissiveIteration(int k) {
-    //set this to the number of list items
-    const int EM_COUNT = 1;
-    
-    //enter specific iterations here
-    const int EM_IDS[EM_COUNT] = int[]/* ------> */ (21);
-    
-    #ifdef EMISSIVE_MATERIALS
-    
-    for (int i = 0; i < EM_COUNT; ++i) {
-        if (k == EM_IDS[i]) {
-            return true;
-        }
+    if (k < 0 || k >= 64) {
+        return false;
     }
-    
-    #endif
-    
-    return false;
+    uint bits = k < 32 ? EMISSIVE_ITERATIONS_LOW : EMISSIVE_ITERATIONS_HIGH;
+    return ((bits >> uint(k & 31)) & 1u) != 0u;
 }
 
 void GetMaterial(vec3 p, float matId,
@@ -59,5 +45,5 @@ void GetMaterial(vec3 p, float matId,
     float eMask = emissiveIter ? 1.0 : 0.0;
 
     // Emission uses the palette color so embedded texture becomes emissive
-    emission = albedo * eMask * 2.0;
+    emission = albedo * eMask * SDF_EMISSION_STRENGTH;
 }
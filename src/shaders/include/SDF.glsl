@@ -1,3 +1,6 @@
+#include "sdfSpecialization.glsl"
+#include "structs/sdfStructs.glsl"
+
 float sdBox(vec3 p, vec3 s) {
     p = abs(p)-s;
 	return length(max(p, 0.))+min(max(p.x, max(p.y, p.z)), 0.);
@@ -23,19 +26,20 @@ mat3 rotate3D(float ang, vec3 axis){
 
 
 
-vec2 GetDistMat(vec3 p){
-    vec3 a = vec3(1.0, 0.0, 0.0);
-
+// Level of detail: the folds only add detail, so stopping early yields a lower bound of the distance that can be
+// stepped safely. Iterations whose cells are smaller than lodCellSize are skipped, but only while the distance is above
+// lodCellSize; close to the surface all iterations run, so hits, normals and materials are always computed at full
+// detail. A lodCellSize of 0 disables the LOD.
+vec2 GetDistMatLod(vec3 p, float lodCellSize){
     vec3 q = p;
     float d = q.y;
     float mat = 0.0;
 
-    float iVal = 250.0;
+    float iVal = SDF_FOLD_INITIAL_SIZE;
 
     for(int k=0; k<FOLD_STEPS; k++){
-        mat3 foldRot = rotate3D(0.5, a.zxz); 
-        vec3 cell    = mod(q * foldRot, iVal + iVal) - iVal;
-        q            = iVal * 0.9 - abs(cell);
+        vec3 cell    = mod(q * FOLD_ROTATION, iVal + iVal) - iVal;
+        q            = iVal * SDF_FOLD_THICKNESS - abs(cell);
 
         float dFoldX = min(q.x, q.y);
         float dMin   = min(dFoldX, q.z);
@@ -47,8 +51,9 @@ vec2 GetDistMat(vec3 p){
             mat = float(k) / float(FOLD_STEPS-1);
         }
 
-        iVal *= 0.75;
+        iVal *= SDF_FOLD_SIZE_FALLOFF;
         if(iVal < FOLD_FLOOR) break;
+        if(iVal + iVal < lodCellSize && d > lodCellSize) break;
     }
 
     //d = max(p.y, d);
@@ -59,6 +64,9 @@ vec2 GetDistMat(vec3 p){
     return vec2(d, mat);
 }
 
+vec2 GetDistMat(vec3 p){
+    return GetDistMatLod(p, 0.0);
+}
 
 float GetDist(vec3 p){
     return GetDistMat(p).x;
@@ -0,0 +1,60 @@
+// Requires the emissiveSamples, emissiveSampleCdf, pointLights, triangleLights and sceneLightAliasTable buffers and the
+// RestirUniforms to be declared, and sceneLights.glsl to be included.
+
+// Selects an emissive sample with a probability proportional to its luminance.
+int sampleEmissiveSample(float u) {
+	int low = 0;
+	int high = int(emissiveSamples.count) - 1;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (emissiveSampleCdf.cdf[mid] <= u) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+// Total luminance of the emissive samples of the SDF.
+float getEmissiveSampleLuminance() {
+	return emissiveSamples.count > 0u ? max(emissiveSampleCdf.totalLuminance, 0.0f) : 0.0f;
+}
+// Total luminance of the scene lights drawn by sampleEmissiveLight(). While the light tree is used, it is the only
+// source of scene lights.
+float getSceneLightLuminance() {
+	if ((uniforms.flags & RESTIR_LIGHT_TREE_FLAG) != 0 || sceneLightAliasTable.count == 0u) {
+		return 0.0f;
+	}
+	return max(uniforms.sceneLightLuminance, 0.0f);
+}
+
+// Draws a light from the mixture of two disjoint sources: the emissive samples of the SDF, selected with their CDF, and
+// the scene lights, selected with their static alias table, see LightTree::aliasTable. Each source is picked in
+// proportion to its total luminance, so every light is selected in proportion to its luminance, and its pdf is the
+// probability of its source times its probability within the source. Scene lights are identified by
+// encodeSceneLightIndex(). Returns false if there is no light to select.
+bool sampleEmissiveLight(inout Rand rand, out EmissiveSample light, out int lightIndex, out float pdf) {
+	float sampleLuminance = getEmissiveSampleLuminance();
+	float sceneLuminance = getSceneLightLuminance();
+	if (sampleLuminance + sceneLuminance <= 0.0f) {
+		return false;
+	}
+	float sampleProb = sampleLuminance / (sampleLuminance + sceneLuminance);
+	if (randFloat(rand) < sampleProb) {
+		lightIndex = sampleEmissiveSample(randFloat(rand));
+		light = emissiveSamples.samples[lightIndex];
+		pdf = sampleProb * light.position_luminance.w / emissiveSampleCdf.totalLuminance;
+	} else {
+		// 64 random bits, so that the column is uniformly distributed even among millions of lights
+		uint64_t bits = (uint64_t(randUint(rand)) << 32u) | uint64_t(randUint(rand));
+		uint column = uint(bits % uint64_t(sceneLightAliasTable.count));
+		aliasTableColumn entry = sceneLightAliasTable.columns[column];
+		bool keepColumn = randFloat(rand) < entry.prob;
+		uint selected = keepColumn ? column : uint(entry.alias);
+		light = sampleSceneLight(selected, rand);
+		lightIndex = encodeSceneLightIndex(selected);
+		pdf = (1.0f - sampleProb) * (keepColumn ? entry.oriProb : entry.aliasOriProb);
+	}
+	return pdf > 0.0f;
+}
@@ -0,0 +1,137 @@
+// Per-pixel work of the G-buffer pass shared by gBuffer.frag and gBuffer.comp. Include SDF.glsl, SDF-Material.glsl,
+// sdfBrickMap.glsl, gBufferUniforms.glsl and sphereTrace.glsl first.
+
+// world positions written by the previous frame, zero where its rays missed
+layout (set = 2, binding = 0) uniform sampler2D prevWorldPosition;
+
+struct GBufferTexel {
+	vec4 albedo;
+	vec3 normal;
+	vec2 materialProperties;
+	vec3 worldPosition;
+	float depth;
+};
+
+float getSdfDistance(vec3 worldPos) {
+	float scale = uniforms.sdfScene.w;
+	vec3 sdfPos = worldPos * scale + uniforms.sdfScene.xyz;
+	return GetDist(sdfPos) / max(scale, 0.0001);
+}
+
+vec3 estimateNormal(vec3 worldPos, float epsilon) {
+	vec2 h = vec2(epsilon, 0.0);
+	float dx = getSdfDistance(worldPos + h.xyy) - getSdfDistance(worldPos - h.xyy);
+	float dy = getSdfDistance(worldPos + h.yxy) - getSdfDistance(worldPos - h.yxy);
+	float dz = getSdfDistance(worldPos + h.yyx) - getSdfDistance(worldPos - h.yyx);
+	return normalize(vec3(dx, dy, dz));
+}
+
+// Estimates from the hits of the previous frame how far the view ray can skip ahead, and returns the larger of that and
+// tStart. The previous hit through this pixel is reprojected into the previous frame to find the pixels that saw the
+// same surface; the nearest of their hits along the current ray is taken so that silhouettes are not skipped. The
+// reprojection is only a guess, since the previous frame may have missed thin detail that the camera motion reveals,
+// so the skip is only taken if the SDF proves the skipped segment empty: every distance sample is a sphere without
+// surface, and the ray is marched back from the estimate until the spheres reach tStart. If that does not happen within
+// temporalHitDistance.z samples, the full march is kept.
+float getTemporalStartDistance(ivec2 pixel, vec3 rayOrigin, vec3 rayDir, float tStart, float maxDistance) {
+	ivec2 size = textureSize(prevWorldPosition, 0);
+	vec3 prevHit = texelFetch(prevWorldPosition, pixel, 0).xyz;
+	if (prevHit == vec3(0.0f)) {
+		return tStart;
+	}
+
+	vec3 predictedHit = rayOrigin + rayDir * dot(prevHit - rayOrigin, rayDir);
+	vec4 prevFramePos = uniforms.prevProjectionViewMatrix * vec4(predictedHit, 1.0f);
+	if (prevFramePos.w <= 0.0f) {
+		return tStart;
+	}
+	ivec2 prevFrag = ivec2((prevFramePos.xy / prevFramePos.w + 1.0f) * 0.5f * vec2(size));
+
+	float tHit = maxDistance;
+	for (int y = -1; y <= 1; ++y) {
+		for (int x = -1; x <= 1; ++x) {
+			ivec2 frag = prevFrag + ivec2(x, y);
+			if (any(lessThan(frag, ivec2(0))) || any(greaterThanEqual(frag, size))) {
+				continue;
+			}
+			vec3 hit = texelFetch(prevWorldPosition, frag, 0).xyz;
+			if (hit != vec3(0.0f)) {
+				tHit = min(tHit, dot(hit - rayOrigin, rayDir));
+			}
+		}
+	}
+
+	float t = tHit * (1.0f - uniforms.temporalHitDistance.y);
+	if (tHit >= maxDistance || t <= tStart) {
+		return tStart;
+	}
+	float covered = t; // [covered, t] is known to be empty
+	for (int i = 0; i < int(uniforms.temporalHitDistance.z); ++i) {
+		float dist = getWorldDistMat(rayOrigin + rayDir * covered).x;
+		if (dist < uniforms.sdfParams.y) {
+			return tStart;
+		}
+		covered -= dist;
+		if (covered <= tStart) {
+			return t;
+		}
+	}
+	return tStart;
+}
+
+// Distance along the view ray through the given pixel from which it starts marching.
+float getGBufferStartDistance(ivec2 pixel, vec3 rayOrigin, vec3 rayDir) {
+	// skip the empty space in front of the surface that the prepass has found for the whole tile
+	float tStart = 0.0f;
+	if (uniforms.conePrepass.x != 0u) {
+		tStart = imageLoad(coneStartDistance, pixel / int(uniforms.conePrepass.x)).x;
+	}
+	if (uniforms.temporalHitDistance.x != 0.0f) {
+		tStart = getTemporalStartDistance(pixel, rayOrigin, rayDir, tStart, uniforms.sdfParams.x);
+	}
+	return tStart;
+}
+
+GBufferTexel getMissedGBufferTexel() {
+	GBufferTexel texel;
+	texel.albedo = vec4(0.0f);
+	texel.normal = vec3(0.0f);
+	texel.materialProperties = vec2(0.0f);
+	texel.worldPosition = vec3(0.0f);
+	texel.depth = 1.0f;
+	return texel;
+}
+
+// Marches the view ray from tStart and shades the surface it hits.
+GBufferTexel traceGBufferTexel(vec3 rayOrigin, vec3 rayDir, float tStart) {
+	float maxDistance = uniforms.sdfParams.x;
+	float epsilon = uniforms.sdfParams.y;
+
+	SphereTraceResult trace = sphereTrace(
+		rayOrigin, rayDir, tStart, maxDistance, uniforms.sdfLod.x, SPHERE_TRACE_GBUFFER
+	);
+	if (!trace.hit) {
+		return getMissedGBufferTexel();
+	}
+
+	vec3 worldPos = rayOrigin + rayDir * trace.t;
+	float matId = trace.matId;
+	vec3 normal = estimateNormal(worldPos, epsilon * 2.0f);
+	vec3 albedo;
+	float roughness;
+	float metallic;
+	vec3 emission;
+	vec3 sdfPos = worldPos * uniforms.sdfScene.w + uniforms.sdfScene.xyz;
+	GetMaterial(sdfPos, matId, albedo, roughness, metallic, emission);
+
+	GBufferTexel texel;
+	float emissiveFlag = length(emission) > 0.0f ? 1.0f : 0.0f;
+	texel.albedo = vec4(emissiveFlag > 0.5f ? emission : albedo, emissiveFlag);
+	texel.normal = normal;
+	texel.materialProperties = vec2(roughness, metallic);
+	texel.worldPosition = worldPos;
+
+	vec4 clipPos = uniforms.projectionMatrix * uniforms.viewMatrix * vec4(worldPos, 1.0f);
+	texel.depth = clipPos.z / clipPos.w;
+	return texel;
+}
@@ -0,0 +1,27 @@
+// Resources of the G-buffer pass shared by gBuffer.frag and the cone prepass, matching GBufferPass::Uniforms.
+
+layout (set = 0, binding = 0) uniform Uniforms {
+	mat4 projectionMatrix;
+	mat4 viewMatrix;
+	mat4 inverseProjectionMatrix;
+	mat4 inverseViewMatrix;
+	vec4 cameraPosition;
+	vec4 sdfParams;
+	vec4 sdfScene;
+	uvec4 conePrepass; // x: edge length of a prepass tile in pixels, or 0 if the prepass is disabled
+	mat4 prevProjectionViewMatrix;
+	// x: nonzero if the hits of the previous frame can seed the march, y: fraction of the reprojected hit distance by
+	// which the march backs off, z: number of SDF samples that may be spent on proving the skipped segment empty
+	vec4 temporalHitDistance;
+	vec4 sdfLod; // x: growth of the level of detail of the SDF per unit of distance along a view ray, or 0
+} uniforms;
+
+// distance along the view ray at which the surface can first be hit, per prepass tile
+layout (set = 0, binding = 1, r32f) uniform image2D coneStartDistance;
+
+// Direction of the view ray through the given point of the screen, in [0, 1]^2 with the origin at the top left.
+vec3 getViewRayDirection(vec2 uv) {
+	vec4 view = uniforms.inverseProjectionMatrix * vec4(uv * 2.0f - 1.0f, 1.0f, 1.0f);
+	view /= view.w;
+	return normalize((uniforms.inverseViewMatrix * vec4(view.xyz, 0.0f)).xyz);
+}
@@ -0,0 +1,70 @@
+// Requires the lightTree, pointLights and triangleLights buffers to be declared, see LightTreeBuffers, and M_PI.
+
+#include "sceneLights.glsl"
+
+// Estimates the contribution of the lights below the node to the given point, or returns 0 if they cannot contribute.
+// The bounds of the node are enclosed in a sphere, which spans a cone of directions from the point.
+float getLightTreeNodeImportance(LightTreeNode node, vec3 p, vec3 n) {
+	float intensity = node.boundsMin_intensity.w;
+	if (intensity <= 0.0f) {
+		return 0.0f;
+	}
+	vec3 boundsMin = node.boundsMin_intensity.xyz;
+	vec3 boundsMax = node.boundsMax_cosNormalBound.xyz;
+	vec3 toCenter = 0.5f * (boundsMin + boundsMax) - p;
+	float radius = 0.5f * length(boundsMax - boundsMin);
+	float sqrDist = dot(toCenter, toCenter);
+	float dist = sqrt(sqrDist);
+
+	float boundAngle = dist > radius ? asin(radius / dist) : M_PI;
+	vec3 dir = dist > 0.0f ? toCenter / dist : n;
+	// the BRDF is zero below the horizon
+	float receiverAngle = max(acos(clamp(dot(n, dir), -1.0f, 1.0f)) - boundAngle, 0.0f);
+	if (receiverAngle >= 0.5f * M_PI) {
+		return 0.0f;
+	}
+	// triangle lights emit on both sides, so only the angle to the line through the axis matters
+	float normalBound = acos(clamp(node.boundsMax_cosNormalBound.w, -1.0f, 1.0f));
+	float axisAngle = acos(clamp(abs(dot(node.axis.xyz, dir)), 0.0f, 1.0f));
+	float emitterAngle = max(axisAngle - normalBound - boundAngle, 0.0f);
+
+	return intensity * cos(receiverAngle) * cos(emitterAngle) / max(sqrDist, max(radius * radius, 1e-4f));
+}
+
+// Descends the light tree from the root, choosing each child in proportion to its importance, and samples a point on
+// the light in the reached leaf. The luminance of a triangle light is multiplied by its area, so that the point acts
+// like a point light with the probability pdf. Returns false if no light can contribute to the point.
+bool sampleLightTree(
+	vec3 p, vec3 n, inout Rand rand,
+	out vec3 position, out vec4 normal, out float lum, out int lightIndex, out float pdf
+) {
+	pdf = 1.0f;
+	if (lightTree.count == 0u || getLightTreeNodeImportance(lightTree.nodes[0], p, n) <= 0.0f) {
+		return false;
+	}
+	int node = 0;
+	while (lightTree.nodes[node].children.x >= 0) {
+		ivec4 children = lightTree.nodes[node].children;
+		float left = getLightTreeNodeImportance(lightTree.nodes[children.x], p, n);
+		float right = getLightTreeNodeImportance(lightTree.nodes[children.y], p, n);
+		if (left + right <= 0.0f) {
+			return false;
+		}
+		float leftProb = left / (left + right);
+		if (randFloat(rand) < leftProb) {
+			node = children.x;
+			pdf *= leftProb;
+		} else {
+			node = children.y;
+			pdf *= 1.0f - leftProb;
+		}
+	}
+
+	uint light = uint(lightTree.nodes[node].children.y);
+	lightIndex = encodeSceneLightIndex(light);
+	EmissiveSample lightSample = sampleSceneLight(light, rand);
+	position = lightSample.position_luminance.xyz;
+	normal = vec4(lightSample.normal_pdf.xyz, light < pointLights.count ? 0.0f : 1.0f);
+	lum = lightSample.position_luminance.w;
+	return pdf > 0.0f;
+}
@@ -0,0 +1,31 @@
+// Requires the ReSTIR uniforms to be declared.
+
+// The ReGIR grid is centered on the camera and snapped to whole cells, so that a cell keeps its world position while the
+// camera moves within it.
+vec3 getRegirGridOrigin() {
+	float halfExtent = 0.5f * float(uniforms.regirGrid.x) * uniforms.regirCellSize;
+	return floor(uniforms.cameraPos.xyz / uniforms.regirCellSize) * uniforms.regirCellSize - halfExtent;
+}
+
+// Returns the index of the cell that contains the point, or -1 if the point is outside the grid.
+int getRegirCell(vec3 p) {
+	int cells = int(uniforms.regirGrid.x);
+	ivec3 cell = ivec3(floor((p - getRegirGridOrigin()) / uniforms.regirCellSize));
+	if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, ivec3(cells)))) {
+		return -1;
+	}
+	return (cell.z * cells + cell.y) * cells + cell.x;
+}
+
+vec3 getRegirCellCenter(uint cell) {
+	uint cells = uniforms.regirGrid.x;
+	uvec3 coord = uvec3(cell % cells, (cell / cells) % cells, cell / (cells * cells));
+	return getRegirGridOrigin() + (vec3(coord) + 0.5f) * uniforms.regirCellSize;
+}
+
+// Target function of the light reservoirs of a cell: the luminance of the light over its squared distance to the cell
+// center. The distance is clamped to half the diagonal of a cell so that lights within the cell are not overweighted.
+float evaluateRegirTarget(vec3 cellCenter, vec3 lightPos, float lum) {
+	vec3 offset = lightPos - cellCenter;
+	return lum / max(dot(offset, offset), 0.75f * uniforms.regirCellSize * uniforms.regirCellSize);
+}
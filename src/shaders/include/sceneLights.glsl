@@ -0,0 +1,45 @@
+// Requires the pointLights and triangleLights buffers to be declared, see LightTreeBuffers, and the Rand and
+// EmissiveSample types.
+
+// Samples of the scene lights are stored in reservoirs with light indices below -1.
+int encodeSceneLightIndex(uint light) {
+	return -2 - int(light);
+}
+uint decodeSceneLightIndex(int lightIndex) {
+	return uint(-2 - lightIndex);
+}
+
+// Returns the emission of a sample of a scene light drawn by sampleLightTree(); triangle lights are scaled by their area.
+vec3 getSceneLightEmission(int lightIndex) {
+	uint light = decodeSceneLightIndex(lightIndex);
+	if (light < pointLights.count) {
+		return pointLights.lights[light].color_luminance.rgb;
+	}
+	light -= pointLights.count;
+	if (light < triangleLights.count) {
+		return triangleLights.lights[light].emission_luminance.rgb * triangleLights.lights[light].normalArea.w;
+	}
+	return vec3(0.0f);
+}
+
+// Draws a sample of the given scene light. Triangle lights get a uniformly distributed point and act like a point light
+// with their emission times their area; point lights have a zero normal.
+EmissiveSample sampleSceneLight(uint light, inout Rand rand) {
+	EmissiveSample result;
+	if (light < pointLights.count) {
+		pointLight point = pointLights.lights[light];
+		result.position_luminance = vec4(point.pos.xyz, point.color_luminance.w);
+		result.normal_pdf = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		result.emission = vec4(point.color_luminance.rgb, 0.0f);
+	} else {
+		triLight tri = triangleLights.lights[light - pointLights.count];
+		// uniformly distributed barycentric coordinates
+		float sqrtU = sqrt(randFloat(rand));
+		float v = randFloat(rand);
+		vec3 position = (1.0f - sqrtU) * tri.p1.xyz + (sqrtU * (1.0f - v)) * tri.p2.xyz + (sqrtU * v) * tri.p3.xyz;
+		result.position_luminance = vec4(position, tri.emission_luminance.w * tri.normalArea.w);
+		result.normal_pdf = vec4(tri.normalArea.xyz, 1.0f);
+		result.emission = vec4(tri.emission_luminance.rgb * tri.normalArea.w, 0.0f);
+	}
+	return result;
+}
@@ -0,0 +1,58 @@
+// Sparse brick map of the SDF, baked on the CPU by SdfBrickMap. The baked region is divided into cells; each cell
+// stores the distance at its center, and cells near the surface additionally store a brick of distance samples in the
+// atlas. Define SDF_BRICK_MAP_SET before including this file, and include SDF.glsl first.
+
+#include "structs/sdfBrickMapStructs.glsl"
+
+// x: distance at the cell center, y: brick index or -1, z: interpolation error bound of the brick
+layout (set = SDF_BRICK_MAP_SET, binding = 0) uniform sampler3D sdfBrickMapCells;
+layout (set = SDF_BRICK_MAP_SET, binding = 1) uniform sampler3D sdfBrickMapAtlas;
+layout (set = SDF_BRICK_MAP_SET, binding = 2) uniform SdfBrickMapUniforms {
+	SdfBrickMapParams sdfBrickMap;
+};
+
+// Returns a lower bound of the distance to the surface, or a negative value if the point is outside of the baked
+// region. Like the rest of the SDF code, this relies on the field being 1-Lipschitz: the cell distance is reduced by
+// the distance to the cell center, and brick samples by the bound on the interpolation error computed by SdfBrickMap.
+float getBakedSdfDistance(vec3 sdfPos) {
+	float cellSize = sdfBrickMap.boundsMin_cellSize.w;
+	vec3 cellPos = (sdfPos - sdfBrickMap.boundsMin_cellSize.xyz) / cellSize;
+	ivec3 cell = ivec3(floor(cellPos));
+	if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, sdfBrickMap.gridSize_enabled.xyz))) {
+		return -1.0f;
+	}
+
+	vec3 cellData = texelFetch(sdfBrickMapCells, cell, 0).xyz;
+	if (cellData.y < 0.0f) {
+		// the field is 1-Lipschitz, so the distance can drop by at most the distance to the cell center
+		return cellData.x - length(cellPos - (vec3(cell) + 0.5f)) * cellSize;
+	}
+
+	int brick = int(cellData.y);
+	ivec3 atlasBricks = sdfBrickMap.atlasBricks_brickResolution.xyz;
+	ivec3 brickCoord = ivec3(
+		brick % atlasBricks.x, (brick / atlasBricks.x) % atlasBricks.y, brick / (atlasBricks.x * atlasBricks.y)
+	);
+	float resolution = float(sdfBrickMap.atlasBricks_brickResolution.w);
+	// bricks store samples at voxel corners, so the brick covers the cell from the first to the last texel center
+	vec3 texel = vec3(brickCoord) * (resolution + 1.0f) + 0.5f + (cellPos - vec3(cell)) * resolution;
+	return textureLod(sdfBrickMapAtlas, texel * sdfBrickMap.invAtlasSize_exactDistance.xyz, 0.0f).r - cellData.z;
+}
+
+// Drop-in replacement for GetDistMatLod(). Far from the surface the baked field is used; the material of those
+// samples is meaningless, but hits are always within exactDistance of the surface, where the exact function is
+// evaluated.
+vec2 getSceneDistMatLod(vec3 sdfPos, float lodCellSize) {
+	if (sdfBrickMap.gridSize_enabled.w != 0) {
+		float baked = getBakedSdfDistance(sdfPos);
+		if (baked > sdfBrickMap.invAtlasSize_exactDistance.w) {
+			return vec2(baked, 0.0f);
+		}
+	}
+	return GetDistMatLod(sdfPos, lodCellSize);
+}
+
+// Drop-in replacement for GetDistMat().
+vec2 getSceneDistMat(vec3 sdfPos) {
+	return getSceneDistMatLod(sdfPos, 0.0f);
+}
@@ -0,0 +1,30 @@
+// Parameters of the fold SDF. These are specialization constants so that the fold can be changed at runtime without
+// recompiling shaders; the values are provided by SdfSpecialization on the C++ side, and the defaults here match its
+// defaults. Constant IDs must match SdfSpecialization::ConstantId.
+
+layout (constant_id = 0) const int FOLD_STEPS = 24;
+layout (constant_id = 1) const float FOLD_FLOOR = 1.0;
+
+// column-major elements of the rotation applied before every fold, rotate3D(0.5, vec3(0.0, 1.0, 0.0)) by default
+layout (constant_id = 2) const float FOLD_ROTATION_00 = 0.87758256;
+layout (constant_id = 3) const float FOLD_ROTATION_01 = 0.0;
+layout (constant_id = 4) const float FOLD_ROTATION_02 = 0.47942554;
+layout (constant_id = 5) const float FOLD_ROTATION_10 = 0.0;
+layout (constant_id = 6) const float FOLD_ROTATION_11 = 1.0;
+layout (constant_id = 7) const float FOLD_ROTATION_12 = 0.0;
+layout (constant_id = 8) const float FOLD_ROTATION_20 = -0.47942554;
+layout (constant_id = 9) const float FOLD_ROTATION_21 = 0.0;
+layout (constant_id = 10) const float FOLD_ROTATION_22 = 0.87758256;
+
+// bit k is set if fold iteration k is emissive
+layout (constant_id = 11) const uint EMISSIVE_ITERATIONS_LOW = 0x200000u;
+layout (constant_id = 12) const uint EMISSIVE_ITERATIONS_HIGH = 0u;
+
+// whether sphereTrace() counts rays and steps, see SphereTraceStatistics
+layout (constant_id = 13) const bool SPHERE_TRACE_STATISTICS = false;
+
+const mat3 FOLD_ROTATION = mat3(
+	vec3(FOLD_ROTATION_00, FOLD_ROTATION_01, FOLD_ROTATION_02),
+	vec3(FOLD_ROTATION_10, FOLD_ROTATION_11, FOLD_ROTATION_12),
+	vec3(FOLD_ROTATION_20, FOLD_ROTATION_21, FOLD_ROTATION_22)
+);
@@ -0,0 +1,83 @@
+// Sphere tracing shared by all SDF marchers. With a relaxation factor above 1 this is the over-relaxed sphere tracing
+// of Keinert et al., "Enhanced Sphere Tracing": every step is lengthened by the factor, and as soon as the unbounding
+// spheres of two consecutive samples stop overlapping the last step may have skipped the surface, so it is partially
+// taken back and tracing continues without relaxation. A factor of 1 is plain sphere tracing.
+// Include sdfBrickMap.glsl first; uniforms.sdfParams and uniforms.sdfScene must be declared.
+
+#include "structs/sphereTraceStructs.glsl"
+
+layout (set = SDF_BRICK_MAP_SET, binding = 3) buffer SphereTraceStatisticsBuffer {
+	SphereTraceStatistics sphereTraceStatistics;
+};
+
+struct SphereTraceResult {
+	bool hit;
+	float t;
+	float matId;
+};
+
+// Distance and material in world space, with the level of detail of GetDistMatLod() given in world units.
+vec2 getWorldDistMatLod(vec3 worldPos, float lodCellSize) {
+	float scale = uniforms.sdfScene.w;
+	vec3 sdfPos = worldPos * scale + uniforms.sdfScene.xyz;
+	vec2 distMat = getSceneDistMatLod(sdfPos, lodCellSize * scale);
+	return vec2(distMat.x / max(scale, 0.0001f), distMat.y);
+}
+
+// Distance and material in world space.
+vec2 getWorldDistMat(vec3 worldPos) {
+	return getWorldDistMatLod(worldPos, 0.0f);
+}
+
+// Traces the ray from origin + tMin * dir to origin + tMax * dir. Uses sdfParams.y as the hit threshold, sdfParams.z
+// as the maximum number of steps and sdfParams.w as the relaxation factor. The marcher is one of the SPHERE_TRACE_*
+// constants and only selects the statistics counter. At distance t the fold is evaluated with a level of detail of
+// t * lodSpread, which does not change where the ray hits; pass 0 to always evaluate the full fold.
+SphereTraceResult sphereTrace(vec3 origin, vec3 dir, float tMin, float tMax, float lodSpread, int marcher) {
+	float epsilon = uniforms.sdfParams.y;
+	int maxSteps = int(uniforms.sdfParams.z);
+	float omega = max(uniforms.sdfParams.w, 1.0f);
+
+	SphereTraceResult result;
+	result.hit = false;
+	result.t = tMin;
+	result.matId = 0.0f;
+
+	float t = tMin;
+	float prevRadius = 0.0f;
+	float stepLength = 0.0f;
+	int steps = 0;
+	while (steps < maxSteps) {
+		// cells below the hit threshold are never skipped, so that the LOD cannot produce hits of its own
+		float lodCellSize = t * lodSpread;
+		vec2 distMat = getWorldDistMatLod(origin + dir * t, lodCellSize > epsilon ? lodCellSize : 0.0f);
+		++steps;
+
+		float radius = abs(distMat.x);
+		bool relaxationFailed = omega > 1.0f && radius + prevRadius < stepLength;
+		if (relaxationFailed) {
+			stepLength -= omega * stepLength;
+			omega = 1.0f;
+		} else {
+			if (distMat.x < epsilon) {
+				result.hit = true;
+				result.matId = distMat.y;
+				break;
+			}
+			stepLength = distMat.x * omega;
+		}
+		prevRadius = radius;
+
+		t += stepLength;
+		if (t > tMax) {
+			break;
+		}
+	}
+	result.t = t;
+
+	if (SPHERE_TRACE_STATISTICS) {
+		atomicAdd(sphereTraceStatistics.rays[marcher], 1u);
+		atomicAdd(sphereTraceStatistics.steps[marcher], uint(steps));
+	}
+	return result;
+}
@@ -19,8 +19,27 @@ struct aliasTableColumn {
 	float aliasOriProb;
 };
 
+// A sample of the emissive surfaces of the SDF in the emissive sample list, see emissiveSample.comp, or of a point or
+// triangle light of the scene, see sceneLights.glsl. Every sample acts like a point light with the given intensity,
+// and a zero normal marks a light that emits in all directions.
 struct EmissiveSample {
 	vec4 position_luminance;
-	vec4 normal_pdf;
+	vec4 normal_pdf; // w: probability with which the entry was drawn, or 1 for scene lights
 	vec4 emission;
 };
+
+// An emissive sample drawn in advance from the luminance CDF, see emissiveSampleTiles.comp.
+struct PresampledEmissiveSample {
+	EmissiveSample light;
+	int index; // slot in the emissive sample list, a scene light index below -1, or -1 if no sample could be drawn
+	float pdf;
+	uint padding[2];
+};
+
+// Node of the light tree over the point and triangle lights of the scene, see LightTree.
+struct LightTreeNode {
+	vec4 boundsMin_intensity; // w: total intensity of the lights below the node
+	vec4 boundsMax_cosNormalBound; // w: cosine of the largest angle between axis and the normal of a light
+	vec4 axis;
+	ivec4 children; // x, y: child nodes; x is -1 for leaves, whose light index is y
+};
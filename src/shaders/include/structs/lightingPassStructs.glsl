@@ -4,4 +4,7 @@ struct LightingPassUniforms{
 	uvec2 bufferSize;
 	int debugMode;
 	float gamma;
+	// range of the procedural lights within the point lights, see LightTree
+	uint firstProceduralLight;
+	uint proceduralLightCount;
 };
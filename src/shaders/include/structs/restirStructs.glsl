@@ -19,7 +19,7 @@
 struct LightSample {
 	vec4 position_emissionLum;
 	vec4 normal;
-	int lightIndex; // negative for triangle lights
+	int lightIndex; // slot in the emissive sample list, or below -1 for scene lights, see sceneLights.glsl
 	float pHat;
 	float sumWeights;
 	float w;
@@ -36,6 +36,15 @@ struct Reservoir {
 
 #define RESTIR_VISIBILITY_REUSE_FLAG (1 << 0)
 #define RESTIR_TEMPORAL_REUSE_FLAG (1 << 1)
+// initial candidates are taken from the presampled light tiles instead of the whole emissive sample list
+#define RESTIR_LIGHT_TILES_FLAG (1 << 2)
+// half of the initial candidates are drawn from the light tree over the scene lights
+#define RESTIR_LIGHT_TREE_FLAG (1 << 3)
+// initial candidates of points within the ReGIR grid are taken from the light reservoirs of their cell
+#define RESTIR_REGIR_FLAG (1 << 4)
+
+// edge length in pixels of the screen tiles that share one presampled light tile
+#define LIGHT_TILE_SCREEN_SIZE 8
 
 struct RestirUniforms {
 	mat4 prevFrameProjectionViewMatrix;
@@ -55,4 +64,15 @@ struct RestirUniforms {
 	int flags;
 	vec4 sdfParams;
 	vec4 sdfScene;
+	// x: first slot of the emissive sample list that is redrawn this frame, y: number of redrawn slots
+	uvec2 emissiveSampleRefresh;
+	// x: number of presampled light tiles, y: number of samples in each tile
+	uvec2 lightTiles;
+	// x: cells along each axis of the ReGIR grid around the camera, y: light reservoirs in each cell, z: candidates
+	// resampled into each reservoir
+	uvec4 regirGrid;
+	float regirCellSize;
+	// total luminance of the point and triangle lights of the scene, which weighs them against the emissive samples of
+	// the SDF; see emissiveSampleCdf.glsl
+	float sceneLightLuminance;
 };
@@ -0,0 +1,6 @@
+struct SdfBrickMapParams {
+	vec4 boundsMin_cellSize; // xyz: minimum corner of the baked region in SDF space, w: edge length of a cell
+	ivec4 gridSize_enabled; // xyz: number of cells along each axis, w: nonzero if the baked field is used
+	ivec4 atlasBricks_brickResolution; // xyz: number of bricks along each atlas axis, w: voxels along a brick edge
+	vec4 invAtlasSize_exactDistance; // xyz: reciprocal of the atlas size in texels, w: see getSceneDistMat()
+};
@@ -0,0 +1,12 @@
+// Constants of the fold SDF in SDF.glsl and SDF-Material.glsl, shared with its C++ port in sdf.cpp.
+#define SDF_FOLD_INITIAL_SIZE 250.0f
+#define SDF_FOLD_SIZE_FALLOFF 0.75f
+#define SDF_FOLD_THICKNESS 0.9f
+#define SDF_EMISSION_STRENGTH 2.0f
+
+// Output of sdfValidation.comp for one point, compared against sdf::getDistMat() and sdf::getMaterial().
+struct SdfValidationResult {
+	vec4 distMat; // x: distance, y: material parameter
+	vec4 albedoRoughness;
+	vec4 emissionMetallic;
+};
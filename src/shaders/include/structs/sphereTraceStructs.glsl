@@ -0,0 +1,9 @@
+#define SPHERE_TRACE_GBUFFER 0
+#define SPHERE_TRACE_VISIBILITY 1
+#define SPHERE_TRACE_MARCHER_COUNT 2
+
+// Per-marcher counters, indexed with the SPHERE_TRACE_* constants above. Cleared at the start of every frame.
+struct SphereTraceStatistics {
+	uint rays[SPHERE_TRACE_MARCHER_COUNT];
+	uint steps[SPHERE_TRACE_MARCHER_COUNT];
+};
@@ -24,14 +24,27 @@ layout (binding = 6) buffer EmissiveSamples {
 	uint padding[3];
 	EmissiveSample samples[];
 } emissiveSamples;
+layout (binding = 7) buffer PointLights {
+	uint count;
+	uint padding[3];
+	pointLight lights[];
+} pointLights;
+layout (binding = 8) buffer TriangleLights {
+	uint count;
+	uint padding[3];
+	triLight lights[];
+} triangleLights;
 
 layout (location = 0) in vec2 inUv;
 
 layout (location = 0) out vec3 outColor;
 
 #define PI 3.1415926
+// the naive debug view skips the procedural lights if there are more than this, since it evaluates every light
+#define NAIVE_PROCEDURAL_LIGHT_LIMIT 1024u
 
 #include "include/frustumUtils.glsl"
+#include "include/sceneLights.glsl"
 
 float rnd(uint seed) {
 	return 0.0f;
@@ -52,6 +65,8 @@ void main() {
 			int lightIndex = reservoir.samples[i].lightIndex;
 			if (lightIndex >= 0 && lightIndex < int(emissiveSamples.count)) {
 				emission = emissiveSamples.samples[lightIndex].emission.rgb;
+			} else if (lightIndex < -1) {
+				emission = getSceneLightEmission(lightIndex);
 			}
 			vec3 pHat = evaluatePHatFull(
 				worldPos, reservoir.samples[i].position_emissionLum.xyz, uniforms.cameraPos.xyz,
@@ -94,6 +109,28 @@ void main() {
 				albedo.rgb, emissiveSamples.samples[i].emission.rgb, roughness, metallic
 			);
 		}
+		// every triangle light is evaluated at a single random point
+		Rand rand = seedRand(0u, uint(gl_FragCoord.y) * 10007u + uint(gl_FragCoord.x));
+		uint skippedBegin = uniforms.firstProceduralLight;
+		uint skippedEnd = skippedBegin;
+		if (uniforms.proceduralLightCount > NAIVE_PROCEDURAL_LIGHT_LIMIT) {
+			skippedEnd += uniforms.proceduralLightCount;
+		}
+		uint lightCount = pointLights.count + triangleLights.count;
+		for (uint i = 0u; i < lightCount; ++i) {
+			if (i == skippedBegin) {
+				i = skippedEnd;
+				if (i >= lightCount) {
+					break;
+				}
+			}
+			EmissiveSample light = sampleSceneLight(i, rand);
+			outColor += evaluatePHatFull(
+				worldPos, light.position_luminance.xyz, uniforms.cameraPos.xyz,
+				normal, light.normal_pdf.xyz, i >= pointLights.count,
+				albedo.rgb, light.emission.rgb, roughness, metallic
+			);
+		}
 	}
 
 	outColor = pow(outColor, vec3(1.0f / uniforms.gamma));
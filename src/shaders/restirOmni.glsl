@@ -18,6 +18,47 @@ layout (binding = 1, set = 0) uniform Restiruniforms {
 	RestirUniforms uniforms;
 };
 
+// CDF of the luminance of the emissive samples, built by emissiveSampleCdf.comp
+layout (binding = 2, set = 0) buffer EmissiveSampleCdf {
+	float totalLuminance;
+	uint padding[3];
+	float cdf[];
+} emissiveSampleCdf;
+
+// presampled light tiles, filled by emissiveSampleTiles.comp
+layout (binding = 3, set = 0) buffer LightTiles {
+	PresampledEmissiveSample lightTiles[];
+};
+
+// the light tree over the scene lights, see LightTreeBuffers
+layout (binding = 4, set = 0) buffer LightTree {
+	uint count;
+	uint padding[3];
+	LightTreeNode nodes[];
+} lightTree;
+layout (binding = 5, set = 0) buffer PointLights {
+	uint count;
+	uint padding[3];
+	pointLight lights[];
+} pointLights;
+layout (binding = 6, set = 0) buffer TriangleLights {
+	uint count;
+	uint padding[3];
+	triLight lights[];
+} triangleLights;
+
+// light reservoirs of the ReGIR grid, filled by regirGrid.comp
+layout (binding = 7, set = 0) buffer RegirGrid {
+	PresampledEmissiveSample regirReservoirs[];
+};
+
+// selects the scene lights in proportion to their intensity, see LightTreeBuffers
+layout (binding = 8, set = 0) buffer SceneLightAliasTable {
+	uint count;
+	uint padding[3];
+	aliasTableColumn columns[];
+} sceneLightAliasTable;
+
 layout (binding = 0, set = 1) uniform sampler2D uniWorldPosition;
 layout (binding = 1, set = 1) uniform sampler2D uniAlbedo;
 layout (binding = 2, set = 1) uniform sampler2D uniNormal;
@@ -54,8 +95,27 @@ layout (local_size_x = OMNI_GROUP_SIZE_X, local_size_y = OMNI_GROUP_SIZE_Y, loca
 #	include "include/softwareRaytracing.glsl"
 #endif
 
+#define SDF_BRICK_MAP_SET 3
 #include "include/visibilityTest.glsl"
 
+#include "include/lightTree.glsl"
+#include "include/emissiveSampleCdf.glsl"
+#include "include/regir.glsl"
+
+// Whether the emissive sample pass has redrawn the light in the given slot this frame, so that reservoirs of the
+// previous frame that reference it are stale.
+bool isEmissiveSampleRefreshed(int lightIndex) {
+	if (lightIndex < -1) {
+		return false; // scene lights do not change
+	}
+	uint count = emissiveSamples.count;
+	if (lightIndex < 0 || count == 0u) {
+		return true;
+	}
+	uint offset = (uint(lightIndex) % count + count - uniforms.emissiveSampleRefresh.x % count) % count;
+	return offset < uniforms.emissiveSampleRefresh.y;
+}
+
 
 void main() {
 	uvec2 pixelCoord =
@@ -78,22 +138,77 @@ void main() {
 
 	Reservoir res = newReservoir();
 	Rand rand = seedRand(uniforms.frame, pixelCoord.y * 10007 + pixelCoord.x);
-	if (dot(normal, normal) != 0.0f && emissiveSamples.count > 0u) {
+	bool hasEmissiveLights = getEmissiveSampleLuminance() + getSceneLightLuminance() > 0.0f;
+	bool hasLightTree = (uniforms.flags & RESTIR_LIGHT_TREE_FLAG) != 0 && lightTree.count > 0u;
+	if (dot(normal, normal) != 0.0f && (hasEmissiveLights || hasLightTree)) {
+		bool useLightTiles = (uniforms.flags & RESTIR_LIGHT_TILES_FLAG) != 0 && uniforms.lightTiles.x > 0u;
+		uint lightTileBegin = 0u;
+		if (useLightTiles) {
+			// all pixels of a screen tile pick the same light tile
+			uvec2 screenTile = pixelCoord / LIGHT_TILE_SCREEN_SIZE;
+			Rand tileRand = seedRand(uniforms.frame, screenTile.y * 10007u + screenTile.x);
+			uint lightTile = min(uint(randFloat(tileRand) * float(uniforms.lightTiles.x)), uniforms.lightTiles.x - 1u);
+			lightTileBegin = lightTile * uniforms.lightTiles.y;
+		}
+		int regirCell = -1;
+		if ((uniforms.flags & RESTIR_REGIR_FLAG) != 0 && uniforms.regirGrid.y > 0u) {
+			regirCell = getRegirCell(worldPos);
+		}
+		// While the light tree is used, the scene lights are only drawn from it, so the two sources are disjoint and a
+		// candidate that picks either with equal probability has the pdf of the source times that probability.
+		float sourceProb = hasEmissiveLights && hasLightTree ? 0.5f : 1.0f;
+
 		for (int i = 0; i < uniforms.initialLightSampleCount; ++i) {
-			int selected_idx = min(
-				int(randFloat(rand) * float(emissiveSamples.count)), int(emissiveSamples.count) - 1
-			);
-			float lightSampleProb = 1.0 / float(emissiveSamples.count);
+			vec3 lightSamplePos;
+			float lightSampleLum;
+			int lightSampleIndex;
+			vec4 lightNormal;
+			float lightSampleProb;
+			if (hasLightTree && (!hasEmissiveLights || randFloat(rand) < sourceProb)) {
+				if (!sampleLightTree(
+					worldPos, normal, rand,
+					lightSamplePos, lightNormal, lightSampleLum, lightSampleIndex, lightSampleProb
+				)) {
+					continue;
+				}
+			} else {
+				int selected_idx;
+				EmissiveSample light;
+				if (regirCell >= 0) {
+					uint entry = min(uint(randFloat(rand) * float(uniforms.regirGrid.y)), uniforms.regirGrid.y - 1u);
+					PresampledEmissiveSample reservoir = regirReservoirs[uint(regirCell) * uniforms.regirGrid.y + entry];
+					if (reservoir.index == -1) {
+						continue;
+					}
+					selected_idx = reservoir.index;
+					light = reservoir.light;
+					lightSampleProb = reservoir.pdf;
+				} else if (useLightTiles) {
+					// the entries of a tile are independent draws from the CDF, so a uniformly chosen entry follows the
+					// same distribution
+					uint entry = min(uint(randFloat(rand) * float(uniforms.lightTiles.y)), uniforms.lightTiles.y - 1u);
+					PresampledEmissiveSample presampled = lightTiles[lightTileBegin + entry];
+					if (presampled.index == -1) {
+						continue;
+					}
+					selected_idx = presampled.index;
+					light = presampled.light;
+					lightSampleProb = presampled.pdf;
+				} else if (!sampleEmissiveLight(rand, light, selected_idx, lightSampleProb)) {
+					continue;
+				}
+				if (light.position_luminance.w <= 0.0 || light.normal_pdf.w <= 0.0) {
+					continue;
+				}
 
-			EmissiveSample light = emissiveSamples.samples[selected_idx];
-			if (light.position_luminance.w <= 0.0 || light.normal_pdf.w <= 0.0) {
-				continue;
+				lightSamplePos = light.position_luminance.xyz;
+				lightSampleLum = light.position_luminance.w;
+				lightSampleIndex = selected_idx;
+				// point lights have no normal
+				float hasNormal = dot(light.normal_pdf.xyz, light.normal_pdf.xyz) > 0.0f ? 1.0f : 0.0f;
+				lightNormal = vec4(light.normal_pdf.xyz, hasNormal);
 			}
-
-			vec3 lightSamplePos = light.position_luminance.xyz;
-			float lightSampleLum = light.position_luminance.w;
-			int lightSampleIndex = selected_idx;
-			vec4 lightNormal = vec4(light.normal_pdf.xyz, 1.0f);
+			lightSampleProb *= sourceProb;
 
 			float pHat = evaluatePHat(
 				worldPos, lightSamplePos, uniforms.cameraPos.xyz,
@@ -162,6 +277,9 @@ void main() {
 								normal, prevRes.samples[i].normal.xyz, prevRes.samples[i].normal.w > 0.5f,
 								albedoLum, prevRes.samples[i].position_emissionLum.w, metallicRoughness.x, metallicRoughness.y
 							);
+							if (isEmissiveSampleRefreshed(prevRes.samples[i].lightIndex)) {
+								pHat[i] = 0.0f;
+							}
 						}
 
 						combineReservoirs(res, prevRes, pHat, rand);
@@ -42,6 +42,7 @@ layout (local_size_x = UNBIASED_REUSE_GROUP_SIZE_X, local_size_y = UNBIASED_REUS
 #	include "include/softwareRaytracing.glsl"
 #endif
 
+#define SDF_BRICK_MAP_SET 2
 #include "include/visibilityTest.glsl"
 
 
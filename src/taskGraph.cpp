@@ -0,0 +1,218 @@
+#include "taskGraph.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+[[nodiscard]] double _toMilliseconds(TaskGraph::Clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+TaskGraph::TaskId TaskGraph::addTask(
+	std::string name, std::function<void()> fn, std::initializer_list<TaskId> dependencies, Affinity affinity
+) {
+	TaskId id = _tasks.size();
+	Task &task = _tasks.emplace_back();
+	task.name = std::move(name);
+	task.function = std::move(fn);
+	task.dependencies = dependencies;
+	task.affinity = affinity;
+	for (TaskId dep : dependencies) {
+		assert(dep < id);
+		_tasks[dep].dependents.emplace_back(id);
+	}
+	return id;
+}
+
+void TaskGraph::run(std::size_t numWorkers) {
+	std::mutex mutex;
+	std::condition_variable stateChanged;
+	std::deque<TaskId> readyTasks;
+	std::deque<TaskId> readyMainThreadTasks;
+	std::size_t numFinished = 0;
+	std::size_t numRunning = 0;
+	std::exception_ptr error;
+
+	auto enqueue = [&](TaskId id) {
+		if (_tasks[id].affinity == Affinity::mainThread) {
+			readyMainThreadTasks.emplace_back(id);
+		} else {
+			readyTasks.emplace_back(id);
+		}
+	};
+	for (TaskId i = 0; i < _tasks.size(); ++i) {
+		_tasks[i].numPendingDependencies = _tasks[i].dependencies.size();
+		if (_tasks[i].numPendingDependencies == 0) {
+			enqueue(i);
+		}
+	}
+
+	auto threadLoop = [&](std::size_t threadIndex) {
+		bool isMainThread = threadIndex == 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			auto hasWork = [&]() {
+				return !error && (!readyTasks.empty() || (isMainThread && !readyMainThreadTasks.empty()));
+			};
+			auto isDone = [&]() {
+				return numFinished == _tasks.size() || (error && numRunning == 0);
+			};
+			stateChanged.wait(lock, [&]() {
+				return isDone() || hasWork();
+			});
+			if (isDone()) {
+				return;
+			}
+
+			// the calling thread prefers tasks that no other thread can take
+			std::deque<TaskId> &queue =
+				isMainThread && !readyMainThreadTasks.empty() ? readyMainThreadTasks : readyTasks;
+			TaskId id = queue.front();
+			queue.pop_front();
+			Task &task = _tasks[id];
+			task.thread = threadIndex;
+			++numRunning;
+
+			lock.unlock();
+			task.start = Clock::now();
+			std::exception_ptr taskError;
+			try {
+				task.function();
+			} catch (...) {
+				taskError = std::current_exception();
+			}
+			task.end = Clock::now();
+			lock.lock();
+
+			--numRunning;
+			++numFinished;
+			if (taskError) {
+				if (!error) {
+					error = taskError;
+				}
+			} else {
+				for (TaskId dependent : task.dependents) {
+					if (--_tasks[dependent].numPendingDependencies == 0) {
+						enqueue(dependent);
+					}
+				}
+			}
+			stateChanged.notify_all();
+		}
+	};
+
+	_runStart = Clock::now();
+	std::vector<std::thread> workers;
+	for (std::size_t i = 0; i < numWorkers; ++i) {
+		workers.emplace_back(threadLoop, i + 1);
+	}
+	threadLoop(0);
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	_runEnd = Clock::now();
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void TaskGraph::printReport() const {
+	if (_tasks.empty()) {
+		return;
+	}
+
+	// tasks only depend on earlier tasks, so the IDs are already in topological order
+	std::vector<Clock::duration> longestChain(_tasks.size());
+	std::vector<TaskId> chainPredecessor(_tasks.size());
+	TaskId chainEnd = 0;
+	Clock::duration totalTaskTime{ 0 };
+	for (TaskId i = 0; i < _tasks.size(); ++i) {
+		const Task &task = _tasks[i];
+		Clock::duration duration = task.end - task.start;
+		totalTaskTime += duration;
+
+		chainPredecessor[i] = i;
+		Clock::duration longestDependency{ 0 };
+		for (TaskId dep : task.dependencies) {
+			if (longestChain[dep] > longestDependency) {
+				longestDependency = longestChain[dep];
+				chainPredecessor[i] = dep;
+			}
+		}
+		longestChain[i] = longestDependency + duration;
+		if (longestChain[i] > longestChain[chainEnd]) {
+			chainEnd = i;
+		}
+	}
+
+	std::vector<bool> onCriticalPath(_tasks.size(), false);
+	std::vector<TaskId> criticalPath;
+	for (TaskId i = chainEnd; ; i = chainPredecessor[i]) {
+		onCriticalPath[i] = true;
+		criticalPath.emplace_back(i);
+		if (chainPredecessor[i] == i) {
+			break;
+		}
+	}
+
+	double wallTime = _toMilliseconds(_runEnd - _runStart);
+	std::cout <<
+		"Task graph: " << _tasks.size() << " tasks, " <<
+		std::fixed << std::setprecision(2) << wallTime << " ms wall time, " <<
+		_toMilliseconds(totalTaskTime) << " ms total task time (" <<
+		(wallTime > 0.0 ? _toMilliseconds(totalTaskTime) / wallTime : 0.0) << "x parallelism)\n";
+	for (const Task &task : _tasks) {
+		std::size_t id = &task - _tasks.data();
+		std::cout <<
+			"    " << (onCriticalPath[id] ? '*' : ' ') << " [thread " << task.thread << "] " <<
+			std::setw(8) << _toMilliseconds(task.start - _runStart) << " - " <<
+			std::setw(8) << _toMilliseconds(task.end - _runStart) << " ms  " << task.name << "\n";
+	}
+	std::cout << "Critical path (" << _toMilliseconds(longestChain[chainEnd]) << " ms):";
+	for (auto it = criticalPath.rbegin(); it != criticalPath.rend(); ++it) {
+		std::cout << (it == criticalPath.rbegin() ? " " : " -> ") << _tasks[*it].name;
+	}
+	std::cout << "\n";
+	std::cout.unsetf(std::ios::fixed);
+	std::cout << std::setprecision(6);
+}
+
+void parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn) {
+	std::atomic<std::size_t> next = 0;
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto threadLoop = [&]() {
+		for (std::size_t i = next++; i < count; i = next++) {
+			try {
+				fn(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+				next = count;
+			}
+		}
+	};
+
+	std::size_t numThreads = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+	std::vector<std::thread> workers;
+	for (std::size_t i = 1; i < numThreads; ++i) {
+		workers.emplace_back(threadLoop);
+	}
+	threadLoop();
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// A small task graph with explicit dependencies. Tasks are added in order, and a task can only depend on tasks that
+/// have been added before it, so the graph is acyclic by construction. \ref run() executes the graph on a pool of
+/// worker threads plus the calling thread.
+class TaskGraph {
+public:
+	using Clock = std::chrono::high_resolution_clock;
+	using TaskId = std::size_t;
+
+	/// Which threads a task may run on.
+	enum class Affinity {
+		any, ///< Any worker thread, or the thread that calls \ref run().
+		/// Only the thread that calls \ref run(). Used for GLFW calls, ImGui and anything that allocates from the
+		/// externally synchronized descriptor pools.
+		mainThread
+	};
+
+	/// Adds a task and returns its ID.
+	TaskId addTask(
+		std::string name, std::function<void()> fn,
+		std::initializer_list<TaskId> dependencies = {}, Affinity affinity = Affinity::any
+	);
+
+	/// Executes all tasks and blocks until they're finished. If a task throws, no new tasks are started and the first
+	/// exception is rethrown once all running tasks have finished.
+	void run(std::size_t numWorkers = std::max<std::size_t>(std::thread::hardware_concurrency(), 2) - 1);
+
+	/// Prints the timeline of the last run along with its critical path, i.e., the chain of dependent tasks with the
+	/// longest total duration. The critical path is a lower bound on the wall time of the graph.
+	void printReport() const;
+private:
+	struct Task {
+		std::string name;
+		std::function<void()> function;
+		std::vector<TaskId> dependencies;
+		std::vector<TaskId> dependents;
+		Affinity affinity = Affinity::any;
+
+		std::size_t numPendingDependencies = 0;
+		Clock::time_point start;
+		Clock::time_point end;
+		std::size_t thread = 0; ///< 0 for the calling thread, worker index plus one otherwise.
+	};
+
+	std::vector<Task> _tasks;
+	Clock::time_point _runStart;
+	Clock::time_point _runEnd;
+};
+
+/// Calls \p fn for every index in [0, \p count) on all hardware threads and blocks until all calls have returned.
+/// Indices are handed out one at a time, so calls may take varying amounts of time. If a call throws, the remaining
+/// indices are skipped and the first exception is rethrown.
+void parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn);
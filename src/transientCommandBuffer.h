@@ -1,9 +1,15 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
+
 #include <vulkan/vulkan.hpp>
 
 class TransientCommandBufferPool;
 
+/// A one-time command buffer. The command buffer holds exclusive access to its pool and queue from \ref
+/// TransientCommandBufferPool::begin() until it has been submitted and waited for, since both the command pool and the
+/// queue are externally synchronized.
 class TransientCommandBuffer {
 	friend TransientCommandBufferPool;
 public:
@@ -29,6 +35,7 @@ public:
 			_fence.reset();
 			_device = nullptr;
 			_queue = nullptr;
+			_lock = std::unique_lock<std::mutex>();
 		}
 	}
 
@@ -50,8 +57,11 @@ private:
 	vk::UniqueFence _fence;
 	vk::Device _device;
 	vk::Queue _queue;
+	std::unique_lock<std::mutex> _lock;
 };
 
+/// Pool of one-time command buffers that can be used from multiple threads. Only one command buffer can be recorded
+/// at a time; \ref begin() blocks until the previous one has been submitted.
 class TransientCommandBufferPool {
 public:
 	TransientCommandBufferPool() = default;
@@ -61,11 +71,13 @@ public:
 			.setQueueFamilyIndex(queueIndex)
 			.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
 		_pool = _device.createCommandPoolUnique(transientPoolInfo);
+		_mutex = std::make_unique<std::mutex>();
 	}
 
 	TransientCommandBuffer begin(vk::Queue queue) {
 		TransientCommandBuffer result;
 
+		result._lock = std::unique_lock<std::mutex>(*_mutex);
 		result._device = _device;
 		result._queue = queue;
 
@@ -87,4 +99,5 @@ public:
 private:
 	vk::UniqueCommandPool _pool;
 	vk::Device _device;
+	std::unique_ptr<std::mutex> _mutex;
 };
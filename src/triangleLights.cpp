@@ -0,0 +1,382 @@
+#include "triangleLights.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <optional>
+
+#include <stb_image.h>
+
+#include <nvmath.h>
+
+#include "misc.h"
+#include "taskGraph.h"
+
+/// Header of the triangle light cache file.
+struct TriangleLightFileHeader {
+	constexpr static uint32_t expectedMagic = 0x54494C54; // "TLIT"
+	constexpr static uint32_t expectedVersion = 2;
+
+	uint32_t magic = expectedMagic;
+	uint32_t version = expectedVersion;
+	uint64_t sceneHash = 0; ///< Hash of everything the lights are computed from, see \ref _hashTriangleLightInputs().
+
+	uint32_t numLights = 0;
+	uint32_t padding = 0;
+};
+constexpr CacheFileFormat _triangleLightCacheFormat{
+	.name = "Triangle lights", .fallback = "integrating", .mismatch = "belongs to a different scene"
+};
+
+/// Number of triangles that are integrated by one task.
+constexpr std::size_t _trianglesPerBatch = 1024;
+/// Footprints that cover more texels are subsampled with a regular stride.
+constexpr double _maxFootprintTexels = 16384.0;
+
+
+/// An emissive texture decoded to linear RGB.
+struct _EmissiveTexture {
+	std::vector<nvmath::vec3f> texels;
+	int width = 0;
+	int height = 0;
+
+	/// Fetches a texel with repeat wrapping, the default addressing mode of glTF samplers.
+	[[nodiscard]] nvmath::vec3f fetch(int x, int y) const {
+		x %= width;
+		y %= height;
+		x += x < 0 ? width : 0;
+		y += y < 0 ? height : 0;
+		return texels[static_cast<std::size_t>(y) * width + x];
+	}
+	[[nodiscard]] bool empty() const {
+		return texels.empty();
+	}
+};
+
+/// Decodes the given image. glTF stores emission in sRGB, so texels are converted to linear values.
+[[nodiscard]] _EmissiveTexture _decodeEmissiveTexture(const tinygltf::Image &image, int imageIndex) {
+	_EmissiveTexture result;
+	int channels = 0;
+	stbi_uc *pixels = stbi_load_from_memory(
+		image.image.data(), static_cast<int>(image.image.size()), &result.width, &result.height, &channels, STBI_rgb
+	);
+	if (!pixels) {
+		std::cout << "Triangle lights: failed to decode emissive image " << imageIndex << " (" << image.uri <<
+			"): " << stbi_failure_reason() << ", using the emissive factor only\n";
+		return _EmissiveTexture();
+	}
+
+	std::array<float, 256> toLinear;
+	for (std::size_t i = 0; i < toLinear.size(); ++i) {
+		float c = static_cast<float>(i) / 255.0f;
+		toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+	result.texels.resize(static_cast<std::size_t>(result.width) * result.height);
+	for (std::size_t i = 0; i < result.texels.size(); ++i) {
+		const stbi_uc *texel = pixels + 3 * i;
+		result.texels[i] = nvmath::vec3f(toLinear[texel[0]], toLinear[texel[1]], toLinear[texel[2]]);
+	}
+	stbi_image_free(pixels);
+	return result;
+}
+
+/// Averages the texture over the triangle with the given texture coordinates: texels whose centers lie within the
+/// triangle are averaged, footprints larger than \ref _maxFootprintTexels are subsampled, and footprints that do not
+/// contain any texel center use the texel under the centroid.
+[[nodiscard]] nvmath::vec3f _integrateFootprint(
+	const _EmissiveTexture &texture, nvmath::vec2f uv1, nvmath::vec2f uv2, nvmath::vec2f uv3
+) {
+	nvmath::vec2f size(static_cast<float>(texture.width), static_cast<float>(texture.height));
+	// in texel units, with texel centers at integer coordinates
+	nvmath::vec2f a = uv1 * size - 0.5f, b = uv2 * size - 0.5f, c = uv3 * size - 0.5f;
+	auto cross = [](nvmath::vec2f u, nvmath::vec2f v) {
+		return u.x * v.y - u.y * v.x;
+	};
+	float doubleArea = cross(b - a, c - a);
+
+	nvmath::vec2f centroid = (a + b + c) / 3.0f;
+	nvmath::vec3f centroidTexel = texture.fetch(
+		static_cast<int>(std::lround(centroid.x)), static_cast<int>(std::lround(centroid.y))
+	);
+	if (!std::isfinite(doubleArea) || std::abs(doubleArea) < 1e-12f) {
+		return centroidTexel;
+	}
+
+	nvmath::vec2f min = nvmath::nv_min(nvmath::nv_min(a, b), c), max = nvmath::nv_max(nvmath::nv_max(a, b), c);
+	auto x0 = static_cast<int64_t>(std::ceil(min.x)), x1 = static_cast<int64_t>(std::floor(max.x));
+	auto y0 = static_cast<int64_t>(std::ceil(min.y)), y1 = static_cast<int64_t>(std::floor(max.y));
+	if (x0 > x1 || y0 > y1) {
+		return centroidTexel;
+	}
+	double footprint = static_cast<double>(x1 - x0 + 1) * static_cast<double>(y1 - y0 + 1);
+	auto stride = static_cast<int64_t>(std::max(1.0, std::ceil(std::sqrt(footprint / _maxFootprintTexels))));
+
+	nvmath::vec3f sum(0.0f, 0.0f, 0.0f);
+	std::size_t count = 0;
+	for (int64_t y = y0; y <= y1; y += stride) {
+		for (int64_t x = x0; x <= x1; x += stride) {
+			nvmath::vec2f p(static_cast<float>(x), static_cast<float>(y));
+			// barycentric coordinates, which are all non-negative inside the triangle for both orientations
+			float w1 = cross(c - b, p - b) / doubleArea;
+			float w2 = cross(a - c, p - c) / doubleArea;
+			float w3 = 1.0f - w1 - w2;
+			if (w1 >= 0.0f && w2 >= 0.0f && w3 >= 0.0f) {
+				sum += texture.fetch(static_cast<int>(x), static_cast<int>(y));
+				++count;
+			}
+		}
+	}
+	return count > 0 ? sum / static_cast<float>(count) : centroidTexel;
+}
+
+/// Returns whether the material emits at all; glTF multiplies the emissive texture with the factor.
+[[nodiscard]] bool _isEmissive(const nvh::GltfMaterial &material) {
+	return material.emissiveFactor.sq_norm() > 1e-6;
+}
+
+/// Returns the set of texture coordinates that the emissive texture of the material is sampled with, or nullptr if the
+/// scene does not have it for every vertex.
+[[nodiscard]] const std::vector<nvmath::vec2f> *_getEmissiveTexCoords(
+	const nvh::GltfScene &scene, const nvh::GltfMaterial &material
+) {
+	const std::vector<nvmath::vec2f> *texCoords = nullptr;
+	switch (material.emissiveTexCoord) {
+	case 0:
+		texCoords = &scene.m_texcoords0;
+		break;
+	case 1:
+		texCoords = &scene.m_texcoords1;
+		break;
+	default:
+		return nullptr;
+	}
+	return texCoords->size() == scene.m_positions.size() ? texCoords : nullptr;
+}
+
+/// Returns the index in \ref nvh::GltfScene::m_textures of the image that the emissive texture of the material samples
+/// if it has been loaded together with its texture coordinates, or -1.
+[[nodiscard]] int _getLoadedEmissiveImage(const nvh::GltfScene &scene, const nvh::GltfMaterial &material) {
+	if (
+		material.emissiveTexture < 0 ||
+		static_cast<std::size_t>(material.emissiveTexture) >= scene.m_textureImages.size()
+	) {
+		return -1;
+	}
+	int image = scene.m_textureImages[material.emissiveTexture];
+	if (
+		image < 0 || static_cast<std::size_t>(image) >= scene.m_textures.size() ||
+		scene.m_textures[image].image.empty() || !_getEmissiveTexCoords(scene, material)
+	) {
+		return -1;
+	}
+	return image;
+}
+
+/// FNV-1a over whole words, with the remaining bytes hashed one at a time.
+void _hashBytes(uint64_t &hash, const void *data, std::size_t size) {
+	constexpr uint64_t prime = 0x100000001B3ull;
+	const auto *bytes = static_cast<const unsigned char*>(data);
+	std::size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(uint64_t));
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * prime;
+	}
+}
+template <typename T> void _hashVector(uint64_t &hash, const std::vector<T> &vec) {
+	uint64_t size = vec.size();
+	_hashBytes(hash, &size, sizeof(size));
+	_hashBytes(hash, vec.data(), vec.size() * sizeof(T));
+}
+
+/// Hashes the geometry, the emissive parts of the materials, and the encoded emissive images of the scene.
+[[nodiscard]] uint64_t _hashTriangleLightInputs(const nvh::GltfScene &scene) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	_hashVector(hash, scene.m_positions);
+	_hashVector(hash, scene.m_indices);
+	_hashVector(hash, scene.m_texcoords0);
+	_hashVector(hash, scene.m_texcoords1);
+	for (const nvh::GltfNode &node : scene.m_nodes) {
+		_hashBytes(hash, &node.worldMatrix, sizeof(node.worldMatrix));
+		_hashBytes(hash, &node.primMesh, sizeof(node.primMesh));
+	}
+	for (const nvh::GltfPrimMesh &mesh : scene.m_primMeshes) {
+		std::array<int64_t, 4> range{ mesh.firstIndex, mesh.indexCount, mesh.vertexOffset, mesh.materialIndex };
+		_hashBytes(hash, range.data(), sizeof(range));
+	}
+	for (const nvh::GltfMaterial &material : scene.m_materials) {
+		_hashBytes(hash, &material.emissiveFactor, sizeof(material.emissiveFactor));
+		std::array<int, 2> image{ _getLoadedEmissiveImage(scene, material), material.emissiveTexCoord };
+		_hashBytes(hash, image.data(), sizeof(image));
+		if (image[0] >= 0) {
+			_hashVector(hash, scene.m_textures[image[0]].image);
+		}
+	}
+	return hash;
+}
+
+[[nodiscard]] std::optional<std::vector<shader::triLight>> _loadTriangleLights(
+	const std::filesystem::path &path, uint64_t sceneHash
+) {
+	TriangleLightFileHeader expected;
+	expected.sceneHash = sceneHash;
+	std::optional<CacheFile<TriangleLightFileHeader>> file = loadCacheFile(
+		_triangleLightCacheFormat, path, expected, offsetof(TriangleLightFileHeader, numLights),
+		[](const TriangleLightFileHeader &header) {
+			return header.numLights * sizeof(shader::triLight);
+		}
+	);
+	if (!file) {
+		return std::nullopt;
+	}
+
+	std::vector<shader::triLight> result(file->header.numLights);
+	std::memcpy(result.data(), file->getPayload(), result.size() * sizeof(shader::triLight));
+	std::cout << "Triangle lights: loaded " << result.size() << " lights from " << path << "\n";
+	return result;
+}
+
+void _saveTriangleLights(
+	const std::filesystem::path &path, uint64_t sceneHash, const std::vector<shader::triLight> &lights
+) {
+	TriangleLightFileHeader header;
+	header.sceneHash = sceneHash;
+	header.numLights = static_cast<uint32_t>(lights.size());
+	saveCacheFile(_triangleLightCacheFormat, path, header, { std::as_bytes(std::span(lights)) });
+}
+
+/// A range of triangles of one emissive node.
+struct _TriangleBatch {
+	const nvh::GltfNode *node = nullptr;
+	std::size_t firstTriangle = 0; ///< Index of the first triangle within the mesh of the node.
+	std::size_t numTriangles = 0;
+	std::size_t firstLight = 0; ///< Index of the first triangle among the triangles of all batches.
+};
+
+std::vector<shader::triLight> collectTriangleLightsFromScene(
+	const nvh::GltfScene &scene, const std::filesystem::path &cachePath
+) {
+	auto begin = std::chrono::high_resolution_clock::now();
+
+	// several textures and materials can share an image, which is only decoded once
+	std::vector<int> emissiveImageIndices;
+	for (const nvh::GltfMaterial &material : scene.m_materials) {
+		int image = _getLoadedEmissiveImage(scene, material);
+		if (_isEmissive(material) && image >= 0) {
+			emissiveImageIndices.emplace_back(image);
+		}
+	}
+	std::sort(emissiveImageIndices.begin(), emissiveImageIndices.end());
+	emissiveImageIndices.erase(
+		std::unique(emissiveImageIndices.begin(), emissiveImageIndices.end()), emissiveImageIndices.end()
+	);
+
+	// without textures the lights are cheap to compute
+	bool useCache = !cachePath.empty() && !emissiveImageIndices.empty();
+	uint64_t sceneHash = 0;
+	if (useCache) {
+		sceneHash = _hashTriangleLightInputs(scene);
+		if (std::optional<std::vector<shader::triLight>> cached = _loadTriangleLights(cachePath, sceneHash)) {
+			return std::move(*cached);
+		}
+	}
+
+	std::vector<_EmissiveTexture> images(scene.m_textures.size());
+	parallelFor(emissiveImageIndices.size(), [&](std::size_t i) {
+		int index = emissiveImageIndices[i];
+		images[index] = _decodeEmissiveTexture(scene.m_textures[index], index);
+	});
+
+	std::vector<_TriangleBatch> batches;
+	std::size_t numTriangles = 0;
+	for (const nvh::GltfNode &node : scene.m_nodes) {
+		const nvh::GltfPrimMesh &mesh = scene.m_primMeshes[node.primMesh];
+		if (!_isEmissive(scene.m_materials[mesh.materialIndex])) {
+			continue;
+		}
+		std::size_t meshTriangles = mesh.indexCount / 3;
+		for (std::size_t first = 0; first < meshTriangles; first += _trianglesPerBatch) {
+			_TriangleBatch &batch = batches.emplace_back();
+			batch.node = &node;
+			batch.firstTriangle = first;
+			batch.numTriangles = std::min(_trianglesPerBatch, meshTriangles - first);
+			batch.firstLight = numTriangles;
+			numTriangles += batch.numTriangles;
+		}
+	}
+
+	std::vector<shader::triLight> lights(numTriangles);
+	std::vector<uint8_t> emits(numTriangles, 0);
+	parallelFor(batches.size(), [&](std::size_t batchIndex) {
+		const _TriangleBatch &batch = batches[batchIndex];
+		const nvh::GltfPrimMesh &mesh = scene.m_primMeshes[batch.node->primMesh];
+		const nvh::GltfMaterial &material = scene.m_materials[mesh.materialIndex];
+		int imageIndex = _getLoadedEmissiveImage(scene, material);
+		const _EmissiveTexture *texture =
+			imageIndex >= 0 && !images[imageIndex].empty() ? &images[imageIndex] : nullptr;
+		const std::vector<nvmath::vec2f> *texCoords = texture ? _getEmissiveTexCoords(scene, material) : nullptr;
+
+		for (std::size_t i = 0; i < batch.numTriangles; ++i) {
+			const uint32_t *indices = scene.m_indices.data() + mesh.firstIndex + 3 * (batch.firstTriangle + i);
+			std::size_t v1 = mesh.vertexOffset + indices[0];
+			std::size_t v2 = mesh.vertexOffset + indices[1];
+			std::size_t v3 = mesh.vertexOffset + indices[2];
+			nvmath::vec4f p1 = batch.node->worldMatrix * nvmath::vec4f(scene.m_positions[v1], 1.0f);
+			nvmath::vec4f p2 = batch.node->worldMatrix * nvmath::vec4f(scene.m_positions[v2], 1.0f);
+			nvmath::vec4f p3 = batch.node->worldMatrix * nvmath::vec4f(scene.m_positions[v3], 1.0f);
+
+			nvmath::vec3f normal = nvmath::cross(nvmath::vec3f(p2 - p1), nvmath::vec3f(p3 - p1));
+			float area = normal.norm();
+			if (!(area > 0.0f)) {
+				continue;
+			}
+			normal /= area;
+			area *= 0.5f;
+
+			nvmath::vec3f emission = material.emissiveFactor;
+			if (texture) {
+				nvmath::vec3f average = _integrateFootprint(
+					*texture, (*texCoords)[v1], (*texCoords)[v2], (*texCoords)[v3]
+				);
+				emission = nvmath::vec3f(emission.x * average.x, emission.y * average.y, emission.z * average.z);
+			}
+			float emissionLuminance = shader::luminance(emission.x, emission.y, emission.z);
+			if (!(emissionLuminance > 0.0f)) {
+				continue;
+			}
+
+			std::size_t light = batch.firstLight + i;
+			lights[light] = shader::triLight{
+				.p1 = p1, .p2 = p2, .p3 = p3,
+				.emission_luminance = nvmath::vec4f(emission, emissionLuminance),
+				.normalArea = nvmath::vec4f(normal, area)
+			};
+			emits[light] = 1;
+		}
+	});
+
+	std::vector<shader::triLight> result;
+	for (std::size_t i = 0; i < numTriangles; ++i) {
+		if (emits[i]) {
+			result.emplace_back(lights[i]);
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout <<
+		"Triangle lights: " << result.size() << " of " << numTriangles << " emissive triangles emit, " <<
+		emissiveImageIndices.size() << " emissive images integrated in " <<
+		std::chrono::duration<double, std::milli>(end - begin).count() << " ms\n";
+
+	if (useCache) {
+		_saveTriangleLights(cachePath, sceneHash, result);
+	}
+	return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <gltfscene.h>
+
+#include "shaderIncludes.h"
+
+/// Collects a light for every emissive triangle of the scene. The emission of a triangle is the emissive factor of its
+/// material times the average of the emissive texture over the UV footprint of the triangle, so that textured emitters
+/// get the power they actually emit; triangles that turn out black or degenerate are dropped. Emissive textures are
+/// resolved to their images in \ref nvh::GltfScene::m_textures through \ref nvh::GltfScene::m_textureImages, decoded
+/// and integrated on all hardware threads with the texture coordinate set of the material. If the scene was loaded
+/// without textures or without that texture coordinate set, the emissive factor alone is used.
+///
+/// If \p cachePath is not empty and the scene has textured emitters, the lights are cached in that file, which is
+/// reused as long as the geometry, materials and emissive images of the scene are unchanged.
+[[nodiscard]] std::vector<shader::triLight> collectTriangleLightsFromScene(
+	const nvh::GltfScene&, const std::filesystem::path &cachePath = {}
+);
@@ -79,6 +79,15 @@ namespace vma {
 		{
 			vmaGetAllocationInfo(_getAllocator(), _allocation, pAllocatorInfo);
 		}
+		/// Returns the size of the underlying allocation, or zero if this handle is empty.
+		[[nodiscard]] vk::DeviceSize getAllocationSize() const {
+			if (!_allocation) {
+				return 0;
+			}
+			VmaAllocationInfo info{};
+			vmaGetAllocationInfo(_getAllocator(), _allocation, &info);
+			return info.size;
+		}
 	protected:
 		T _object;
 		VmaAllocation _allocation = nullptr;
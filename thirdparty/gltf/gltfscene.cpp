@@ -47,6 +47,7 @@ namespace nvh {
             gmat.doubleSided = tmat.doubleSided;
             gmat.emissiveFactor = nvmath::vec3f(tmat.emissiveFactor[0], tmat.emissiveFactor[1], tmat.emissiveFactor[2]);
             gmat.emissiveTexture = tmat.emissiveTexture.index;
+            gmat.emissiveTexCoord = tmat.emissiveTexture.texCoord;
             gmat.normalTexture = tmat.normalTexture.index;
             gmat.normalTextureScale = static_cast<float>(tmat.normalTexture.scale);
             gmat.occlusionTexture = tmat.occlusionTexture.index;
@@ -97,6 +98,13 @@ namespace nvh {
             gmat.pbrMetallicFactor = 0;
             m_materials.emplace_back(gmat);
         }
+
+        // Materials reference textures, several textures can share an image
+        m_textureImages.reserve(tmodel.textures.size());
+        for (const auto& ttex : tmodel.textures)
+        {
+            m_textureImages.emplace_back(ttex.source);
+        }
     }
 
     //--------------------------------------------------------------------------------------------------
@@ -133,6 +141,8 @@ namespace nvh {
             m_normals.reserve(nbVert);
         if ((attributes & GltfAttributes::Texcoord_0) == GltfAttributes::Texcoord_0)
             m_texcoords0.reserve(nbVert);
+        if ((attributes & GltfAttributes::Texcoord_1) == GltfAttributes::Texcoord_1)
+            m_texcoords1.reserve(nbVert);
         if ((attributes & GltfAttributes::Tangent) == GltfAttributes::Tangent)
             m_tangents.reserve(nbVert);
         if ((attributes & GltfAttributes::Color_0) == GltfAttributes::Color_0)
@@ -388,6 +398,16 @@ namespace nvh {
             }
         }
 
+        // TEXCOORD_1
+        if ((attributes & GltfAttributes::Texcoord_1) == GltfAttributes::Texcoord_1)
+        {
+            if (!getAttribute<nvmath::vec2f>(tmodel, tmesh, m_texcoords1, "TEXCOORD_1"))
+            {
+                // Set them all to zero
+                m_texcoords1.insert(m_texcoords1.end(), resultMesh.vertexCount, nvmath::vec2f(0, 0));
+            }
+        }
+
 
         // TANGENT
         if ((attributes & GltfAttributes::Tangent) == GltfAttributes::Tangent)
@@ -461,6 +481,7 @@ namespace nvh {
         m_tangents.clear();
         m_texcoords0.clear();
         m_texcoords1.clear();
+        m_textureImages.clear();
         m_colors0.clear();
         m_cameras.clear();
         //m_joints0.clear();
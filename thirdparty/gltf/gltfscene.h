@@ -86,6 +86,7 @@ namespace nvh {
         int   khrSpecularGlossinessTexture{ -1 };
 
         int   emissiveTexture{ -1 };
+        int   emissiveTexCoord{ 0 };  // Set of texture coordinates of the emissive texture
         vec3  emissiveFactor{ 0, 0, 0 };
         int   alphaMode{ 0 };
         float alphaCutoff{ 0.5f };
@@ -186,7 +187,8 @@ namespace nvh {
         std::vector<GltfPrimMesh> m_primMeshes;  // Primitive promoted to meshes
         std::vector<GltfCamera>   m_cameras;
         std::vector<GltfLight>    m_lights;
-        std::vector<tinygltf::Image>    m_textures;
+        std::vector<tinygltf::Image>    m_textures;       // Images, indexed through m_textureImages
+        std::vector<int>                m_textureImages;  // Image of every glTF texture, or -1
 
         // Attributes, all same length if valid
         std::vector<nvmath::vec3f> m_positions;